@@ -0,0 +1,353 @@
+/******************************************************************************/
+/**
+ * @file        containerFileInterface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB that stores the data, index and
+ *              variable data files as regions of one container file. A
+ *              superblock at the start of the file describes the regions.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include "containerFileInterface.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONTAINER_MAGIC 0x43424445 /* "EDBC" */
+#define CONTAINER_VERSION 1
+#define CONTAINER_NUM_REGIONS 3
+
+/* Superblock layout: magic, version, page size, erase size, then the first page and page count of each region */
+#define CONTAINER_SUPERBLOCK_SIZE (4 * sizeof(uint32_t) + CONTAINER_NUM_REGIONS * 2 * sizeof(uint32_t))
+
+typedef struct CONTAINER_FILE_INFO CONTAINER_FILE_INFO;
+
+typedef struct {
+    CONTAINER_FILE_INFO *container; /* Container the region belongs to */
+    uint32_t firstPage;             /* Page of the wrapped file where the region starts */
+    uint32_t numPages;              /* Number of pages in the region */
+    int8_t isOpen;                  /* 1 if embedDB has opened the region */
+} CONTAINER_REGION_INFO;
+
+struct CONTAINER_FILE_INFO {
+    embedDBFileInterface *baseInterface;                  /* Interface of the wrapped file */
+    void *baseFile;                                       /* File data of the wrapped file */
+    uint32_t pageSize;                                    /* Size of a page in bytes */
+    uint32_t eraseSizeInPages;                            /* Size of an erase block in pages */
+    CONTAINER_REGION_INFO regions[CONTAINER_NUM_REGIONS]; /* Data, index and variable data regions */
+    uint8_t numOpen;                                      /* Number of open regions. The wrapped file is open while this is above 0 */
+    int8_t unsynced;                                      /* 1 if a page was written since the wrapped file was last synced */
+    int8_t layoutMismatch;                                /* Set when the file has a superblock for a different layout, so it is not overwritten */
+};
+
+void *setupContainerFile(embedDBFileInterface *baseInterface, void *baseFile, uint32_t pageSize, uint32_t numDataPages, uint32_t numIndexPages, uint32_t numVarPages, uint32_t eraseSizeInPages) {
+    CONTAINER_FILE_INFO *fileInfo = malloc(sizeof(CONTAINER_FILE_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    fileInfo->baseInterface = baseInterface;
+    fileInfo->baseFile = baseFile;
+    fileInfo->pageSize = pageSize;
+    fileInfo->eraseSizeInPages = eraseSizeInPages > 0 ? eraseSizeInPages : 1;
+    fileInfo->numOpen = 0;
+    fileInfo->unsynced = 0;
+    fileInfo->layoutMismatch = 0;
+
+    /* The superblock gets the first erase block so erasing a region never erases it */
+    uint32_t numPages[CONTAINER_NUM_REGIONS] = {numDataPages, numIndexPages, numVarPages};
+    uint32_t nextPage = fileInfo->eraseSizeInPages;
+    for (uint8_t i = 0; i < CONTAINER_NUM_REGIONS; i++) {
+        fileInfo->regions[i].container = fileInfo;
+        fileInfo->regions[i].firstPage = nextPage;
+        fileInfo->regions[i].numPages = numPages[i];
+        fileInfo->regions[i].isOpen = 0;
+        nextPage += (numPages[i] + fileInfo->eraseSizeInPages - 1) / fileInfo->eraseSizeInPages * fileInfo->eraseSizeInPages;
+    }
+    return fileInfo;
+}
+
+void *getContainerRegion(void *container, uint8_t region) {
+    CONTAINER_FILE_INFO *fileInfo = (CONTAINER_FILE_INFO *)container;
+    switch (region) {
+        case EMBEDDB_DATA_FILE:
+            return &fileInfo->regions[0];
+        case EMBEDDB_INDEX_FILE:
+            return &fileInfo->regions[1];
+        case EMBEDDB_VAR_FILE:
+            return &fileInfo->regions[2];
+    }
+    return NULL;
+}
+
+/**
+ * @brief	Writes the container's superblock into the first CONTAINER_SUPERBLOCK_SIZE bytes of buffer.
+ */
+static void containerEncodeSuperblock(CONTAINER_FILE_INFO *fileInfo, void *buffer) {
+    uint32_t fields[CONTAINER_SUPERBLOCK_SIZE / sizeof(uint32_t)];
+    fields[0] = CONTAINER_MAGIC;
+    fields[1] = CONTAINER_VERSION;
+    fields[2] = fileInfo->pageSize;
+    fields[3] = fileInfo->eraseSizeInPages;
+    for (uint8_t i = 0; i < CONTAINER_NUM_REGIONS; i++) {
+        fields[4 + 2 * i] = fileInfo->regions[i].firstPage;
+        fields[5 + 2 * i] = fileInfo->regions[i].numPages;
+    }
+    memcpy(buffer, fields, CONTAINER_SUPERBLOCK_SIZE);
+}
+
+/**
+ * @brief	Reads the superblock of the open wrapped file and compares it with the container's layout.
+ * @return	1 if the superblock matches, 0 if the file has no superblock, -1 if it describes a different layout
+ */
+static int8_t containerReadSuperblock(CONTAINER_FILE_INFO *fileInfo) {
+    void *page = embedDBAlignedAlloc(fileInfo->pageSize, fileInfo->pageSize);
+    if (page == NULL)
+        return 0;
+    uint8_t expected[CONTAINER_SUPERBLOCK_SIZE];
+    containerEncodeSuperblock(fileInfo, expected);
+
+    int8_t result = 0;
+    if (fileInfo->baseInterface->read(page, 0, fileInfo->pageSize, fileInfo->baseFile) && memcmp(page, expected, sizeof(uint32_t)) == 0)
+        result = memcmp(page, expected, CONTAINER_SUPERBLOCK_SIZE) == 0 ? 1 : -1;
+    embedDBAlignedFree(page);
+    return result;
+}
+
+/**
+ * @brief	Writes the superblock to the first page of the open wrapped file.
+ * @return	1 for success and 0 for failure
+ */
+static int8_t containerWriteSuperblock(CONTAINER_FILE_INFO *fileInfo) {
+    void *page = embedDBAlignedAlloc(fileInfo->pageSize, fileInfo->pageSize);
+    if (page == NULL)
+        return 0;
+    memset(page, 0, fileInfo->pageSize);
+    containerEncodeSuperblock(fileInfo, page);
+    int8_t success = fileInfo->baseInterface->write(page, 0, fileInfo->pageSize, fileInfo->baseFile) && fileInfo->baseInterface->flush(fileInfo->baseFile);
+    embedDBAlignedFree(page);
+    fileInfo->unsynced = 1;
+    return success;
+}
+
+/**
+ * @brief	Returns 1 if every byte of the page is zero. Regions are not written in order, so pages of a region that were
+ * 			never written can lie before the end of the file and read as zeros.
+ */
+static int8_t containerPageIsEmpty(void *buffer, uint32_t pageSize) {
+    uint8_t *bytes = (uint8_t *)buffer;
+    for (uint32_t i = 0; i < pageSize; i++) {
+        if (bytes[i] != 0)
+            return 0;
+    }
+    return 1;
+}
+
+int8_t CONTAINER_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    if (pageNum >= region->numPages)
+        return 0;
+    if (!fileInfo->baseInterface->read(buffer, region->firstPage + pageNum, pageSize, fileInfo->baseFile))
+        return 0;
+    return !containerPageIsEmpty(buffer, pageSize);
+}
+
+uint32_t CONTAINER_READ_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    embedDBFileInterface *base = fileInfo->baseInterface;
+    if (pageNum >= region->numPages)
+        return 0;
+    if (numPages > region->numPages - pageNum)
+        numPages = region->numPages - pageNum;
+
+    uint32_t numRead;
+    if (base->readPages != NULL) {
+        numRead = base->readPages(buffers, region->firstPage + pageNum, numPages, pageSize, fileInfo->baseFile);
+    } else {
+        for (numRead = 0; numRead < numPages; numRead++) {
+            if (!base->read(buffers[numRead], region->firstPage + pageNum + numRead, pageSize, fileInfo->baseFile))
+                break;
+        }
+    }
+    for (uint32_t i = 0; i < numRead; i++) {
+        if (containerPageIsEmpty(buffers[i], pageSize))
+            return i;
+    }
+    return numRead;
+}
+
+int8_t CONTAINER_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    if (pageNum >= region->numPages) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Page %u is past the end of the container region.\n", pageNum);
+#endif
+        return 0;
+    }
+    fileInfo->unsynced = 1;
+    return fileInfo->baseInterface->write(buffer, region->firstPage + pageNum, pageSize, fileInfo->baseFile);
+}
+
+uint32_t CONTAINER_WRITE_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    embedDBFileInterface *base = fileInfo->baseInterface;
+    if (pageNum >= region->numPages)
+        return 0;
+    if (numPages > region->numPages - pageNum)
+        numPages = region->numPages - pageNum;
+
+    fileInfo->unsynced = 1;
+    if (base->writePages != NULL)
+        return base->writePages(buffers, region->firstPage + pageNum, numPages, pageSize, fileInfo->baseFile);
+    uint32_t numWritten;
+    for (numWritten = 0; numWritten < numPages; numWritten++) {
+        if (!base->write(buffers[numWritten], region->firstPage + pageNum + numWritten, pageSize, fileInfo->baseFile))
+            break;
+    }
+    return numWritten;
+}
+
+int8_t CONTAINER_FLUSH(void *file) {
+    CONTAINER_FILE_INFO *fileInfo = ((CONTAINER_REGION_INFO *)file)->container;
+    return fileInfo->baseInterface->flush(fileInfo->baseFile);
+}
+
+int8_t CONTAINER_SYNC(void *file) {
+    CONTAINER_FILE_INFO *fileInfo = ((CONTAINER_REGION_INFO *)file)->container;
+    /* All regions share the wrapped file, so a commit that syncs several regions only syncs it once */
+    if (!fileInfo->unsynced)
+        return 1;
+    int8_t success;
+    if (fileInfo->baseInterface->sync == NULL)
+        success = fileInfo->baseInterface->flush(fileInfo->baseFile);
+    else
+        success = fileInfo->baseInterface->sync(fileInfo->baseFile);
+    if (success)
+        fileInfo->unsynced = 0;
+    return success;
+}
+
+int8_t CONTAINER_PREALLOCATE(uint32_t numPages, uint32_t pageSize, void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    if (fileInfo->baseInterface->preallocate == NULL)
+        return 0;
+    /* Reserves the wrapped file up to the end of the region, which includes the regions before it */
+    return fileInfo->baseInterface->preallocate(region->firstPage + numPages, pageSize, fileInfo->baseFile);
+}
+
+int8_t CONTAINER_ERASE(uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    if (pageNum >= region->numPages)
+        return 0;
+    if (numPages > region->numPages - pageNum)
+        numPages = region->numPages - pageNum;
+    /* The old pages stay if the wrapped file cannot erase. Recovery handles them as it does for files that do not erase */
+    if (fileInfo->baseInterface->erase == NULL)
+        return 1;
+    fileInfo->unsynced = 1;
+    return fileInfo->baseInterface->erase(region->firstPage + pageNum, numPages, pageSize, fileInfo->baseFile);
+}
+
+int8_t CONTAINER_OPEN(void *file, uint8_t mode) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    if (region->isOpen)
+        return 1;
+
+    /* The first region opened opens the wrapped file. Later regions share it, so they never truncate it */
+    if (fileInfo->numOpen == 0) {
+        if (mode == EMBEDDB_FILE_MODE_W_PLUS_B && fileInfo->layoutMismatch) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Container file was created with a different layout. Not overwriting it.\n");
+#endif
+            return 0;
+        }
+        if (!fileInfo->baseInterface->open(fileInfo->baseFile, mode))
+            return 0;
+
+        int8_t result = mode == EMBEDDB_FILE_MODE_W_PLUS_B ? containerWriteSuperblock(fileInfo) : containerReadSuperblock(fileInfo);
+        if (result != 1) {
+            if (result == -1)
+                fileInfo->layoutMismatch = 1;
+            fileInfo->baseInterface->close(fileInfo->baseFile);
+            return 0;
+        }
+    }
+    region->isOpen = 1;
+    fileInfo->numOpen++;
+    return 1;
+}
+
+int8_t CONTAINER_CLOSE(void *file) {
+    CONTAINER_REGION_INFO *region = (CONTAINER_REGION_INFO *)file;
+    CONTAINER_FILE_INFO *fileInfo = region->container;
+    if (!region->isOpen)
+        return 1;
+    region->isOpen = 0;
+    fileInfo->numOpen--;
+    if (fileInfo->numOpen > 0)
+        return 1;
+    return fileInfo->baseInterface->close(fileInfo->baseFile);
+}
+
+uint32_t CONTAINER_BLOCK_SIZE(void *file) {
+    CONTAINER_FILE_INFO *fileInfo = ((CONTAINER_REGION_INFO *)file)->container;
+    if (fileInfo->baseInterface->blockSize == NULL)
+        return 0;
+    return fileInfo->baseInterface->blockSize(fileInfo->baseFile);
+}
+
+void tearDownContainerFile(void *container) {
+    CONTAINER_FILE_INFO *fileInfo = (CONTAINER_FILE_INFO *)container;
+    if (fileInfo->numOpen > 0)
+        fileInfo->baseInterface->close(fileInfo->baseFile);
+    free(container);
+}
+
+embedDBFileInterface *getContainerFileInterface() {
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
+    fileInterface->close = CONTAINER_CLOSE;
+    fileInterface->read = CONTAINER_READ;
+    fileInterface->write = CONTAINER_WRITE;
+    fileInterface->open = CONTAINER_OPEN;
+    fileInterface->flush = CONTAINER_FLUSH;
+    fileInterface->sync = CONTAINER_SYNC;
+    fileInterface->blockSize = CONTAINER_BLOCK_SIZE;
+    fileInterface->readPages = CONTAINER_READ_PAGES;
+    fileInterface->writePages = CONTAINER_WRITE_PAGES;
+    fileInterface->preallocate = CONTAINER_PREALLOCATE;
+    fileInterface->erase = CONTAINER_ERASE;
+    return fileInterface;
+}
@@ -0,0 +1,92 @@
+/******************************************************************************/
+/**
+ * @file        containerFileInterface.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB that stores the data, index and
+ *              variable data files as regions of one container file. A
+ *              superblock at the start of the file describes the regions.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#ifndef CONTAINER_FILE_INTERFACE_H_
+#define CONTAINER_FILE_INTERFACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "embedDB.h"
+
+/**
+ * @brief	Returns a file interface that maps the data, index and variable data files of embedDB onto regions of one
+ * 			wrapped file, so a single file (and file descriptor) serves all page I/O. The first erase block of the
+ * 			file holds a superblock with the page size, erase size and the first page and page count of each region.
+ * 			Pages past the end of a region, and pages that read as all zeros (never written), fail to read.
+ * 			Erase blocks are passed on to the wrapped file's erase, so numDataPages and numVarPages must be multiples of
+ * 			eraseSizeInPages.
+ * 			Files for this interface are the regions returned by getContainerRegion.
+ */
+embedDBFileInterface *getContainerFileInterface();
+
+/**
+ * @brief	Creates the container data for a wrapped file. Each region starts on an erase block boundary.
+ * @param	baseInterface		File interface of the wrapped file. Only its read, write, open, close and flush are required
+ * @param	baseFile			File data of the wrapped file (e.g. from setupFile or setupPosixFile)
+ * @param	pageSize			Size of a page in bytes. Must match embedDBState->pageSize
+ * @param	numDataPages		Number of pages in the data region. Must match embedDBState->numDataPages
+ * @param	numIndexPages		Number of pages in the index region, or 0 if the index is not used
+ * @param	numVarPages			Number of pages in the variable data region, or 0 if variable data is not used
+ * @param	eraseSizeInPages	Size of an erase block in pages. Must match embedDBState->eraseSizeInPages
+ * @return	Pointer to the container data, or NULL if memory could not be allocated
+ */
+void *setupContainerFile(embedDBFileInterface *baseInterface, void *baseFile, uint32_t pageSize, uint32_t numDataPages, uint32_t numIndexPages, uint32_t numVarPages, uint32_t eraseSizeInPages);
+
+/**
+ * @brief	Returns the file data for one region of a container, to be given to embedDB as its dataFile, indexFile or varFile.
+ * @param	container	Container data created by setupContainerFile
+ * @param	region		EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @return	Pointer to the region's file data, or NULL if region is not valid
+ */
+void *getContainerRegion(void *container, uint8_t region);
+
+/**
+ * @brief	Closes the wrapped file if any region is still open and frees the container data created by
+ * 			setupContainerFile. The wrapped file is not freed.
+ * @param	container	Container data created by setupContainerFile
+ */
+void tearDownContainerFile(void *container);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -47,34 +47,186 @@
 #include "../spline/spline.h"
 
 /**
- * 0 = Modified binary search
- * 1 = Binary serach
- * 2 = Modified linear search (Spline)
+ * Search method used by embedDBInit. Can be changed for each state with embedDBSetSearchMethod.
+ * 0 = Modified binary search (EMBEDDB_SEARCH_MODIFIED_BINARY)
+ * 1 = Binary serach (EMBEDDB_SEARCH_BINARY)
+ * 2 = Modified linear search (Spline) (EMBEDDB_SEARCH_SPLINE)
  */
 #define SEARCH_METHOD 2
 
 /**
- * Number of bits to be indexed by the Radix Search structure
+ * Number of bits to be indexed by the Radix Search structure used by embedDBInit
  * Note: The Radix search structure is only used with Spline (SEARCH_METHOD == 2) To use a pure Spline index without a Radix table, set RADIX_BITS to 0
  */
 #define RADIX_BITS 0
 
+/* Searches of a page for an unsigned key scan the remaining records once there are at most this many */
+#define EMBEDDB_SCAN_RECORDS 8
+
+/**
+ * @brief	Operations of a method for finding the data page holding a key. Only findPage is required
+ */
+struct embedDBSearchStrategy {
+    int8_t (*init)(embedDBState *state);                                 /* Allocates the search structure. Return 0 if success */
+    void (*add)(embedDBState *state, void *key, id_t pageId);            /* Adds the smallest key of a data page as it is written */
+    int8_t (*findPage)(embedDBState *state, void *key, int16_t *numReads); /* Reads the page that may hold the key into dataReadPage. Return 0 if success */
+    id_t (*firstPage)(embedDBState *state, void *key);                   /* Returns the lowest logical page that may hold the key */
+    uint32_t (*erase)(embedDBState *state, void *key);                   /* Removes entries for pages with keys below key after data is erased */
+    void (*print)(embedDBState *state);                                  /* Prints the search structure */
+    void (*close)(embedDBState *state);                                  /* Frees the search structure */
+};
+
 /* Helper Functions */
 int8_t embedDBInitData(embedDBState *state);
 int8_t embedDBInitDataFromFile(embedDBState *state);
 int8_t embedDBInitIndex(embedDBState *state);
 int8_t embedDBInitIndexFromFile(embedDBState *state);
+int8_t rebuildIndexEntries(embedDBState *state, id_t firstPageId);
 int8_t embedDBInitVarData(embedDBState *state);
 int8_t embedDBInitVarDataFromFile(embedDBState *state);
 void updateAverageKeyDifference(embedDBState *state, void *buffer);
-void embedDBInitSplineFromFile(embedDBState *state);
+double embedDBKeyScale(embedDBState *state, void *buffer);
 int32_t getMaxError(embedDBState *state, void *buffer);
 void updateMaxiumError(embedDBState *state, void *buffer);
-int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataStream **varData, id_t recordNumber);
+int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataStream **varData, void *dataPage, id_t recordNumber);
 uint32_t cleanSpline(embedDBState *state, void *key);
 void readToWriteBuf(embedDBState *state);
 void readToWriteBufVar(embedDBState *state);
 void embedDBFlushVar(embedDBState *state);
+int8_t embedDBFlushPartialPages(embedDBState *state);
+void *mapOrReadPage(embedDBState *state, void *file, id_t pageNum, uint8_t bufferNum);
+int8_t embedDBInitBufferPool(embedDBState *state);
+int8_t setupBufferPool(embedDBState *state, void *poolPages, uint32_t numPoolFrames);
+void embedDBFreeBufferPool(embedDBState *state);
+int8_t embedDBInitFiles(embedDBState *state);
+int8_t embedDBCheckBlockAlignment(embedDBState *state, void *file);
+void readWindowRun(embedDBState *state, id_t firstPageId, id_t lastPageId);
+void readPagesIntoPool(embedDBState *state, id_t *pageIds, uint32_t numPages);
+int8_t isDataPageBuffered(embedDBState *state, id_t pageNum);
+void *getPoolPage(embedDBState *state, uint32_t frameNum);
+int32_t findPoolFrame(embedDBState *state, uint8_t file, id_t pageNum);
+int32_t allocPoolFrame(embedDBState *state);
+void setReadPage(embedDBState *state, void **readPage, void *page);
+int8_t readBufferedPage(embedDBState *state, uint8_t file, id_t pageNum, uint8_t bufferNum, id_t *bufferedPageId, void **readPage);
+void invalidateBufferedPage(embedDBState *state, uint8_t file, id_t physicalPageId);
+int8_t readDataPageForScan(embedDBState *state, id_t pageId, id_t lastPageId);
+int8_t readIteratorPage(embedDBState *state, embedDBIterator *it);
+int8_t checkKeyOrder(embedDBState *state, void *keys, uint32_t numKeys);
+int8_t initSearchStrategy(embedDBState *state, int8_t searchMethod, uint8_t radixBits);
+int8_t modifiedBinarySearchFindPage(embedDBState *state, void *key, int16_t *numReads);
+int8_t binarySearchFindPage(embedDBState *state, void *key, int16_t *numReads);
+int8_t splineSearchInit(embedDBState *state);
+id_t searchNodeUnsigned(embedDBState *state, void *buffer, void *key, int8_t range);
+uint64_t unsignedKeyAt(embedDBState *state, void *buffer, int32_t recordNum);
+int32_t lowerBoundUint32(embedDBState *state, void *buffer, uint32_t key, int32_t low, int32_t high);
+int32_t lowerBoundUint64(embedDBState *state, void *buffer, uint64_t key, int32_t low, int32_t high);
+void splineSearchAdd(embedDBState *state, void *key, id_t pageId);
+int8_t splineSearchFindPage(embedDBState *state, void *key, int16_t *numReads);
+id_t splineSearchFirstPage(embedDBState *state, void *key);
+void splineSearchPrint(embedDBState *state);
+void splineSearchClose(embedDBState *state);
+void splineSearchLoad(embedDBState *state);
+void addDataPagesToSearch(embedDBState *state, id_t firstPageId, id_t endPageId);
+int8_t readSplineCheckpointSequence(embedDBState *state, uint32_t slot, uint32_t *sequence);
+int8_t restoreSplineCheckpoint(embedDBState *state, uint32_t slot, id_t *checkpointPageId);
+int8_t writeFullDataPage(embedDBState *state);
+int8_t putRecord(embedDBState *state, void *key, void *data);
+int8_t putVarRecord(embedDBState *state, void *key, void *data, void *variableData, uint32_t length);
+int8_t iteratorPageMayMatch(embedDBState *state, embedDBIterator *it, id_t pageId);
+int8_t embedDBSyncFile(embedDBState *state, void *file);
+int8_t embedDBCommitIfDue(embedDBState *state);
+id_t writePartialPage(embedDBState *state, void *buffer);
+id_t writePartialIndexPage(embedDBState *state, void *buffer);
+id_t writePartialVariablePage(embedDBState *state, void *buffer);
+void embedDBPreallocateFile(embedDBState *state, void *file, uint32_t numPages);
+void embedDBEraseBlock(embedDBState *state, void *file, id_t physicalPageId);
+int8_t readRecoveryPage(embedDBState *state, uint8_t file, id_t physicalPageId, int8_t readAhead);
+id_t recoveryPageId(embedDBState *state, uint8_t file);
+int8_t recoveryPageInRun(embedDBState *state, uint8_t file, id_t physicalPageId, id_t logicalPageId);
+id_t findEndOfRun(embedDBState *state, uint8_t file, id_t firstPhysicalPageId, id_t numPages, int8_t *endHasData);
+id_t findNextWrittenBlock(embedDBState *state, uint8_t file, id_t physicalPageId, id_t numPages);
+
+/**
+ * @brief	Compares two keys. Keys of a known type are compared inline so the insert, lookup and iterator loops do not
+ * 			call compareKey through a pointer for every record.
+ * @return	-1 if a is smaller than b, 0 if they are equal, 1 if a is larger
+ */
+static inline int8_t compareKeys(embedDBState *state, const void *a, const void *b) {
+    if (state->keyType == EMBEDDB_KEY_UINT32) {
+        uint32_t x, y;
+        memcpy(&x, a, sizeof(uint32_t));
+        memcpy(&y, b, sizeof(uint32_t));
+        return (int8_t)((x > y) - (x < y));
+    }
+    if (state->keyType == EMBEDDB_KEY_UINT64) {
+        uint64_t x, y;
+        memcpy(&x, a, sizeof(uint64_t));
+        memcpy(&y, b, sizeof(uint64_t));
+        return (int8_t)((x > y) - (x < y));
+    }
+    return state->compareKey((void *)a, (void *)b);
+}
+
+static int8_t uint32KeyComparator(void *a, void *b) {
+    uint32_t x, y;
+    memcpy(&x, a, sizeof(uint32_t));
+    memcpy(&y, b, sizeof(uint32_t));
+    return (int8_t)((x > y) - (x < y));
+}
+
+static int8_t uint64KeyComparator(void *a, void *b) {
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(uint64_t));
+    memcpy(&y, b, sizeof(uint64_t));
+    return (int8_t)((x > y) - (x < y));
+}
+
+/**
+ * @brief	Returns the comparator for code that takes one, such as the spline, so that it also skips compareKey for keys of
+ * 			a known type.
+ */
+static inline int8_t (*keyComparator(embedDBState *state))(void *, void *) {
+    if (state->keyType == EMBEDDB_KEY_UINT32)
+        return uint32KeyComparator;
+    if (state->keyType == EMBEDDB_KEY_UINT64)
+        return uint64KeyComparator;
+    return state->compareKey;
+}
+
+/**
+ * @brief	Compares the first data column of two records the same way compareKeys compares keys. See embedDBSetDataType.
+ * @return	-1 if a is smaller than b, 0 if they are equal, 1 if a is larger
+ */
+static inline int8_t compareDataValues(embedDBState *state, const void *a, const void *b) {
+    switch (state->dataType) {
+        case EMBEDDB_DATA_INT32: {
+            int32_t x, y;
+            memcpy(&x, a, sizeof(int32_t));
+            memcpy(&y, b, sizeof(int32_t));
+            return (int8_t)((x > y) - (x < y));
+        }
+        case EMBEDDB_DATA_UINT32: {
+            uint32_t x, y;
+            memcpy(&x, a, sizeof(uint32_t));
+            memcpy(&y, b, sizeof(uint32_t));
+            return (int8_t)((x > y) - (x < y));
+        }
+        case EMBEDDB_DATA_INT64: {
+            int64_t x, y;
+            memcpy(&x, a, sizeof(int64_t));
+            memcpy(&y, b, sizeof(int64_t));
+            return (int8_t)((x > y) - (x < y));
+        }
+        case EMBEDDB_DATA_UINT64: {
+            uint64_t x, y;
+            memcpy(&x, a, sizeof(uint64_t));
+            memcpy(&y, b, sizeof(uint64_t));
+            return (int8_t)((x > y) - (x < y));
+        }
+        default:
+            return state->compareData((void *)a, (void *)b);
+    }
+}
 
 void printBitmap(char *bm) {
     for (int8_t i = 0; i <= 7; i++) {
@@ -177,6 +329,16 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
         return -1;
     }
 
+    /* Keys are unsigned numbers, so keys of integer size are compared without compareKey unless set otherwise */
+    if (state->keySize == 4) {
+        state->keyType = EMBEDDB_KEY_UINT32;
+    } else if (state->keySize == 8) {
+        state->keyType = EMBEDDB_KEY_UINT64;
+    } else {
+        state->keyType = EMBEDDB_KEY_CUSTOM;
+    }
+    state->dataType = EMBEDDB_DATA_CUSTOM;
+
     state->recordSize = state->keySize + state->dataSize;
     if (EMBEDDB_USING_VDATA(state->parameters)) {
         state->recordSize += 4;
@@ -196,15 +358,34 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
 
     /* Flags to show that these values have not been initalized with actual data yet */
     state->minKey = UINT32_MAX;
+    state->maxKey = 0;
     state->bufferedPageId = -1;
     state->bufferedIndexPageId = -1;
     state->bufferedVarPage = -1;
+    state->dataReadPage = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+    state->indexReadPage = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
+    state->varReadPage = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    state->indexCache = NULL;
+    state->varBlockMaxKeys = NULL;
+    state->splineRecoveredPageId = 0;
+    state->splineFile = NULL;
+    state->splineCheckpointPage = NULL;
+
+    /* Only commit when asked until a durability policy is set */
+    state->syncEveryPages = 0;
+    state->syncIntervalMs = 0;
+    state->currentTimeMs = NULL;
+    state->lastSyncTime = 0;
+    state->numUnsyncedPages = 0;
+    state->unsyncedFiles = 0;
+    state->numSyncs = 0;
+    state->partialPagesWritten = 0;
 
     /* Calculate number of records per page */
     state->maxRecordsPerPage = (state->pageSize - state->headerSize) / state->recordSize;
 
-    /* Initialize max error to maximum records per page */
-    state->maxError = state->maxRecordsPerPage;
+    /* Max error grows as pages are written */
+    state->maxError = 0;
 
     /* Allocate first page of buffer as output page */
     initBufferPage(state, 0);
@@ -216,24 +397,44 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
         return -1;
     }
 
-    /* Initalize the spline or radix spline structure if either are to be used */
-    if (SEARCH_METHOD == 2) {
-        state->cleanSpline = 1;
-        int8_t splineInitResult = 0;
-        if (RADIX_BITS > 0) {
-            splineInitResult = initRadixSpline(state, RADIX_BITS);
+    /* Recovery looks for data after erased pages at the start of the next erase block */
+    if (state->fileInterface->erase != NULL && (state->numDataPages % state->eraseSizeInPages != 0 || (EMBEDDB_USING_VDATA(state->parameters) && state->numVarPages % state->eraseSizeInPages != 0))) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Data and variable data space must be a multiple of erase block size when the file interface erases pages.\n");
+#endif
+        return -1;
+    }
 
-        } else {
-            state->spl = malloc(sizeof(spline));
-            splineInitResult = splineInit(state->spl, state->numSplinePoints, indexMaxError, state->keySize);
-        }
-        if (splineInitResult == -1) {
+    if (embedDBInitBufferPool(state) != 0) {
 #ifdef PRINT_ERRORS
-            printf("ERROR: Failed to initialize spline.");
+        printf("ERROR: Failed to allocate buffer pool.\n");
 #endif
-            return -1;
-        }
+        return -1;
+    }
+
+    /* embedDBClose is not called after a failed init, so what was allocated is freed here */
+    int8_t result = embedDBInitFiles(state);
+    if (result != 0) {
+        embedDBFreeBufferPool(state);
+        free(state->indexCache);
+        state->indexCache = NULL;
+        if (state->searchStrategy != NULL && state->searchStrategy->close != NULL)
+            state->searchStrategy->close(state);
+        state->searchStrategy = NULL;
     }
+    return result;
+}
+
+/**
+ * @brief	Sets up the search structure and opens or recovers the data, index and variable data files. Part of embedDBInit.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBInitFiles(embedDBState *state) {
+    /* Initalize the spline or radix spline structure if either are to be used */
+    state->searchStrategy = NULL;
+    if (initSearchStrategy(state, SEARCH_METHOD, RADIX_BITS) != 0)
+        return -1;
 
     /* Allocate file for data*/
     int8_t dataInitResult = 0;
@@ -242,6 +443,7 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
     if (dataInitResult != 0) {
         return dataInitResult;
     }
+    embedDBPreallocateFile(state, state->dataFile, state->numDataPages);
 
     /* Allocate file and buffer for index */
     int8_t indexInitResult = 0;
@@ -262,6 +464,8 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
     if (indexInitResult != 0) {
         return indexInitResult;
     }
+    if (EMBEDDB_USING_INDEX(state->parameters))
+        embedDBPreallocateFile(state, state->indexFile, state->numIndexPages);
 
     /* Allocate file and buffer for variable data */
     int8_t varDataInitResult = 0;
@@ -274,6 +478,8 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
         } else {
             varDataInitResult = embedDBInitVarData(state);
         }
+        if (varDataInitResult == 0)
+            embedDBPreallocateFile(state, state->varFile, state->numVarPages);
         return varDataInitResult;
     } else {
         state->varFile = NULL;
@@ -284,6 +490,154 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
     return 0;
 }
 
+/**
+ * @brief	Uses any buffer pages beyond the ones embedDB requires as a buffer pool shared by the data, index and variable
+ * 			data files. Pages read from storage are kept in the pool and replaced with the CLOCK algorithm, so pages that
+ * 			are used again are not read again. If the file interface can read several pages at once (readPages, or
+ * 			readAsync and waitAsync), runs of data pages are read into the pool together. embedDBSetBufferPoolSize
+ * 			replaces these pages with a pool of any size.
+ * 			Not used if the file interface maps pages since they are not copied.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBInitBufferPool(embedDBState *state) {
+    uint8_t numRequiredPages = 2 + (EMBEDDB_USING_INDEX(state->parameters) ? 2 : 0) + (EMBEDDB_USING_VDATA(state->parameters) ? 2 : 0);
+    state->poolPages = NULL;
+    state->poolAllocation = NULL;
+    state->poolFrames = NULL;
+    state->windowPageIds = NULL;
+    state->windowScratch = NULL;
+    state->numPoolFrames = 0;
+    state->poolClockHand = 0;
+    state->numWindowPages = 0;
+    if (state->fileInterface->mapPage != NULL || state->bufferSizeInBlocks <= numRequiredPages)
+        return 0;
+
+    return setupBufferPool(state, (int8_t *)state->buffer + state->pageSize * numRequiredPages, state->bufferSizeInBlocks - numRequiredPages);
+}
+
+/**
+ * @brief	Makes a set of pages the buffer pool. The pool is freed if its frames cannot be allocated.
+ * @param	state			embedDB algorithm state structure
+ * @param	poolPages		First of the pool's pages
+ * @param	numPoolFrames	Number of pages in the pool
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t setupBufferPool(embedDBState *state, void *poolPages, uint32_t numPoolFrames) {
+    state->poolFrames = malloc(numPoolFrames * sizeof(embedDBBufferFrame));
+    if (state->poolFrames == NULL) {
+        embedDBFreeBufferPool(state);
+        return -1;
+    }
+    for (uint32_t i = 0; i < numPoolFrames; i++) {
+        state->poolFrames[i].pageId = -1;
+        state->poolFrames[i].file = 0;
+        state->poolFrames[i].referenced = 0;
+        state->poolFrames[i].pinCount = 0;
+    }
+    state->poolPages = poolPages;
+    state->numPoolFrames = numPoolFrames;
+    state->poolClockHand = 0;
+
+    int8_t canReadRuns = state->fileInterface->readPages != NULL || (state->fileInterface->readAsync != NULL && state->fileInterface->waitAsync != NULL);
+    if (canReadRuns) {
+        /* The page list of a window read and the buffers, frames, order and results readPagesIntoPool keeps for each page */
+        state->windowPageIds = malloc(numPoolFrames * sizeof(id_t));
+        state->windowScratch = malloc(numPoolFrames * (sizeof(void *) + 2 * sizeof(uint32_t) + sizeof(int8_t)));
+        if (state->windowPageIds == NULL || state->windowScratch == NULL) {
+            embedDBFreeBufferPool(state);
+            return -1;
+        }
+        state->numWindowPages = numPoolFrames;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Frees the buffer pool's frames, and its pages if they were allocated by embedDBSetBufferPoolSize rather than
+ * 			being part of the embedDB buffer.
+ * @param	state	embedDB algorithm state structure
+ */
+void embedDBFreeBufferPool(embedDBState *state) {
+    free(state->poolFrames);
+    free(state->windowPageIds);
+    free(state->windowScratch);
+    if (state->poolAllocation != NULL)
+        embedDBAlignedFree(state->poolAllocation);
+    state->poolPages = NULL;
+    state->poolAllocation = NULL;
+    state->poolFrames = NULL;
+    state->windowPageIds = NULL;
+    state->windowScratch = NULL;
+    state->numPoolFrames = 0;
+    state->poolClockHand = 0;
+    state->numWindowPages = 0;
+}
+
+/**
+ * @brief	Sets the number of pages in the buffer pool.
+ * @param	state			embedDB algorithm state structure
+ * @param	numPoolPages	Number of pages in the pool. 0 to use the embedDB buffer's spare pages
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBSetBufferPoolSize(embedDBState *state, uint32_t numPoolPages) {
+    /* The read pages may be pool pages, so they go back to the read buffers before the pool is freed */
+    state->bufferedPageId = -1;
+    state->bufferedIndexPageId = -1;
+    state->bufferedVarPage = -1;
+    state->dataReadPage = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+    state->indexReadPage = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
+    state->varReadPage = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    embedDBFreeBufferPool(state);
+
+    if (numPoolPages == 0)
+        return embedDBInitBufferPool(state);
+    if (state->fileInterface->mapPage != NULL)
+        return 0;
+
+    /* Pool pages are read by the file interface like the read buffers, so they meet the same alignment */
+    uint32_t blockSize = state->fileInterface->blockSize != NULL ? state->fileInterface->blockSize(state->dataFile) : 0;
+    state->poolAllocation = embedDBAlignedAlloc(blockSize > 1 ? blockSize : sizeof(void *), (size_t)numPoolPages * state->pageSize);
+    if (state->poolAllocation == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate buffer pool of %d pages.\n", numPoolPages);
+#endif
+        return -1;
+    }
+    return setupBufferPool(state, state->poolAllocation, numPoolPages);
+}
+
+/**
+ * @brief	Checks that the page size and buffer meet the alignment the file needs if it bypasses the operating system cache.
+ * @param	state	embedDB algorithm state structure
+ * @param	file	Open file to check
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBCheckBlockAlignment(embedDBState *state, void *file) {
+    if (state->fileInterface->blockSize == NULL)
+        return 0;
+
+    uint32_t blockSize = state->fileInterface->blockSize(file);
+    if (blockSize <= 1)
+        return 0;
+
+    if (state->pageSize % blockSize != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Page size (%d) must be a multiple of the storage block size (%d).\n", state->pageSize, blockSize);
+#endif
+        return -1;
+    }
+
+    if ((uintptr_t)state->buffer % blockSize != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Buffer must be aligned to the storage block size (%d). Allocate it with embedDBAlignedAlloc.\n", blockSize);
+#endif
+        return -1;
+    }
+
+    return 0;
+}
+
 int8_t embedDBInitData(embedDBState *state) {
     state->nextDataPageId = 0;
     state->avgKeyDiff = 1;
@@ -302,6 +656,8 @@ int8_t embedDBInitData(embedDBState *state) {
     if (!EMBEDDB_RESETING_DATA(state->parameters)) {
         int8_t openStatus = state->fileInterface->open(state->dataFile, EMBEDDB_FILE_MODE_R_PLUS_B);
         if (openStatus) {
+            if (embedDBCheckBlockAlignment(state, state->dataFile) != 0)
+                return -1;
             return embedDBInitDataFromFile(state);
         }
     }
@@ -314,44 +670,54 @@ int8_t embedDBInitData(embedDBState *state) {
         return -1;
     }
 
-    return 0;
+    return embedDBCheckBlockAlignment(state, state->dataFile);
 }
 
 int8_t embedDBInitDataFromFile(embedDBState *state) {
     id_t logicalPageId = 0;
-    id_t maxLogicalPageId = 0;
     id_t physicalPageId = 0;
 
     /* This will become zero if there is no more to read */
-    int8_t moreToRead = !(readPage(state, physicalPageId));
+    int8_t moreToRead = !(readRecoveryPage(state, EMBEDDB_DATA_FILE, physicalPageId, 0));
 
-    bool haveWrappedInMemory = false;
-    int count = 0;
-    void *buffer = (int8_t *)state->buffer + state->pageSize;
-    while (moreToRead && count < state->numDataPages) {
-        memcpy(&logicalPageId, buffer, sizeof(id_t));
-        if (count == 0 || logicalPageId == maxLogicalPageId + 1) {
-            maxLogicalPageId = logicalPageId;
-            physicalPageId++;
-            updateMaxiumError(state, buffer);
-            moreToRead = !(readPage(state, physicalPageId));
-            count++;
-        } else {
-            haveWrappedInMemory = logicalPageId == (maxLogicalPageId - state->numDataPages + 1);
-            break;
-        }
+    /* The first erase block was erased but not written again, so the data starts at a later block */
+    if (!moreToRead) {
+        physicalPageId = findNextWrittenBlock(state, EMBEDDB_DATA_FILE, 1, state->numDataPages);
+        moreToRead = physicalPageId < state->numDataPages;
     }
 
-    if (count == 0)
+    if (!moreToRead)
         return 0;
 
+    id_t firstPhysicalPageId = physicalPageId;
+    id_t firstLogicalPageId = recoveryPageId(state, EMBEDDB_DATA_FILE);
+    updateMaxiumError(state, state->dataReadPage);
+    physicalPageId = findEndOfRun(state, EMBEDDB_DATA_FILE, firstPhysicalPageId, state->numDataPages, &moreToRead);
+    id_t maxLogicalPageId = firstLogicalPageId + (physicalPageId - 1 - firstPhysicalPageId);
+
+    bool haveWrappedInMemory = false;
+    if (moreToRead) {
+        memcpy(&logicalPageId, state->dataReadPage, sizeof(id_t));
+        haveWrappedInMemory = logicalPageId == (maxLogicalPageId - state->numDataPages + 1);
+    }
+
+    /* Pages after the newest page were erased. The oldest data starts at the next erase block that was not */
+    if (!moreToRead && physicalPageId < state->numDataPages) {
+        id_t nextWrittenPageId = findNextWrittenBlock(state, EMBEDDB_DATA_FILE, physicalPageId, state->numDataPages);
+        if (nextWrittenPageId < state->numDataPages) {
+            memcpy(&logicalPageId, state->dataReadPage, sizeof(id_t));
+            haveWrappedInMemory = logicalPageId == maxLogicalPageId + 1 + nextWrittenPageId - physicalPageId - state->numDataPages;
+        }
+    }
+
     state->nextDataPageId = maxLogicalPageId + 1;
     state->minDataPageId = 0;
-    id_t physicalPageIDOfSmallestData = 0;
+    id_t physicalPageIDOfSmallestData = firstPhysicalPageId;
     if (haveWrappedInMemory) {
         physicalPageIDOfSmallestData = logicalPageId % state->numDataPages;
     }
     readPage(state, physicalPageIDOfSmallestData);
+    void *buffer = state->dataReadPage;
     memcpy(&(state->minDataPageId), buffer, sizeof(id_t));
     state->numAvailDataPages = state->numDataPages + state->minDataPageId - maxLogicalPageId - 1;
     if (state->keySize <= 4) {
@@ -365,30 +731,125 @@ int8_t embedDBInitDataFromFile(embedDBState *state) {
     }
 
     /* Put largest key back into the buffer */
-    readPage(state, state->nextDataPageId - 1);
+    readPage(state, (state->nextDataPageId - 1) % state->numDataPages);
+    memcpy(&state->maxKey, embedDBGetMaxKey(state, state->dataReadPage), state->keySize);
 
-    updateAverageKeyDifference(state, buffer);
-    if (SEARCH_METHOD == 2) {
-        embedDBInitSplineFromFile(state);
+    updateAverageKeyDifference(state, state->dataReadPage);
+
+    /* Keep adding records to the last page if it was flushed before it was full */
+    if (EMBEDDB_REWRITING_PARTIAL_PAGES(state->parameters) && EMBEDDB_GET_COUNT(state->dataReadPage) < state->maxRecordsPerPage) {
+        memcpy(state->buffer, state->dataReadPage, state->pageSize);
+        state->nextDataPageId--;
+        state->partialPagesWritten |= EMBEDDB_DATA_FILE;
     }
 
+    /* The spline is built from these pages when it is first used, unless embedDBSetSplineCheckpoint restores it first */
+    state->splineRecoveredPageId = state->nextDataPageId;
+
     return 0;
 }
 
-void embedDBInitSplineFromFile(embedDBState *state) {
-    id_t pageNumberToRead = state->minDataPageId;
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
-    id_t pagesRead = 0;
-    id_t numberOfPagesToRead = state->nextDataPageId - state->minDataPageId;
-    while (pagesRead < numberOfPagesToRead) {
-        readPage(state, pageNumberToRead % state->numDataPages);
-        if (RADIX_BITS > 0) {
-            radixsplineAddPoint(state->rdix, embedDBGetMinKey(state, buffer), pageNumberToRead++);
-        } else {
-            splineAdd(state->spl, embedDBGetMinKey(state, buffer), pageNumberToRead++);
-        }
-        pagesRead++;
+/**
+ * @brief	Adds the data pages from firstPageId up to endPageId to the search structure, reading each of them.
+ * @param	state		embedDB algorithm state structure
+ * @param	firstPageId	Logical id of the first page to add
+ * @param	endPageId	Logical id of the page after the last page to add
+ */
+void addDataPagesToSearch(embedDBState *state, id_t firstPageId, id_t endPageId) {
+    if (state->searchStrategy->add == NULL)
+        return;
+
+    for (id_t pageId = firstPageId; pageId < endPageId; pageId++) {
+        readDataPageForScan(state, pageId, endPageId - 1);
+        updateMaxiumError(state, state->dataReadPage);
+        state->searchStrategy->add(state, embedDBGetMinKey(state, state->dataReadPage), pageId);
+    }
+}
+
+struct embedDBSearchStrategy modifiedBinarySearchStrategy = {NULL, NULL, modifiedBinarySearchFindPage, NULL, NULL, NULL, NULL};
+struct embedDBSearchStrategy binarySearchStrategy = {NULL, NULL, binarySearchFindPage, NULL, NULL, NULL, NULL};
+struct embedDBSearchStrategy splineSearchStrategy = {splineSearchInit, splineSearchAdd, splineSearchFindPage, splineSearchFirstPage, cleanSpline, splineSearchPrint, splineSearchClose};
+
+/**
+ * @brief	Selects the search method of the state and allocates its search structure. Does not add existing pages.
+ * @param	state			embedDB algorithm state structure
+ * @param	searchMethod	EMBEDDB_SEARCH_MODIFIED_BINARY, EMBEDDB_SEARCH_BINARY or EMBEDDB_SEARCH_SPLINE
+ * @param	radixBits		Number of bits indexed by a radix table over the spline. 0 for no radix table
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t initSearchStrategy(embedDBState *state, int8_t searchMethod, uint8_t radixBits) {
+    state->spl = NULL;
+    state->rdix = NULL;
+    state->radixBits = searchMethod == EMBEDDB_SEARCH_SPLINE ? radixBits : 0;
+    if (searchMethod == EMBEDDB_SEARCH_MODIFIED_BINARY) {
+        state->searchStrategy = &modifiedBinarySearchStrategy;
+    } else if (searchMethod == EMBEDDB_SEARCH_BINARY) {
+        state->searchStrategy = &binarySearchStrategy;
+    } else if (searchMethod == EMBEDDB_SEARCH_SPLINE) {
+        state->searchStrategy = &splineSearchStrategy;
+    } else {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Unknown search method %d.\n", searchMethod);
+#endif
+        return -1;
+    }
+
+    if (state->searchStrategy->init != NULL && state->searchStrategy->init(state) != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to initialize spline.");
+#endif
+        /* Leave the state with a search method that needs no memory */
+        state->searchStrategy = &binarySearchStrategy;
+        return -1;
+    }
+    return 0;
+}
+
+int8_t embedDBSetKeyType(embedDBState *state, int8_t keyType) {
+    if ((keyType == EMBEDDB_KEY_UINT32 && state->keySize != 4) || (keyType == EMBEDDB_KEY_UINT64 && state->keySize != 8) ||
+        keyType < EMBEDDB_KEY_CUSTOM || keyType > EMBEDDB_KEY_UINT64) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Key type %d does not match key size %d.\n", keyType, state->keySize);
+#endif
+        return -1;
+    }
+    state->keyType = keyType;
+    return 0;
+}
+
+int8_t embedDBSetDataType(embedDBState *state, int8_t dataType) {
+    int8_t typeSize = dataType == EMBEDDB_DATA_INT64 || dataType == EMBEDDB_DATA_UINT64 ? 8 : 4;
+    if (dataType < EMBEDDB_DATA_CUSTOM || dataType > EMBEDDB_DATA_UINT64 || (dataType != EMBEDDB_DATA_CUSTOM && state->dataSize < typeSize)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Data type %d does not fit in data size %d.\n", dataType, state->dataSize);
+#endif
+        return -1;
+    }
+    state->dataType = dataType;
+    return 0;
+}
+
+int8_t embedDBSetSearchMethod(embedDBState *state, int8_t searchMethod, uint8_t radixBits) {
+    if (searchMethod == EMBEDDB_SEARCH_SPLINE && radixBits >= 32) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Radix table can index at most 31 bits.\n");
+#endif
+        return -1;
     }
+    if (searchMethod < EMBEDDB_SEARCH_MODIFIED_BINARY || searchMethod > EMBEDDB_SEARCH_SPLINE) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Unknown search method %d.\n", searchMethod);
+#endif
+        return -1;
+    }
+
+    if (state->searchStrategy->close != NULL)
+        state->searchStrategy->close(state);
+    if (initSearchStrategy(state, searchMethod, radixBits) != 0)
+        return -1;
+    /* The pages already on storage are added when the new search structure is first used */
+    state->splineRecoveredPageId = state->nextDataPageId;
+    return 0;
 }
 
 int8_t embedDBInitIndex(embedDBState *state) {
@@ -433,6 +894,8 @@ int8_t embedDBInitIndex(embedDBState *state) {
     if (!EMBEDDB_RESETING_DATA(state->parameters)) {
         int8_t openStatus = state->fileInterface->open(state->indexFile, EMBEDDB_FILE_MODE_R_PLUS_B);
         if (openStatus) {
+            if (embedDBCheckBlockAlignment(state, state->indexFile) != 0)
+                return -1;
             return embedDBInitIndexFromFile(state);
         }
     }
@@ -445,46 +908,113 @@ int8_t embedDBInitIndex(embedDBState *state) {
         return -1;
     }
 
-    return 0;
+    if (embedDBCheckBlockAlignment(state, state->indexFile) != 0)
+        return -1;
+    return EMBEDDB_CACHING_INDEX(state->parameters) ? embedDBCacheIndex(state) : 0;
 }
 
 int8_t embedDBInitIndexFromFile(embedDBState *state) {
     id_t logicalIndexPageId = 0;
-    id_t maxLogicaIndexPageId = 0;
     id_t physicalIndexPageId = 0;
 
     /* This will become zero if there is no more to read */
-    int8_t moreToRead = !(readIndexPage(state, physicalIndexPageId));
+    int8_t moreToRead = !(readRecoveryPage(state, EMBEDDB_INDEX_FILE, physicalIndexPageId, 0));
+
+    /* The first erase block was erased but not written again, so the index starts at a later block */
+    if (!moreToRead) {
+        physicalIndexPageId = findNextWrittenBlock(state, EMBEDDB_INDEX_FILE, 1, state->numIndexPages);
+        moreToRead = physicalIndexPageId < state->numIndexPages;
+    }
+
+    if (!moreToRead)
+        return EMBEDDB_CACHING_INDEX(state->parameters) ? embedDBCacheIndex(state) : 0;
+
+    id_t firstPhysicalIndexPageId = physicalIndexPageId;
+    id_t firstLogicalIndexPageId = recoveryPageId(state, EMBEDDB_INDEX_FILE);
+    physicalIndexPageId = findEndOfRun(state, EMBEDDB_INDEX_FILE, firstPhysicalIndexPageId, state->numIndexPages, &moreToRead);
+    id_t maxLogicaIndexPageId = firstLogicalIndexPageId + (physicalIndexPageId - 1 - firstPhysicalIndexPageId);
 
     bool haveWrappedInMemory = false;
-    int count = 0;
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
-
-    while (moreToRead && count < state->numIndexPages) {
-        memcpy(&logicalIndexPageId, buffer, sizeof(id_t));
-        if (count == 0 || logicalIndexPageId == maxLogicaIndexPageId + 1) {
-            maxLogicaIndexPageId = logicalIndexPageId;
-            physicalIndexPageId++;
-            moreToRead = !(readIndexPage(state, physicalIndexPageId));
-            count++;
-        } else {
-            haveWrappedInMemory = logicalIndexPageId == maxLogicaIndexPageId - state->numIndexPages + 1;
-            break;
-        }
+    if (moreToRead) {
+        memcpy(&logicalIndexPageId, state->indexReadPage, sizeof(id_t));
+        haveWrappedInMemory = logicalIndexPageId == maxLogicaIndexPageId - state->numIndexPages + 1;
     }
 
-    if (count == 0)
-        return 0;
+    /* Pages after the newest page were erased. The oldest entries start at the next erase block that was not */
+    if (!moreToRead && physicalIndexPageId < state->numIndexPages) {
+        id_t nextWrittenPageId = findNextWrittenBlock(state, EMBEDDB_INDEX_FILE, physicalIndexPageId, state->numIndexPages);
+        if (nextWrittenPageId < state->numIndexPages) {
+            memcpy(&logicalIndexPageId, state->indexReadPage, sizeof(id_t));
+            haveWrappedInMemory = logicalIndexPageId == maxLogicaIndexPageId + 1 + nextWrittenPageId - physicalIndexPageId - state->numIndexPages;
+        }
+    }
 
     state->nextIdxPageId = maxLogicaIndexPageId + 1;
-    id_t physicalPageIDOfSmallestData = 0;
+    id_t physicalPageIDOfSmallestData = firstPhysicalIndexPageId;
     if (haveWrappedInMemory) {
         physicalPageIDOfSmallestData = logicalIndexPageId % state->numIndexPages;
     }
     readIndexPage(state, physicalPageIDOfSmallestData);
-    memcpy(&(state->minIndexPageId), buffer, sizeof(id_t));
+    memcpy(&(state->minIndexPageId), state->indexReadPage, sizeof(id_t));
     state->numAvailIndexPages = state->numIndexPages + state->minIndexPageId - maxLogicaIndexPageId - 1;
 
+    /* Keep adding entries to the last index page */
+    if (EMBEDDB_REWRITING_PARTIAL_PAGES(state->parameters) && readIndexPage(state, maxLogicaIndexPageId % state->numIndexPages) == 0) {
+        void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
+        memcpy(buf, state->indexReadPage, state->pageSize);
+        state->nextIdxPageId--;
+        state->partialPagesWritten |= EMBEDDB_INDEX_FILE;
+
+        /* A crash can leave the entries on storage out of step with the data pages. The last entry may have been saved
+           while its data page was partial, and entries for full data pages may not have been saved at all. The full data
+           pages after the index page's first data page each have an entry, and the last saved one and any missing ones
+           are rebuilt from the bitmaps of the data pages */
+        id_t firstDataPageId = 0;
+        memcpy(&firstDataPageId, (int8_t *)buf + 8, sizeof(id_t));
+        id_t numEntries = state->nextDataPageId > firstDataPageId ? state->nextDataPageId - firstDataPageId : 0;
+        count_t idxcount = min(EMBEDDB_GET_COUNT(buf), numEntries);
+        if (idxcount > 0)
+            idxcount--;
+        EMBEDDB_GET_COUNT(buf) = idxcount;
+        if (rebuildIndexEntries(state, firstDataPageId + idxcount) != 0)
+            return -1;
+    }
+
+    /* The live index pages are known now, so they are loaded into the cache */
+    if (EMBEDDB_CACHING_INDEX(state->parameters))
+        return embedDBCacheIndex(state);
+    return 0;
+}
+
+/**
+ * @brief	Adds index entries for the full data pages from a page up to nextDataPageId to the index write buffer, copying
+ * 			the bitmap in each data page's header. Index pages that fill up are written.
+ * @param	state		embedDB algorithm state structure
+ * @param	firstPageId	Logical id of the first data page to add
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t rebuildIndexEntries(embedDBState *state, id_t firstPageId) {
+    void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
+    for (id_t pageId = firstPageId; pageId < state->nextDataPageId; pageId++) {
+        count_t idxcount = EMBEDDB_GET_COUNT(buf);
+        if (idxcount >= state->maxIdxRecordsPerPage) {
+            if (writeIndexPage(state, buf) == (id_t)-1)
+                return -1;
+            idxcount = 0;
+            initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
+            id_t *ptr = (id_t *)((int8_t *)buf + 8);
+            *ptr = pageId;
+        }
+
+        if (readPage(state, pageId % state->numDataPages) != 0) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to read data page %i to rebuild its index entry.\n", pageId);
+#endif
+            return -1;
+        }
+        memcpy((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount, EMBEDDB_GET_BITMAP(state->dataReadPage), state->bitmapSize);
+        EMBEDDB_INC_COUNT(buf);
+    }
     return 0;
 }
 
@@ -498,10 +1028,27 @@ int8_t embedDBInitVarData(embedDBState *state) {
     state->numAvailVarPages = state->numVarPages;
     state->nextVarPageId = 0;
 
+    /* Remember the largest key of each erase block so that erasing a block does not have to read it */
+    uint32_t numVarBlocks = (state->numVarPages + state->eraseSizeInPages - 1) / state->eraseSizeInPages;
+    state->varBlockMaxKeys = malloc((size_t)numVarBlocks * state->keySize);
+    if (state->varBlockMaxKeys == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the variable data block keys.\n");
+#endif
+        return -1;
+    }
+    state->varBlockKeysFromPageId = 0;
+
     if (!EMBEDDB_RESETING_DATA(state->parameters)) {
         int8_t openResult = state->fileInterface->open(state->varFile, EMBEDDB_FILE_MODE_R_PLUS_B);
         if (openResult) {
-            return embedDBInitVarDataFromFile(state);
+            if (embedDBCheckBlockAlignment(state, state->varFile) != 0)
+                return -1;
+            if (embedDBInitVarDataFromFile(state) != 0)
+                return -1;
+            /* Blocks are only known once they have been written again */
+            state->varBlockKeysFromPageId = state->nextVarPageId;
+            return 0;
         }
     }
 
@@ -513,40 +1060,50 @@ int8_t embedDBInitVarData(embedDBState *state) {
         return -1;
     }
 
-    return 0;
+    return embedDBCheckBlockAlignment(state, state->varFile);
 }
 
 int8_t embedDBInitVarDataFromFile(embedDBState *state) {
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
     id_t logicalVariablePageId = 0;
-    id_t maxLogicalVariablePageId = 0;
     id_t physicalVariablePageId = 0;
-    int8_t moreToRead = !(readVariablePage(state, physicalVariablePageId));
-    uint32_t count = 0;
-    bool haveWrappedInMemory = false;
-    while (moreToRead && count < state->numVarPages) {
-        memcpy(&logicalVariablePageId, buffer, sizeof(id_t));
-        if (count == 0 || logicalVariablePageId == maxLogicalVariablePageId + 1) {
-            maxLogicalVariablePageId = logicalVariablePageId;
-            physicalVariablePageId++;
-            moreToRead = !(readVariablePage(state, physicalVariablePageId));
-            count++;
-        } else {
-            haveWrappedInMemory = logicalVariablePageId == maxLogicalVariablePageId - state->numVarPages + 1;
-            break;
-        }
+    int8_t moreToRead = !(readRecoveryPage(state, EMBEDDB_VAR_FILE, physicalVariablePageId, 0));
+
+    /* The first erase block was erased but not written again, so the data starts at a later block */
+    if (!moreToRead) {
+        physicalVariablePageId = findNextWrittenBlock(state, EMBEDDB_VAR_FILE, 1, state->numVarPages);
+        moreToRead = physicalVariablePageId < state->numVarPages;
     }
 
-    if (count == 0)
+    if (!moreToRead)
         return 0;
 
+    id_t firstPhysicalVariablePageId = physicalVariablePageId;
+    id_t firstLogicalVariablePageId = recoveryPageId(state, EMBEDDB_VAR_FILE);
+    physicalVariablePageId = findEndOfRun(state, EMBEDDB_VAR_FILE, firstPhysicalVariablePageId, state->numVarPages, &moreToRead);
+    id_t maxLogicalVariablePageId = firstLogicalVariablePageId + (physicalVariablePageId - 1 - firstPhysicalVariablePageId);
+
+    bool haveWrappedInMemory = false;
+    if (moreToRead) {
+        memcpy(&logicalVariablePageId, state->varReadPage, sizeof(id_t));
+        haveWrappedInMemory = logicalVariablePageId == maxLogicalVariablePageId - state->numVarPages + 1;
+    }
+
+    /* Pages after the newest page were erased. The oldest data starts at the next erase block that was not */
+    if (!moreToRead && physicalVariablePageId < state->numVarPages) {
+        id_t nextWrittenPageId = findNextWrittenBlock(state, EMBEDDB_VAR_FILE, physicalVariablePageId, state->numVarPages);
+        if (nextWrittenPageId < state->numVarPages) {
+            memcpy(&logicalVariablePageId, state->varReadPage, sizeof(id_t));
+            haveWrappedInMemory = logicalVariablePageId == maxLogicalVariablePageId + 1 + nextWrittenPageId - physicalVariablePageId - state->numVarPages;
+        }
+    }
+
     state->nextVarPageId = maxLogicalVariablePageId + 1;
     id_t minVarPageId = 0;
-    if (haveWrappedInMemory) {
-        id_t physicalPageIDOfSmallestData = logicalVariablePageId % state->numVarPages;
+    if (haveWrappedInMemory || firstPhysicalVariablePageId > 0) {
+        id_t physicalPageIDOfSmallestData = haveWrappedInMemory ? logicalVariablePageId % state->numVarPages : firstPhysicalVariablePageId;
         readVariablePage(state, physicalPageIDOfSmallestData);
-        memcpy(&(state->minVarRecordId), (int8_t *)buffer + sizeof(id_t), state->keySize);
-        memcpy(&minVarPageId, buffer, sizeof(id_t));
+        memcpy(&(state->minVarRecordId), (int8_t *)state->varReadPage + sizeof(id_t), state->keySize);
+        memcpy(&minVarPageId, state->varReadPage, sizeof(id_t));
         state->minVarRecordId++;
     }
 
@@ -569,196 +1126,166 @@ void embedDBPrintInit(embedDBState *state) {
 }
 
 /**
- * @brief	Given a state, uses the first and last keys to estimate a slope of keys
+ * @brief	Returns the number of record positions per unit of key on a page, using the line through its first and last
+ * 			keys. Multiplying a key's distance from the first key by the scale estimates its record number.
  * @param	state	embedDB algorithm state structure
  * @param	buffer	Pointer to in-memory buffer holding node
- * @return	Returns slope estimate float
+ * @return	Returns the scale, or 0 if the page has fewer than two records
  */
-float embedDBCalculateSlope(embedDBState *state, void *buffer) {
-    // simplistic slope calculation where the first two entries are used, should be improved
-
-    uint32_t slopeX1, slopeX2;
-    slopeX1 = 0;
-    slopeX2 = EMBEDDB_GET_COUNT(buffer) - 1;
-
-    if (state->keySize <= 4) {
-        uint32_t slopeY1 = 0, slopeY2 = 0;
-
-        // check if both points are the same
-        if (slopeX1 == slopeX2) {
-            return 1;
-        }
+double embedDBKeyScale(embedDBState *state, void *buffer) {
+    count_t count = EMBEDDB_GET_COUNT(buffer);
+    if (count <= 1)
+        return 0;
 
-        // convert to keys
-        memcpy(&slopeY1, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX1), state->keySize);
-        memcpy(&slopeY2, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX2), state->keySize);
+    uint64_t minKey = 0, maxKey = 0;
+    memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
+    memcpy(&maxKey, embedDBGetMaxKey(state, buffer), state->keySize);
+    if (maxKey <= minKey)
+        return 0;
+    return (double)(count - 1) / (double)(maxKey - minKey);
+}
 
-        // return slope of keys
-        return (float)(slopeY2 - slopeY1) / (float)(slopeX2 - slopeX1);
-    } else {
-        uint64_t slopeY1 = 0, slopeY2 = 0;
+/**
+ * @brief	Returns the maximum error for current page.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Pointer to in-memory buffer holding node
+ * @return	Returns the largest distance in records between a key's estimated and actual record number, rounded up.
+ */
+int32_t getMaxError(embedDBState *state, void *buffer) {
+    count_t count = EMBEDDB_GET_COUNT(buffer);
+    if (count > state->maxRecordsPerPage)
+        count = state->maxRecordsPerPage;
 
-        // check if both points are the same
-        if (slopeX1 == slopeX2) {
-            return 1;
-        }
+    /* The scale is computed once so that each key costs a multiply rather than a divide */
+    double scale = embedDBKeyScale(state, buffer);
+    uint64_t minKey = 0, currentKey = 0;
+    memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
 
-        // convert to keys
-        memcpy(&slopeY1, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX1), state->keySize);
-        memcpy(&slopeY2, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX2), state->keySize);
+    double maxError = 0;
+    int8_t *record = (int8_t *)buffer + state->headerSize;
+    for (count_t i = 0; i < count; i++) {
+        memcpy(&currentKey, record, state->keySize);
+        double currentError = fabs((double)(currentKey - minKey) * scale - i);
+        if (currentError > maxError)
+            maxError = currentError;
+        record += state->recordSize;
+    }
 
-        // return slope of keys
-        return (float)(slopeY2 - slopeY1) / (float)(slopeX2 - slopeX1);
+    int32_t error = (int32_t)ceil(maxError);
+    if (error > state->maxRecordsPerPage) {
+        return state->maxRecordsPerPage;
     }
+    return error;
 }
 
 /**
- * @brief	Returns the maximum error for current page.
+ * @brief	Adds an entry for the current page into the search structure
  * @param	state	embedDB algorithm state structure
- * @return	Returns max error integer.
  */
-int32_t getMaxError(embedDBState *state, void *buffer) {
-    if (state->keySize <= 4) {
-        int32_t maxError = 0, currentError;
-        uint32_t minKey = 0, currentKey = 0;
-        memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
+void indexPage(embedDBState *state, uint32_t pageNumber) {
+    if (state->searchStrategy->add != NULL)
+        state->searchStrategy->add(state, embedDBGetMinKey(state, state->buffer), pageNumber);
 
-        // get slope of keys within page
-        float slope = embedDBCalculateSlope(state, buffer);
+    if (state->splineFile != NULL && state->splineCheckpointEveryPages > 0 &&
+        state->nextDataPageId - state->splineCheckpointPageId >= state->splineCheckpointEveryPages)
+        embedDBCheckpointSpline(state);
+}
 
-        for (int i = 0; i < state->maxRecordsPerPage; i++) {
-            // loop all keys in page
-            memcpy(&currentKey, ((int8_t *)buffer + state->headerSize + state->recordSize * i), state->keySize);
-
-            // make currentKey value relative to current page
-            currentKey = currentKey - minKey;
+/**
+ * @brief	Puts a given key, data pair into structure.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for record
+ * @param	data	Data for record
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPut(embedDBState *state, void *key, void *data) {
+    if (checkKeyOrder(state, key, 1) != 0)
+        return 1;
+    state->recordHasVarData = 0;
+    return putRecord(state, key, data);
+}
 
-            // Guard against integer underflow
-            if ((currentKey / slope) >= i) {
-                currentError = (currentKey / slope) - i;
-            } else {
-                currentError = i - (currentKey / slope);
-            }
-            if (currentError > maxError) {
-                maxError = currentError;
-            }
-        }
+/**
+ * @brief	Checks that keys are larger than the last key inserted and in strictly ascending order.
+ * @param	state		embedDB algorithm state structure
+ * @param	keys		Array of keys
+ * @param	numKeys		Number of keys in the array
+ * @return	Return 0 if the keys can be inserted in order, 1 if not.
+ */
+int8_t checkKeyOrder(embedDBState *state, void *keys, uint32_t numKeys) {
+    /* The largest key is kept in memory so that inserts do not read the last page written */
+    int8_t inOrder = state->minKey == UINT32_MAX || compareKeys(state, keys, &state->maxKey) == 1;
+    for (uint32_t i = 1; i < numKeys && inOrder; i++)
+        inOrder = compareKeys(state, (int8_t *)keys + (size_t)i * state->keySize, (int8_t *)keys + (size_t)(i - 1) * state->keySize) == 1;
 
-        if (maxError > state->maxRecordsPerPage) {
-            return state->maxRecordsPerPage;
-        }
+    if (!inOrder) {
+#ifdef PRINT_ERRORS
+        printf("Keys must be strictly ascending order. Insert Failed.\n");
+#endif
+        return 1;
+    }
+    return 0;
+}
 
-        return maxError;
-    } else {
-        int32_t maxError = 0, currentError;
-        uint64_t currentKey = 0, minKey = 0;
-        memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
+/**
+ * @brief	Writes the full data page in the write buffer to storage, adds it to the spline and the index, and starts a
+ * 			new page.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t writeFullDataPage(embedDBState *state) {
+    // As the first buffer is the data write buffer, no manipulation is required
+    id_t pageNum = writePage(state, state->buffer);
 
-        // get slope of keys within page
-        float slope = embedDBCalculateSlope(state, state->buffer);  // this is incorrect, should be buffer. TODO: fix
+    indexPage(state, pageNum);
 
-        for (int i = 0; i < state->maxRecordsPerPage; i++) {
-            // loop all keys in page
-            memcpy(&currentKey, ((int8_t *)buffer + state->headerSize + state->recordSize * i), state->keySize);
+    /* Save record in index file */
+    if (state->indexFile != NULL) {
+        void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
+        count_t idxcount = EMBEDDB_GET_COUNT(buf);
+        if (idxcount >= state->maxIdxRecordsPerPage) {
+            /* Save index page */
+            writeIndexPage(state, buf);
 
-            // make currentKey value relative to current page
-            currentKey = currentKey - minKey;
+            idxcount = 0;
+            initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
 
-            // Guard against integer underflow
-            if ((currentKey / slope) >= i) {
-                currentError = (currentKey / slope) - i;
-            } else {
-                currentError = i - (currentKey / slope);
-            }
-            if (currentError > maxError) {
-                maxError = currentError;
-            }
+            /* Add page id to minimum value spot in page */
+            id_t *ptr = (id_t *)((int8_t *)buf + 8);
+            *ptr = pageNum;
         }
 
-        if (maxError > state->maxRecordsPerPage) {
-            return state->maxRecordsPerPage;
-        }
+        EMBEDDB_INC_COUNT(buf);
 
-        return maxError;
+        /* Copy record onto index page */
+        void *bm = EMBEDDB_GET_BITMAP(state->buffer);
+        memcpy((void *)((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount), bm, state->bitmapSize);
     }
-}
 
-/**
- * @brief	Adds an entry for the current page into the search structure
- * @param	state	embedDB algorithm state structure
- */
-void indexPage(embedDBState *state, uint32_t pageNumber) {
-    if (SEARCH_METHOD == 2) {
-        if (RADIX_BITS > 0) {
-            radixsplineAddPoint(state->rdix, embedDBGetMinKey(state, state->buffer), pageNumber);
-        } else {
-            splineAdd(state->spl, embedDBGetMinKey(state, state->buffer), pageNumber);
-        }
-    }
+    updateAverageKeyDifference(state, state->buffer);
+    updateMaxiumError(state, state->buffer);
+
+    initBufferPage(state, 0);
+
+    return embedDBCommitIfDue(state);
 }
 
 /**
- * @brief	Puts a given key, data pair into structure.
+ * @brief	Puts a given key, data pair into structure without checking the order of the key.
  * @param	state	embedDB algorithm state structure
  * @param	key		Key for record
  * @param	data	Data for record
  * @return	Return 0 if success. Non-zero value if error.
  */
-int8_t embedDBPut(embedDBState *state, void *key, void *data) {
+int8_t putRecord(embedDBState *state, void *key, void *data) {
     /* Copy record into block */
     count_t count = EMBEDDB_GET_COUNT(state->buffer);
-    if (state->minKey != UINT32_MAX) {
-        void *previousKey = NULL;
-        if (count == 0) {
-            readPage(state, (state->nextDataPageId - 1) % state->numDataPages);
-            previousKey = ((int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER) +
-                          (state->recordSize * (state->maxRecordsPerPage - 1)) + state->headerSize;
-        } else {
-            previousKey = (int8_t *)state->buffer + (state->recordSize * (count - 1)) + state->headerSize;
-        }
-        if (state->compareKey(key, previousKey) != 1) {
-#ifdef PRINT_ERRORS
-            printf("Keys must be strictly ascending order. Insert Failed.\n");
-#endif
-            return 1;
-        }
-    }
 
     /* Write current page if full */
     if (count >= state->maxRecordsPerPage) {
-        // As the first buffer is the data write buffer, no manipulation is required
-        id_t pageNum = writePage(state, state->buffer);
-
-        indexPage(state, pageNum);
-
-        /* Save record in index file */
-        if (state->indexFile != NULL) {
-            void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
-            count_t idxcount = EMBEDDB_GET_COUNT(buf);
-            if (idxcount >= state->maxIdxRecordsPerPage) {
-                /* Save index page */
-                writeIndexPage(state, buf);
-
-                idxcount = 0;
-                initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
-
-                /* Add page id to minimum value spot in page */
-                id_t *ptr = (id_t *)((int8_t *)buf + 8);
-                *ptr = pageNum;
-            }
-
-            EMBEDDB_INC_COUNT(buf);
-
-            /* Copy record onto index page */
-            void *bm = EMBEDDB_GET_BITMAP(state->buffer);
-            memcpy((void *)((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount), bm, state->bitmapSize);
-        }
-
-        updateAverageKeyDifference(state, state->buffer);
-        updateMaxiumError(state, state->buffer);
-
         count = 0;
-        initBufferPage(state, 0);
+        if (writeFullDataPage(state) != 0)
+            return -1;
     }
 
     /* Copy record onto page */
@@ -782,6 +1309,7 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data) {
     /* Set minimum key for first record insert */
     if (state->minKey == UINT32_MAX)
         memcpy(&state->minKey, key, state->keySize);
+    memcpy(&state->maxKey, key, state->keySize);
 
     if (EMBEDDB_USING_MAX_MIN(state->parameters)) {
         /* Update MIN/MAX */
@@ -793,10 +1321,10 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data) {
             memcpy(ptr, key, state->keySize);
 
             ptr = EMBEDDB_GET_MIN_DATA(state->buffer, state);
-            if (state->compareData(data, ptr) < 0)
+            if (compareDataValues(state, data, ptr) < 0)
                 memcpy(ptr, data, state->dataSize);
             ptr = EMBEDDB_GET_MAX_DATA(state->buffer, state);
-            if (state->compareData(data, ptr) > 0)
+            if (compareDataValues(state, data, ptr) > 0)
                 memcpy(ptr, data, state->dataSize);
         } else {
             /* First record inserted */
@@ -822,6 +1350,10 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data) {
 }
 
 void updateMaxiumError(embedDBState *state, void *buffer) {
+    /* Error is capped at the records per page, so once reached no page can raise it */
+    if (state->maxError >= state->maxRecordsPerPage)
+        return;
+
     // Calculate error within the page
     int32_t maxError = getMaxError(state, buffer);
     if (state->maxError < maxError) {
@@ -862,7 +1394,21 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
 #endif
         return -1;
     }
+    if (checkKeyOrder(state, key, 1) != 0)
+        return 1;
+    return putVarRecord(state, key, data, variableData, length);
+}
 
+/**
+ * @brief	Puts the given key, data, and variable length data into the structure without checking the order of the key.
+ * @param	state			embedDB algorithm state structure
+ * @param	key				Key for record
+ * @param	data			Data for record
+ * @param	variableData	Variable length data for record
+ * @param	length			Length of the variable length data in bytes
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t putVarRecord(embedDBState *state, void *key, void *data, void *variableData, uint32_t length) {
     // Insert their data
 
     /*
@@ -880,13 +1426,13 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
     if (variableData == NULL) {
         // Var data enabled, but not provided
         state->recordHasVarData = 0;
-        return embedDBPut(state, key, data);
+        return putRecord(state, key, data);
     }
 
     // Perform the regular insert
     state->recordHasVarData = 1;
     int8_t r;
-    if ((r = embedDBPut(state, key, data)) != 0) {
+    if ((r = putRecord(state, key, data)) != 0) {
         return r;
     }
 
@@ -929,22 +1475,136 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
     return 0;
 }
 
+/**
+ * @brief	Puts an array of records into the structure. The key order is checked once for the batch, then records are
+ * 			copied onto the write page a run at a time, with the page header and bitmap updated for each run.
+ * @param	state		embedDB algorithm state structure
+ * @param	keys		Array of keys in strictly ascending order
+ * @param	data		Array of data for the records
+ * @param	numRecords	Number of records
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutBatch(embedDBState *state, void *keys, void *data, uint32_t numRecords) {
+    if (numRecords == 0)
+        return 0;
+    if (checkKeyOrder(state, keys, numRecords) != 0)
+        return 1;
+
+    /* Set minimum key for first record insert. Needed before a page is written */
+    if (state->minKey == UINT32_MAX)
+        memcpy(&state->minKey, keys, state->keySize);
+
+    int8_t usingVarData = EMBEDDB_USING_VDATA(state->parameters);
+    int8_t usingMaxMin = EMBEDDB_USING_MAX_MIN(state->parameters);
+    int8_t usingBitmap = EMBEDDB_USING_BMAP(state->parameters);
+    uint32_t noVarData = EMBEDDB_NO_VAR_DATA;
+    uint32_t numInserted = 0;
+    while (numInserted < numRecords) {
+        count_t count = EMBEDDB_GET_COUNT(state->buffer);
+        if (count >= state->maxRecordsPerPage) {
+            count = 0;
+            if (writeFullDataPage(state) != 0)
+                return -1;
+        }
+
+        uint32_t runLength = min(numRecords - numInserted, (uint32_t)(state->maxRecordsPerPage - count));
+        int8_t *runKeys = (int8_t *)keys + (size_t)numInserted * state->keySize;
+        int8_t *runData = (int8_t *)data + (size_t)numInserted * state->dataSize;
+
+        /* Copy the run onto the page */
+        int8_t *record = (int8_t *)state->buffer + state->headerSize + state->recordSize * count;
+        for (uint32_t i = 0; i < runLength; i++) {
+            memcpy(record, runKeys + (size_t)i * state->keySize, state->keySize);
+            memcpy(record + state->keySize, runData + (size_t)i * state->dataSize, state->dataSize);
+            if (usingVarData)
+                memcpy(record + state->keySize + state->dataSize, &noVarData, sizeof(uint32_t));
+            record += state->recordSize;
+        }
+
+        if (usingMaxMin) {
+            void *minData = EMBEDDB_GET_MIN_DATA(state->buffer, state);
+            void *maxData = EMBEDDB_GET_MAX_DATA(state->buffer, state);
+            uint32_t first = 0;
+            if (count == 0) {
+                /* First record on the page */
+                memcpy(EMBEDDB_GET_MIN_KEY(state->buffer), runKeys, state->keySize);
+                memcpy(minData, runData, state->dataSize);
+                memcpy(maxData, runData, state->dataSize);
+                first = 1;
+            }
+            for (uint32_t i = first; i < runLength; i++) {
+                void *recordData = runData + (size_t)i * state->dataSize;
+                if (compareDataValues(state, recordData, minData) < 0)
+                    memcpy(minData, recordData, state->dataSize);
+                else if (compareDataValues(state, recordData, maxData) > 0)
+                    memcpy(maxData, recordData, state->dataSize);
+            }
+            memcpy(EMBEDDB_GET_MAX_KEY(state->buffer, state), runKeys + (size_t)(runLength - 1) * state->keySize, state->keySize);
+        }
+
+        if (usingBitmap) {
+            void *bm = EMBEDDB_GET_BITMAP(state->buffer);
+            for (uint32_t i = 0; i < runLength; i++)
+                state->updateBitmap(runData + (size_t)i * state->dataSize, bm);
+        }
+
+        EMBEDDB_GET_COUNT(state->buffer) = count + runLength;
+        numInserted += runLength;
+        memcpy(&state->maxKey, runKeys + (size_t)(runLength - 1) * state->keySize, state->keySize);
+    }
+    return 0;
+}
+
+/**
+ * @brief	Puts an array of records with variable length data into the structure. The key order is checked once for the
+ * 			batch.
+ * @param	state			embedDB algorithm state structure
+ * @param	keys			Array of keys in strictly ascending order
+ * @param	data			Array of data for the records
+ * @param	variableData	Variable length data for each record. An entry may be NULL if the record has none
+ * @param	lengths			Length of the variable length data of each record in bytes
+ * @param	numRecords		Number of records
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutBatchVar(embedDBState *state, void *keys, void *data, void **variableData, uint32_t *lengths, uint32_t numRecords) {
+    if (!EMBEDDB_USING_VDATA(state->parameters)) {
+#ifdef PRINT_ERRORS
+        printf("Error: Can't insert variable data because it is not enabled\n");
+#endif
+        return -1;
+    }
+    if (numRecords == 0)
+        return 0;
+    if (checkKeyOrder(state, keys, numRecords) != 0)
+        return 1;
+
+    for (uint32_t i = 0; i < numRecords; i++) {
+        int8_t result = putVarRecord(state, (int8_t *)keys + (size_t)i * state->keySize, (int8_t *)data + (size_t)i * state->dataSize, variableData[i], lengths[i]);
+        if (result != 0)
+            return result;
+    }
+    return 0;
+}
+
 /**
  * @brief	Given a key, estimates the location of the key within the node.
  * @param	state	embedDB algorithm state structure
  * @param	buffer	Pointer to in-memory buffer holding node
  * @param	key		Key for record
+ * @return	Returns the estimated record number. -1 if the key is before the first record, count if after the last record.
  */
 int16_t embedDBEstimateKeyLocation(embedDBState *state, void *buffer, void *key) {
-    // get slope to use for linear estimation of key location
-    // return estimated location of the key
-    float slope = embedDBCalculateSlope(state, buffer);
-
-    uint64_t minKey = 0, thisKey = 0;
+    count_t count = EMBEDDB_GET_COUNT(buffer);
+    uint64_t minKey = 0, maxKey = 0, thisKey = 0;
     memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
+    memcpy(&maxKey, embedDBGetMaxKey(state, buffer), state->keySize);
     memcpy(&thisKey, key, state->keySize);
 
-    return (thisKey - minKey) / slope;
+    if (thisKey < minKey)
+        return -1;
+    if (thisKey > maxKey)
+        return count;
+    return (int16_t)((double)(thisKey - minKey) * embedDBKeyScale(state, buffer));
 }
 
 /**
@@ -955,6 +1615,9 @@ int16_t embedDBEstimateKeyLocation(embedDBState *state, void *buffer, void *key)
  * @param	range	1 if range query so return pointer to first record <= key, 0 if exact query so much return first exact match record
  */
 id_t embedDBSearchNode(embedDBState *state, void *buffer, void *key, int8_t range) {
+    if (state->keyType != EMBEDDB_KEY_CUSTOM)
+        return searchNodeUnsigned(state, buffer, key, range);
+
     int16_t first, last, middle, count;
     int8_t compare;
     void *mkey;
@@ -994,22 +1657,131 @@ id_t embedDBSearchNode(embedDBState *state, void *buffer, void *key, int8_t rang
     return -1;
 }
 
+/**
+ * @brief	Returns the key of a record on a page as an unsigned number. Only for EMBEDDB_KEY_UINT32 and EMBEDDB_KEY_UINT64 keys.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Pointer to in-memory buffer holding node
+ * @param	recordNum	Record number on the page
+ */
+uint64_t unsignedKeyAt(embedDBState *state, void *buffer, int32_t recordNum) {
+    uint64_t key = 0;
+    memcpy(&key, (int8_t *)buffer + state->headerSize + state->recordSize * recordNum, state->keySize);
+    return key;
+}
+
+/**
+ * @brief	Returns the number of records on a page with a key smaller than key, for unsigned 32-bit keys. Only records in
+ * 			[low, high) are examined, so every record before low must have a smaller key and no record from high on may.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Pointer to in-memory buffer holding node
+ * @param	key		Key to search for
+ * @param	low		First record that may have a key greater than or equal to key
+ * @param	high	Record after the last one that may have a smaller key
+ */
+int32_t lowerBoundUint32(embedDBState *state, void *buffer, uint32_t key, int32_t low, int32_t high) {
+    int8_t *keys = (int8_t *)buffer + state->headerSize;
+    uint32_t currentKey;
+    while (high - low > EMBEDDB_SCAN_RECORDS) {
+        int32_t middle = (low + high) / 2;
+        memcpy(&currentKey, keys + state->recordSize * middle, sizeof(uint32_t));
+        if (currentKey < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    /* Keys are sorted, so counting the smaller keys gives the position without a branch per record */
+    int32_t position = low;
+    for (int32_t i = low; i < high; i++) {
+        memcpy(&currentKey, keys + state->recordSize * i, sizeof(uint32_t));
+        position += currentKey < key;
+    }
+    return position;
+}
+
+/**
+ * @brief	Returns the number of records on a page with a key smaller than key, for unsigned 64-bit keys. See lowerBoundUint32.
+ */
+int32_t lowerBoundUint64(embedDBState *state, void *buffer, uint64_t key, int32_t low, int32_t high) {
+    int8_t *keys = (int8_t *)buffer + state->headerSize;
+    uint64_t currentKey;
+    while (high - low > EMBEDDB_SCAN_RECORDS) {
+        int32_t middle = (low + high) / 2;
+        memcpy(&currentKey, keys + state->recordSize * middle, sizeof(uint64_t));
+        if (currentKey < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    int32_t position = low;
+    for (int32_t i = low; i < high; i++) {
+        memcpy(&currentKey, keys + state->recordSize * i, sizeof(uint64_t));
+        position += currentKey < key;
+    }
+    return position;
+}
+
+/**
+ * @brief	embedDBSearchNode for unsigned integer keys. Compares keys directly instead of through compareKey, and only
+ * 			searches the records within maxError of the estimated location when the keys at the edges of that window show
+ * 			that the key is inside it.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Pointer to in-memory buffer holding node
+ * @param	key		Key for record
+ * @param	range	1 if range query so return pointer to first record <= key, 0 if exact query so much return first exact match record
+ */
+id_t searchNodeUnsigned(embedDBState *state, void *buffer, void *key, int8_t range) {
+    int32_t count = EMBEDDB_GET_COUNT(buffer);
+    uint64_t thisKey = 0;
+    memcpy(&thisKey, key, state->keySize);
+
+    int32_t low = 0, high = count;
+    int32_t estimate = embedDBEstimateKeyLocation(state, buffer, key);
+    if (estimate < 0 || estimate >= count) {
+        /* Key is outside the page's key range */
+        low = high = estimate < 0 ? 0 : count;
+    } else {
+        /* Written pages are within maxError of the estimate. The write buffer and pages not seen since init may not be */
+        int32_t windowLow = max(estimate - state->maxError, 0);
+        int32_t windowHigh = min(estimate + state->maxError + 1, count);
+        if ((windowLow == 0 || unsignedKeyAt(state, buffer, windowLow - 1) < thisKey) &&
+            (windowHigh == count || unsignedKeyAt(state, buffer, windowHigh) >= thisKey)) {
+            low = windowLow;
+            high = windowHigh;
+        }
+    }
+
+    int32_t position;
+    if (state->keyType == EMBEDDB_KEY_UINT32) {
+        position = lowerBoundUint32(state, buffer, (uint32_t)thisKey, low, high);
+    } else {
+        position = lowerBoundUint64(state, buffer, thisKey, low, high);
+    }
+
+    if (position < count && unsignedKeyAt(state, buffer, position) == thisKey)
+        return position;
+    if (range)
+        return position > 0 ? position - 1 : 0;
+    return -1;
+}
+
 /**
  * @brief	Linear search function to be used with an approximate range of pages.
- * 			If the desired key is found, the page containing that record is loaded
- * 			into the passed buffer pointer.
+ * 			If the desired key is found, the page containing that record is left
+ * 			as the data read page (state->dataReadPage).
  * @param	state		embedDB algorithm state structure
  * @param 	numReads	Tracks total number of reads for statistics
- * @param	buf			buffer to store page with desired record
  * @param	key			Key for the record to search for
  * @param	pageId		Page id to start search from
  * @param 	low			Lower bound for the page the record could be found on
  * @param 	high		Upper bound for the page the record could be found on
  * @return	Return 0 if success. Non-zero value if error.
  */
-int8_t linearSearch(embedDBState *state, int16_t *numReads, void *buf, void *key, int32_t pageId, int32_t low, int32_t high) {
+int8_t linearSearch(embedDBState *state, int16_t *numReads, void *key, int32_t pageId, int32_t low, int32_t high) {
     int32_t pageError = 0;
     int32_t physPageId;
+    int8_t direction = 0;
     while (1) {
         /* Move logical page number to physical page id based on location of first data page */
         physPageId = pageId % state->numDataPages;
@@ -1018,6 +1790,14 @@ int8_t linearSearch(embedDBState *state, int16_t *numReads, void *buf, void *key
             return -1;
         }
 
+        /* After a miss, read the rest of the pages in the search direction as one batch */
+        if (pageError > 0 && state->numWindowPages > 1 && !isDataPageBuffered(state, physPageId)) {
+            if (direction > 0)
+                readWindowRun(state, pageId, min((id_t)high, state->nextDataPageId - 1));
+            else
+                readWindowRun(state, pageId, max((id_t)low, state->minDataPageId));
+        }
+
         /* Read page into buffer. If 0 not returned, there was an error */
         id_t start = state->numReads;
         if (readPage(state, physPageId) != 0) {
@@ -1025,11 +1805,14 @@ int8_t linearSearch(embedDBState *state, int16_t *numReads, void *buf, void *key
         }
         *numReads += state->numReads - start;
 
-        if (state->compareKey(key, embedDBGetMinKey(state, buf)) < 0) { /* Key is less than smallest record in block. */
+        void *buf = state->dataReadPage;
+        if (compareKeys(state, key, embedDBGetMinKey(state, buf)) < 0) { /* Key is less than smallest record in block. */
             high = --pageId;
+            direction = -1;
             pageError++;
-        } else if (state->compareKey(key, embedDBGetMaxKey(state, buf)) > 0) { /* Key is larger than largest record in block. */
+        } else if (compareKeys(state, key, embedDBGetMaxKey(state, buf)) > 0) { /* Key is larger than largest record in block. */
             low = ++pageId;
+            direction = 1;
             pageError++;
         } else {
             /* Found correct block */
@@ -1039,81 +1822,20 @@ int8_t linearSearch(embedDBState *state, int16_t *numReads, void *buf, void *key
 }
 
 /**
- * @brief	Given a key, searches for data associated with
- *          that key in embedDB buffer using embedDBSearchNode.
- *          Note: Space for data must be already allocated.
- * @param	state	embedDB algorithm state structure
- * @param   buffer  pointer to embedDB buffer
- * @param	key		Key for record
- * @param	data	Pre-allocated memory to copy data for record
- * @param   range
- * @return	Return non-negative integer representing offset if success. -1 value if error.
- */
-int8_t searchBuffer(embedDBState *state, void *buffer, void *key, void *data) {
-    // return -1 if there is nothing in the buffer
-    if (EMBEDDB_GET_COUNT(buffer) == 0) {
-        return NO_RECORD_FOUND;
-    }
-    // find index of record inside of the write buffer
-    id_t nextId = embedDBSearchNode(state, buffer, key, 0);
-    // return 0 if found
-    if (nextId != NO_RECORD_FOUND) {
-        // Key found
-        memcpy(data, (void *)((int8_t *)buffer + state->headerSize + state->recordSize * nextId + state->keySize), state->dataSize);
-        return nextId;
-    }
-    // Key not found
-    return NO_RECORD_FOUND;
-}
-
-/**
- * @brief	Given a key, returns data associated with key.
- * 			Note: Space for data must be already allocated.
- * 			Data is copied from database into data buffer.
- * @param	state	embedDB algorithm state structure
- * @param	key		Key for record
- * @param	data	Pre-allocated memory to copy data for record
+ * @brief	Finds the data page holding a key with a binary search whose probes are placed using the average difference
+ * 			between keys. The page is left as the data read page.
+ * @param	state		embedDB algorithm state structure
+ * @param	key			Key for the record to search for
+ * @param	numReads	Tracks total number of reads for statistics
  * @return	Return 0 if success. Non-zero value if error.
  */
-int8_t embedDBGet(embedDBState *state, void *key, void *data) {
-    void *outputBuffer = state->buffer;
-    if (state->nextDataPageId == 0) {
-        int8_t success = searchBuffer(state, outputBuffer, key, data);
-        if (success == 0) return success;
-
-#ifdef PRINT_ERRORS
-        printf("ERROR: No data in database.\n");
-#endif
-        return -1;
-    }
-
+int8_t modifiedBinarySearchFindPage(embedDBState *state, void *key, int16_t *numReads) {
     uint64_t thisKey = 0;
     memcpy(&thisKey, key, state->keySize);
 
-    void *buf = (int8_t *)state->buffer + state->pageSize;
-    int16_t numReads = 0;
-
-    // if write buffer is not empty
-    if ((EMBEDDB_GET_COUNT(outputBuffer) != 0)) {
-        // get the max/min key from output buffer
-        uint64_t bufMaxKey = 0;
-        uint64_t bufMinKey = 0;
-        memcpy(&bufMaxKey, embedDBGetMaxKey(state, outputBuffer), state->keySize);
-        memcpy(&bufMinKey, embedDBGetMinKey(state, outputBuffer), state->keySize);
-        // return -1 if key is not in buffer
-        if (thisKey > bufMaxKey) return -1;
-        // if key >= buffer's min, check buffer
-        if (thisKey >= bufMinKey) {
-            return (searchBuffer(state, outputBuffer, key, data));
-        }
-    }
-
-#if SEARCH_METHOD == 0
-    /* Perform a modified binary search that uses info on key location sequence for first placement. */
-
     // Guess logical page id
     uint32_t pageId;
-    if (state->compareKey(key, (void *)&(state->minKey)) < 0) {
+    if (compareKeys(state, key, (void *)&(state->minKey)) < 0) {
         pageId = state->minDataPageId;
     } else {
         pageId = (thisKey - state->minKey) / (state->maxRecordsPerPage * state->avgKeyDiff) + state->minDataPageId;
@@ -1128,22 +1850,23 @@ int8_t embedDBGet(embedDBState *state, void *key, void *data) {
         /* Read page into buffer */
         if (readPage(state, pageId % state->numDataPages) != 0)
             return -1;
-        numReads++;
+        void *buf = state->dataReadPage;
+        (*numReads)++;
 
         if (first >= last)
-            break;
+            return 0;
 
-        if (state->compareKey(key, embedDBGetMinKey(state, buf)) < 0) {
+        if (compareKeys(state, key, embedDBGetMinKey(state, buf)) < 0) {
             /* Key is less than smallest record in block. */
             last = pageId - 1;
             uint64_t minKey = 0;
             memcpy(&minKey, embedDBGetMinKey(state, buf), state->keySize);
-            offset = (thisKey - minKey) / (state->maxRecordsPerPage * state->avgKeyDiff) - 1;
+            offset = -(int32_t)((minKey - thisKey) / (state->maxRecordsPerPage * state->avgKeyDiff)) - 1;
             if (pageId + offset < first)
                 offset = first - pageId;
             pageId += offset;
 
-        } else if (state->compareKey(key, embedDBGetMaxKey(state, buf)) > 0) {
+        } else if (compareKeys(state, key, embedDBGetMaxKey(state, buf)) > 0) {
             /* Key is larger than largest record in block. */
             first = pageId + 1;
             uint64_t maxKey = 0;
@@ -1154,55 +1877,482 @@ int8_t embedDBGet(embedDBState *state, void *key, void *data) {
             pageId += offset;
         } else {
             /* Found correct block */
-            break;
+            return 0;
         }
     }
-#elif SEARCH_METHOD == 1
-    /* Regular binary search */
+}
+
+/**
+ * @brief	Finds the data page holding a key with a binary search over the data pages. The page is left as the data read
+ * 			page.
+ * @param	state		embedDB algorithm state structure
+ * @param	key			Key for the record to search for
+ * @param	numReads	Tracks total number of reads for statistics
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t binarySearchFindPage(embedDBState *state, void *key, int16_t *numReads) {
     uint32_t first = state->minDataPageId, last = state->nextDataPageId - 1;
     uint32_t pageId = (first + last) / 2;
     while (1) {
         /* Read page into buffer */
         if (readPage(state, pageId % state->numDataPages) != 0)
             return -1;
-        numReads++;
+        void *buf = state->dataReadPage;
+        (*numReads)++;
 
         if (first >= last)
-            break;
+            return 0;
 
-        if (state->compareKey(key, embedDBGetMinKey(state, buf)) < 0) {
+        if (compareKeys(state, key, embedDBGetMinKey(state, buf)) < 0) {
             /* Key is less than smallest record in block. */
             last = pageId - 1;
             pageId = (first + last) / 2;
-        } else if (state->compareKey(key, embedDBGetMaxKey(state, buf)) > 0) {
+        } else if (compareKeys(state, key, embedDBGetMaxKey(state, buf)) > 0) {
             /* Key is larger than largest record in block. */
             first = pageId + 1;
             pageId = (first + last) / 2;
         } else {
             /* Found correct block */
-            break;
+            return 0;
         }
     }
-#elif SEARCH_METHOD == 2
-    /* Spline search */
-    uint32_t location, lowbound, highbound;
-    if (RADIX_BITS > 0) {
-        radixsplineFind(state->rdix, key, state->compareKey, &location, &lowbound, &highbound);
+}
+
+/**
+ * @brief	Allocates the spline, with a radix table over it if state->radixBits is not 0
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t splineSearchInit(embedDBState *state) {
+    state->cleanSpline = 1;
+    if (state->radixBits > 0)
+        return initRadixSpline(state, state->radixBits);
+
+    state->spl = malloc(sizeof(spline));
+    if (state->spl == NULL)
+        return -1;
+    return splineInit(state->spl, state->numSplinePoints, state->indexMaxError, state->keySize);
+}
+
+void splineSearchAdd(embedDBState *state, void *key, id_t pageId) {
+    splineSearchLoad(state);
+    if (state->radixBits > 0) {
+        radixsplineAddPoint(state->rdix, key, pageId);
+    } else {
+        splineAdd(state->spl, key, pageId);
+    }
+}
+
+/**
+ * @brief	Finds the data page holding a key by searching the pages around the spline's estimate. The page is left as the
+ * 			data read page.
+ * @param	state		embedDB algorithm state structure
+ * @param	key			Key for the record to search for
+ * @param	numReads	Tracks total number of reads for statistics
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t splineSearchFindPage(embedDBState *state, void *key, int16_t *numReads) {
+    splineSearchLoad(state);
+    uint32_t location, lowbound, highbound;
+    if (state->radixBits > 0) {
+        radixsplineFind(state->rdix, key, keyComparator(state), &location, &lowbound, &highbound);
     } else {
-        splineFind(state->spl, key, state->compareKey, &location, &lowbound, &highbound);
+        splineFind(state->spl, key, keyComparator(state), &location, &lowbound, &highbound);
     }
 
     // Check if the currently buffered page is the correct one
+    void *buf = state->dataReadPage;
     if (!(lowbound <= state->bufferedPageId &&
           highbound >= state->bufferedPageId &&
-          state->compareKey(embedDBGetMinKey(state, buf), key) <= 0 &&
-          state->compareKey(embedDBGetMaxKey(state, buf), key) >= 0)) {
-        if (linearSearch(state, &numReads, buf, key, location, lowbound, highbound) == -1) {
+          compareKeys(state, embedDBGetMinKey(state, buf), key) <= 0 &&
+          compareKeys(state, embedDBGetMaxKey(state, buf), key) >= 0)) {
+        return linearSearch(state, numReads, key, location, lowbound, highbound);
+    }
+    return 0;
+}
+
+id_t splineSearchFirstPage(embedDBState *state, void *key) {
+    splineSearchLoad(state);
+    uint32_t location, lowbound, highbound;
+    if (state->radixBits > 0) {
+        radixsplineFind(state->rdix, key, keyComparator(state), &location, &lowbound, &highbound);
+    } else {
+        splineFind(state->spl, key, keyComparator(state), &location, &lowbound, &highbound);
+    }
+    return lowbound;
+}
+
+void splineSearchPrint(embedDBState *state) {
+    splineSearchLoad(state);
+    if (state->radixBits > 0) {
+        splinePrint(state->rdix->spl);
+        radixsplinePrint(state->rdix);
+    } else {
+        splinePrint(state->spl);
+    }
+}
+
+void splineSearchClose(embedDBState *state) {
+    if (state->radixBits > 0) {
+        radixsplineClose(state->rdix);
+        free(state->rdix);
+        state->rdix = NULL;
+        // Spl already freed by radixsplineClose
+        state->spl = NULL;
+    } else {
+        splineClose(state->spl);
+        free(state->spl);
+        state->spl = NULL;
+    }
+}
+
+/**
+ * @brief	Adds the data pages recovered from storage to the spline, if that has not been done yet. Called by each spline
+ * 			search function so that opening a database does not read every data page unless the spline is used.
+ * @param	state	embedDB algorithm state structure
+ */
+void splineSearchLoad(embedDBState *state) {
+    if (state->splineRecoveredPageId == 0)
+        return;
+
+    /* Cleared first as adding the pages calls back into the spline */
+    id_t endPageId = state->splineRecoveredPageId;
+    state->splineRecoveredPageId = 0;
+    addDataPagesToSearch(state, state->minDataPageId, endPageId);
+}
+
+#define SPLINE_CHECKPOINT_MAGIC 0x4C505345 /* "ESPL" */
+
+/* Position in a spline checkpoint being written or read a page at a time through state->splineCheckpointPage */
+typedef struct {
+    embedDBState *state;
+    id_t pageNum;      /* Page of the spline file in the page buffer */
+    id_t endPageNum;   /* Page after the last page of the checkpoint slot */
+    uint32_t offset;   /* Bytes of the page buffer written or read */
+    uint32_t checksum; /* FNV-1a hash of the bytes written or read */
+    int8_t failed;     /* 1 if a page could not be written or read, or the checkpoint does not fit in its slot */
+} splineCheckpointCursor;
+
+static void initCheckpointCursor(splineCheckpointCursor *cursor, embedDBState *state, uint32_t slot, int8_t reading) {
+    cursor->state = state;
+    cursor->pageNum = slot * state->splineCheckpointSlotPages;
+    cursor->endPageNum = cursor->pageNum + state->splineCheckpointSlotPages;
+    cursor->offset = reading ? state->pageSize : 0;
+    cursor->checksum = 2166136261u;
+    cursor->failed = 0;
+    if (reading)
+        cursor->pageNum--;
+}
+
+static void writeCheckpointBytes(splineCheckpointCursor *cursor, const void *bytes, uint32_t length) {
+    embedDBState *state = cursor->state;
+    for (uint32_t i = 0; i < length && !cursor->failed; i++) {
+        if (cursor->offset == state->pageSize) {
+            cursor->failed = cursor->pageNum + 1 >= cursor->endPageNum ||
+                             !state->fileInterface->write(state->splineCheckpointPage, cursor->pageNum, state->pageSize, state->splineFile);
+            cursor->pageNum++;
+            cursor->offset = 0;
+        }
+        uint8_t byte = ((const uint8_t *)bytes)[i];
+        ((uint8_t *)state->splineCheckpointPage)[cursor->offset++] = byte;
+        cursor->checksum = (cursor->checksum ^ byte) * 16777619u;
+    }
+}
+
+static void readCheckpointBytes(splineCheckpointCursor *cursor, void *bytes, uint32_t length) {
+    embedDBState *state = cursor->state;
+    for (uint32_t i = 0; i < length && !cursor->failed; i++) {
+        if (cursor->offset == state->pageSize) {
+            cursor->pageNum++;
+            cursor->offset = 0;
+            cursor->failed = cursor->pageNum >= cursor->endPageNum ||
+                             !state->fileInterface->read(state->splineCheckpointPage, cursor->pageNum, state->pageSize, state->splineFile);
+            if (cursor->failed)
+                return;
+        }
+        uint8_t byte = ((uint8_t *)state->splineCheckpointPage)[cursor->offset++];
+        ((uint8_t *)bytes)[i] = byte;
+        cursor->checksum = (cursor->checksum ^ byte) * 16777619u;
+    }
+}
+
+int8_t embedDBCheckpointSpline(embedDBState *state) {
+    if (state->splineFile == NULL || state->spl == NULL)
+        return 0;
+    splineSearchLoad(state);
+
+    spline *spl = state->spl;
+    uint32_t pointSize = state->keySize + sizeof(uint32_t);
+    uint32_t fields[] = {SPLINE_CHECKPOINT_MAGIC, state->splineCheckpointSequence, state->nextDataPageId, state->keySize, state->radixBits,
+                         spl->size, spl->maxError, spl->count, spl->pointsStartIndex, spl->lastLoc, spl->eraseSize, spl->numAddCalls, spl->tempLastPoint};
+    splineCheckpointCursor cursor;
+    initCheckpointCursor(&cursor, state, state->splineCheckpointSequence % 2, 0);
+    writeCheckpointBytes(&cursor, fields, sizeof(fields));
+    writeCheckpointBytes(&cursor, spl->lastKey, state->keySize);
+    writeCheckpointBytes(&cursor, spl->lower, pointSize);
+    writeCheckpointBytes(&cursor, spl->upper, pointSize);
+    writeCheckpointBytes(&cursor, spl->firstSplinePoint, pointSize);
+    for (size_t i = 0; i < spl->count; i++)
+        writeCheckpointBytes(&cursor, splinePointLocation(spl, i), pointSize);
+
+    if (state->radixBits > 0) {
+        radixspline *rdix = state->rdix;
+        uint32_t minKeyIndex = (uint32_t)(((int8_t *)rdix->minKey - (int8_t *)spl->points) / pointSize);
+        uint32_t radixFields[] = {(uint32_t)rdix->shiftSize, rdix->prevPrefix, rdix->pointsSeen, minKeyIndex};
+        writeCheckpointBytes(&cursor, radixFields, sizeof(radixFields));
+        if (rdix->pointsSeen > 0)
+            writeCheckpointBytes(&cursor, rdix->table, rdix->size * sizeof(id_t));
+    }
+
+    uint32_t checksum = cursor.checksum;
+    writeCheckpointBytes(&cursor, &checksum, sizeof(uint32_t));
+    if (!cursor.failed)
+        cursor.failed = !state->fileInterface->write(state->splineCheckpointPage, cursor.pageNum, state->pageSize, state->splineFile);
+    if (cursor.failed || !embedDBSyncFile(state, state->splineFile)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to write spline checkpoint.\n");
+#endif
+        return -1;
+    }
+
+    state->splineCheckpointSequence++;
+    state->splineCheckpointPageId = state->nextDataPageId;
+    return 0;
+}
+
+/**
+ * @brief	Reads the sequence number of the checkpoint in a slot of the spline file.
+ * @param	state		embedDB algorithm state structure
+ * @param	slot		0 or 1
+ * @param	sequence	Return value for the sequence number
+ * @return	Return 0 if the slot starts with a checkpoint. Non-zero value if not.
+ */
+int8_t readSplineCheckpointSequence(embedDBState *state, uint32_t slot, uint32_t *sequence) {
+    uint32_t fields[2] = {0, 0};
+    splineCheckpointCursor cursor;
+    initCheckpointCursor(&cursor, state, slot, 1);
+    readCheckpointBytes(&cursor, fields, sizeof(fields));
+    if (cursor.failed || fields[0] != SPLINE_CHECKPOINT_MAGIC)
+        return -1;
+    *sequence = fields[1];
+    return 0;
+}
+
+/**
+ * @brief	Restores the spline from the checkpoint in a slot of the spline file. The spline must be empty. The checkpoint
+ * 			is only used if it was taken for the same spline settings, is intact, and its last page is still on storage
+ * 			with the key the spline has for it. The spline may be left partly restored if the checkpoint is not used.
+ * @param	state				embedDB algorithm state structure
+ * @param	slot				0 or 1
+ * @param	checkpointPageId	Return value for the id of the first data page written after the checkpoint
+ * @return	Return 0 if the spline was restored. Non-zero value if the checkpoint cannot be used.
+ */
+int8_t restoreSplineCheckpoint(embedDBState *state, uint32_t slot, id_t *checkpointPageId) {
+    spline *spl = state->spl;
+    uint32_t pointSize = state->keySize + sizeof(uint32_t);
+    uint32_t fields[13];
+    splineCheckpointCursor cursor;
+    initCheckpointCursor(&cursor, state, slot, 1);
+    readCheckpointBytes(&cursor, fields, sizeof(fields));
+    if (cursor.failed || fields[0] != SPLINE_CHECKPOINT_MAGIC || fields[3] != (uint32_t)state->keySize || fields[4] != state->radixBits ||
+        fields[5] != spl->size || fields[6] != spl->maxError || fields[7] > spl->size || fields[8] >= spl->size)
+        return -1;
+
+    id_t pageId = fields[2];
+    spl->count = fields[7];
+    spl->pointsStartIndex = fields[8];
+    spl->lastLoc = fields[9];
+    spl->eraseSize = fields[10];
+    spl->numAddCalls = fields[11];
+    spl->tempLastPoint = fields[12];
+    readCheckpointBytes(&cursor, spl->lastKey, state->keySize);
+    readCheckpointBytes(&cursor, spl->lower, pointSize);
+    readCheckpointBytes(&cursor, spl->upper, pointSize);
+    readCheckpointBytes(&cursor, spl->firstSplinePoint, pointSize);
+    for (size_t i = 0; i < spl->count; i++)
+        readCheckpointBytes(&cursor, splinePointLocation(spl, i), pointSize);
+
+    if (state->radixBits > 0) {
+        radixspline *rdix = state->rdix;
+        uint32_t radixFields[4];
+        readCheckpointBytes(&cursor, radixFields, sizeof(radixFields));
+        if (cursor.failed || radixFields[3] >= spl->size)
             return -1;
+        rdix->shiftSize = (int8_t)radixFields[0];
+        rdix->prevPrefix = radixFields[1];
+        rdix->pointsSeen = radixFields[2];
+        rdix->minKey = (int8_t *)spl->points + (size_t)radixFields[3] * pointSize;
+        if (rdix->pointsSeen > 0) {
+            rdix->table = malloc(rdix->size * sizeof(id_t));
+            if (rdix->table == NULL)
+                return -1;
+            readCheckpointBytes(&cursor, rdix->table, rdix->size * sizeof(id_t));
         }
     }
 
+    uint32_t expectedChecksum = cursor.checksum, checksum = 0;
+    readCheckpointBytes(&cursor, &checksum, sizeof(uint32_t));
+    if (cursor.failed || checksum != expectedChecksum)
+        return -1;
+
+    /* The last page in the checkpoint must still be on storage. Pages written after it are added by the caller */
+    if (pageId <= state->minDataPageId || pageId > state->nextDataPageId || spl->count == 0)
+        return -1;
+    if (readPage(state, (pageId - 1) % state->numDataPages) != 0)
+        return -1;
+    id_t storedPageId = 0;
+    memcpy(&storedPageId, state->dataReadPage, sizeof(id_t));
+    if (storedPageId != pageId - 1 || memcmp(embedDBGetMinKey(state, state->dataReadPage), spl->lastKey, state->keySize) != 0)
+        return -1;
+
+    *checkpointPageId = pageId;
+    return 0;
+}
+
+int8_t embedDBSetSplineCheckpoint(embedDBState *state, void *splineFile, uint32_t checkpointEveryPages) {
+    if (state->spl == NULL || splineFile == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Spline checkpoints need a spline search method and a file.\n");
+#endif
+        return -1;
+    }
+
+    /* Largest checkpoint: the fixed fields, the spline's key and corridor points, every spline point, the radix table and the checksum */
+    uint32_t pointSize = state->keySize + sizeof(uint32_t);
+    uint32_t maxBytes = 13 * sizeof(uint32_t) + state->keySize + (3 + state->spl->size) * pointSize + sizeof(uint32_t);
+    if (state->radixBits > 0)
+        maxBytes += 4 * sizeof(uint32_t) + state->rdix->size * sizeof(id_t);
+    state->splineCheckpointSlotPages = (maxBytes + state->pageSize - 1) / state->pageSize;
+
+    uint32_t blockSize = state->fileInterface->blockSize != NULL ? state->fileInterface->blockSize(splineFile) : 0;
+    state->splineCheckpointPage = embedDBAlignedAlloc(blockSize > 1 ? blockSize : sizeof(void *), state->pageSize);
+    if (state->splineCheckpointPage == NULL)
+        return -1;
+
+    /* Checkpoints are only restored when pages were recovered and not yet added to the spline. Otherwise they are discarded */
+    id_t recoveredPageId = state->splineRecoveredPageId;
+    int8_t opened = recoveredPageId > 0 && state->fileInterface->open(splineFile, EMBEDDB_FILE_MODE_R_PLUS_B);
+    if (!opened && !state->fileInterface->open(splineFile, EMBEDDB_FILE_MODE_W_PLUS_B)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Can't open spline file!\n");
 #endif
+        embedDBAlignedFree(state->splineCheckpointPage);
+        state->splineCheckpointPage = NULL;
+        return -1;
+    }
+    state->splineFile = splineFile;
+    state->splineCheckpointEveryPages = checkpointEveryPages;
+    state->splineCheckpointSequence = 0;
+    state->splineCheckpointPageId = state->nextDataPageId;
+    if (recoveredPageId == 0)
+        return 0;
+
+    /* Try the newest checkpoint first. The next checkpoint replaces the one that was not restored */
+    state->splineRecoveredPageId = 0;
+    uint32_t sequences[2];
+    int8_t found[2];
+    for (uint32_t slot = 0; slot < 2; slot++)
+        found[slot] = readSplineCheckpointSequence(state, slot, &sequences[slot]) == 0;
+    uint32_t newest = found[1] && (!found[0] || sequences[1] > sequences[0]) ? 1 : 0;
+    for (uint32_t attempt = 0; attempt < 2; attempt++) {
+        uint32_t slot = attempt == 0 ? newest : 1 - newest;
+        if (!found[slot])
+            continue;
+        id_t checkpointPageId = 0;
+        if (restoreSplineCheckpoint(state, slot, &checkpointPageId) == 0) {
+            state->splineCheckpointSequence = sequences[slot] + 1;
+            if (state->cleanSpline && state->searchStrategy->erase != NULL)
+                state->searchStrategy->erase(state, &state->minKey);
+            addDataPagesToSearch(state, checkpointPageId, recoveredPageId);
+            state->splineCheckpointPageId = checkpointPageId;
+            return 0;
+        }
+
+        /* Start again from an empty spline */
+        state->searchStrategy->close(state);
+        if (initSearchStrategy(state, EMBEDDB_SEARCH_SPLINE, state->radixBits) != 0)
+            return -1;
+    }
+
+    addDataPagesToSearch(state, state->minDataPageId, recoveredPageId);
+    state->splineCheckpointPageId = state->minDataPageId;
+    return 0;
+}
+
+/**
+ * @brief	Given a key, searches for data associated with
+ *          that key in embedDB buffer using embedDBSearchNode.
+ *          Note: Space for data must be already allocated.
+ * @param	state	embedDB algorithm state structure
+ * @param   buffer  pointer to embedDB buffer
+ * @param	key		Key for record
+ * @param	data	Pre-allocated memory to copy data for record
+ * @param   range
+ * @return	Return non-negative integer representing offset if success. -1 value if error.
+ */
+int32_t searchBuffer(embedDBState *state, void *buffer, void *key, void *data) {
+    // return -1 if there is nothing in the buffer
+    if (EMBEDDB_GET_COUNT(buffer) == 0) {
+        return NO_RECORD_FOUND;
+    }
+    // find index of record inside of the write buffer
+    id_t nextId = embedDBSearchNode(state, buffer, key, 0);
+    // return 0 if found
+    if (nextId != NO_RECORD_FOUND) {
+        // Key found
+        memcpy(data, (void *)((int8_t *)buffer + state->headerSize + state->recordSize * nextId + state->keySize), state->dataSize);
+        return nextId;
+    }
+    // Key not found
+    return NO_RECORD_FOUND;
+}
+
+/**
+ * @brief	Given a key, returns data associated with key.
+ * 			Note: Space for data must be already allocated.
+ * 			Data is copied from database into data buffer.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for record
+ * @param	data	Pre-allocated memory to copy data for record
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBGet(embedDBState *state, void *key, void *data) {
+    void *outputBuffer = state->buffer;
+    if (state->nextDataPageId == 0) {
+        if (searchBuffer(state, outputBuffer, key, data) != NO_RECORD_FOUND)
+            return 0;
+
+#ifdef PRINT_ERRORS
+        printf("ERROR: No data in database.\n");
+#endif
+        return -1;
+    }
+
+    uint64_t thisKey = 0;
+    memcpy(&thisKey, key, state->keySize);
+
+    void *buf = state->dataReadPage;
+    int16_t numReads = 0;
+
+    // if write buffer is not empty
+    if ((EMBEDDB_GET_COUNT(outputBuffer) != 0)) {
+        // get the max/min key from output buffer
+        uint64_t bufMaxKey = 0;
+        uint64_t bufMinKey = 0;
+        memcpy(&bufMaxKey, embedDBGetMaxKey(state, outputBuffer), state->keySize);
+        memcpy(&bufMinKey, embedDBGetMinKey(state, outputBuffer), state->keySize);
+        // return -1 if key is not in buffer
+        if (thisKey > bufMaxKey) return -1;
+        // if key >= buffer's min, check buffer
+        if (thisKey >= bufMinKey) {
+            return searchBuffer(state, outputBuffer, key, data) == NO_RECORD_FOUND ? -1 : 0;
+        }
+    }
+
+    if (state->searchStrategy->findPage(state, key, &numReads) != 0)
+        return -1;
+    buf = state->dataReadPage;
+
     id_t nextId = embedDBSearchNode(state, buf, key, 0);
 
     if (nextId != -1) {
@@ -1245,15 +2395,15 @@ int8_t embedDBGetVar(embedDBState *state, void *key, void *data, embedDBVarDataS
         readToWriteBuf(state);
         // else if there are records in the file system, mem cpy fixed record into data
     } else if (embedDBGet(state, key, data) == RECORD_FOUND) {
-        // get pointer from the read buffer
-        void *buf = (int8_t *)state->buffer + (state->pageSize * EMBEDDB_DATA_READ_BUFFER);
+        // get pointer to the page that was read
+        void *buf = state->dataReadPage;
         // retrieve offset
         recordNum = embedDBSearchNode(state, buf, key, 0);
     } else {
         return NO_RECORD_FOUND;
     }
 
-    int8_t setupResult = embedDBSetupVarDataStream(state, key, varData, recordNum);
+    int8_t setupResult = embedDBSetupVarDataStream(state, key, varData, state->dataReadPage, recordNum);
 
     switch (setupResult) {
         case 0:
@@ -1294,21 +2444,49 @@ void embedDBInitIterator(embedDBState *state, embedDBIterator *it) {
 #endif
 
     // Determine which data page should be the first examined if there is a min key
-    if (it->minKey != NULL && SEARCH_METHOD == 2) {
-        /* Spline search */
-        uint32_t location, lowbound, highbound;
-        if (RADIX_BITS > 0) {
-            radixsplineFind(state->rdix, it->minKey, state->compareKey, &location, &lowbound, &highbound);
-        } else {
-            splineFind(state->spl, it->minKey, state->compareKey, &location, &lowbound, &highbound);
-        }
-
-        // Use the low bound as the start for our search
-        it->nextDataPage = max(lowbound, state->minDataPageId);
+    if (it->minKey != NULL && state->searchStrategy->firstPage != NULL) {
+        it->nextDataPage = max(state->searchStrategy->firstPage(state, it->minKey), state->minDataPageId);
     } else {
         it->nextDataPage = state->minDataPageId;
     }
     it->nextDataRec = 0;
+
+    /* Iterators use the state's read pages unless given their own buffers */
+    it->dataPage = NULL;
+    it->indexPage = NULL;
+    it->dataPageId = -1;
+    it->indexPageId = -1;
+    it->readAheadPages = 1;
+}
+
+/**
+ * @brief	Gives an iterator its own data and index page buffers.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @return	Return 0 if success, -1 if memory could not be allocated.
+ */
+int8_t embedDBIteratorAllocBuffers(embedDBState *state, embedDBIterator *it) {
+    it->dataPage = malloc(state->pageSize);
+    if (it->dataPage == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate iterator data page buffer.\n");
+#endif
+        return -1;
+    }
+    if (EMBEDDB_USING_INDEX(state->parameters)) {
+        it->indexPage = malloc(state->pageSize);
+        if (it->indexPage == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to allocate iterator index page buffer.\n");
+#endif
+            free(it->dataPage);
+            it->dataPage = NULL;
+            return -1;
+        }
+    }
+    it->dataPageId = -1;
+    it->indexPageId = -1;
+    return 0;
 }
 
 /**
@@ -1319,6 +2497,14 @@ void embedDBCloseIterator(embedDBIterator *it) {
     if (it->queryBitmap != NULL) {
         free(it->queryBitmap);
     }
+    if (it->dataPage != NULL) {
+        free(it->dataPage);
+        it->dataPage = NULL;
+    }
+    if (it->indexPage != NULL) {
+        free(it->indexPage);
+        it->indexPage = NULL;
+    }
 }
 
 /**
@@ -1326,6 +2512,13 @@ void embedDBCloseIterator(embedDBIterator *it) {
  * @param   state   algorithm state structure
  */
 void embedDBFlushVar(embedDBState *state) {
+    if (EMBEDDB_REWRITING_PARTIAL_PAGES(state->parameters)) {
+        // keep the page in the buffer and keep adding to it
+        writePartialVariablePage(state, (int8_t *)state->buffer + EMBEDDB_VAR_WRITE_BUFFER(state->parameters) * state->pageSize);
+        state->fileInterface->flush(state->varFile);
+        return;
+    }
+
     // only flush variable buffer
     writeVariablePage(state, (int8_t *)state->buffer + EMBEDDB_VAR_WRITE_BUFFER(state->parameters) * state->pageSize);
     state->fileInterface->flush(state->varFile);
@@ -1340,11 +2533,17 @@ void embedDBFlushVar(embedDBState *state) {
 /**
  * @brief	Flushes output buffer.
  * @param	state	algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a page could not be written or a file could not be flushed.
  */
 int8_t embedDBFlush(embedDBState *state) {
+    if (EMBEDDB_REWRITING_PARTIAL_PAGES(state->parameters))
+        return embedDBFlushPartialPages(state);
+
     // As the first buffer is the data write buffer, no address change is required
     id_t pageNum = writePage(state, (int8_t *)state->buffer + EMBEDDB_DATA_WRITE_BUFFER * state->pageSize);
-    state->fileInterface->flush(state->dataFile);
+    /* Flushing also waits for writes the file interface has not finished, so report any that failed */
+    int8_t success = pageNum != (id_t)-1;
+    success = state->fileInterface->flush(state->dataFile) && success;
 
     indexPage(state, pageNum);
 
@@ -1357,8 +2556,8 @@ int8_t embedDBFlush(embedDBState *state) {
         void *bm = EMBEDDB_GET_BITMAP(state->buffer);
         memcpy((void *)((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount), bm, state->bitmapSize);
 
-        writeIndexPage(state, buf);
-        state->fileInterface->flush(state->indexFile);
+        success = writeIndexPage(state, buf) != (id_t)-1 && success;
+        success = state->fileInterface->flush(state->indexFile) && success;
 
         /* Reinitialize buffer */
         initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
@@ -1370,8 +2569,8 @@ int8_t embedDBFlush(embedDBState *state) {
     // Flush var data page
     if (EMBEDDB_USING_VDATA(state->parameters)) {
         // send write buffer pointer to write variable page
-        writeVariablePage(state, (int8_t *)state->buffer + EMBEDDB_VAR_WRITE_BUFFER(state->parameters) * state->pageSize);
-        state->fileInterface->flush(state->varFile);
+        success = writeVariablePage(state, (int8_t *)state->buffer + EMBEDDB_VAR_WRITE_BUFFER(state->parameters) * state->pageSize) != (id_t)-1 && success;
+        success = state->fileInterface->flush(state->varFile) && success;
         // init new buffer
         initBufferPage(state, EMBEDDB_VAR_WRITE_BUFFER(state->parameters));
         // determine how many bytes are left
@@ -1379,9 +2578,178 @@ int8_t embedDBFlush(embedDBState *state) {
         // create new offset
         state->currentVarLoc += temp + state->variableDataHeaderSize;
     }
+    return success ? 0 : -1;
+}
+
+/**
+ * @brief	Flushes output buffers by writing each page in place. The pages stay in the write buffers, so the next records
+ * 			are added to them and the next flush writes them again. Pages are only indexed once they are full.
+ * @param	state	algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a page could not be written or a file could not be flushed.
+ */
+int8_t embedDBFlushPartialPages(embedDBState *state) {
+    int8_t success = 1;
+    count_t count = EMBEDDB_GET_COUNT(state->buffer);
+    if (count > 0)
+        success = writePartialPage(state, state->buffer) != (id_t)-1;
+    success = state->fileInterface->flush(state->dataFile) && success;
+
+    if (EMBEDDB_USING_INDEX(state->parameters)) {
+        void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
+        count_t idxcount = EMBEDDB_GET_COUNT(buf);
+        if (count > 0 && idxcount >= state->maxIdxRecordsPerPage) {
+            /* No room for the partial data page. Save the full index page now instead of when the data page is full */
+            success = writeIndexPage(state, buf) != (id_t)-1 && success;
+            idxcount = 0;
+            initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
+            id_t *ptr = (id_t *)((int8_t *)buf + 8);
+            *ptr = state->nextDataPageId;
+        }
+
+        /* Save the bitmap of the partial data page without counting it. It is counted when the data page is full */
+        if (count > 0) {
+            void *bm = EMBEDDB_GET_BITMAP(state->buffer);
+            memcpy((void *)((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount), bm, state->bitmapSize);
+            EMBEDDB_INC_COUNT(buf);
+        }
+        if (EMBEDDB_GET_COUNT(buf) > 0)
+            success = writePartialIndexPage(state, buf) != (id_t)-1 && success;
+        EMBEDDB_GET_COUNT(buf) = idxcount;
+        success = state->fileInterface->flush(state->indexFile) && success;
+    }
+
+    if (EMBEDDB_USING_VDATA(state->parameters)) {
+        /* Only write the variable data page if there is data after its header */
+        if (state->currentVarLoc % state->pageSize > (uint32_t)state->variableDataHeaderSize)
+            success = writePartialVariablePage(state, (int8_t *)state->buffer + EMBEDDB_VAR_WRITE_BUFFER(state->parameters) * state->pageSize) != (id_t)-1 && success;
+        success = state->fileInterface->flush(state->varFile) && success;
+    }
+    return success ? 0 : -1;
+}
+
+/**
+ * @brief	Sets when pages written to storage are made durable.
+ * @param	state			embedDB algorithm state structure
+ * @param	syncEveryPages	Commit after this many pages have been written. 0 to disable
+ * @param	syncIntervalMs	Commit when a page is written at least this many milliseconds after the last commit. 0 to disable
+ * @param	currentTimeMs	Returns the current time in milliseconds. Required if syncIntervalMs is not 0
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBSetDurability(embedDBState *state, uint32_t syncEveryPages, uint32_t syncIntervalMs, uint32_t (*currentTimeMs)(void)) {
+    if (syncIntervalMs > 0 && currentTimeMs == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: A clock is required to commit every %d ms.\n", syncIntervalMs);
+#endif
+        return -1;
+    }
+
+    state->syncEveryPages = syncEveryPages;
+    state->syncIntervalMs = syncIntervalMs;
+    state->currentTimeMs = currentTimeMs;
+    if (currentTimeMs != NULL)
+        state->lastSyncTime = currentTimeMs();
+    return 0;
+}
+
+/**
+ * @brief	Syncs a file with the file interface's sync function, or flush if it does not have one.
+ * @return	1 for success and 0 for failure
+ */
+int8_t embedDBSyncFile(embedDBState *state, void *file) {
+    if (state->fileInterface->sync != NULL)
+        return state->fileInterface->sync(file);
+    return state->fileInterface->flush(file);
+}
+
+/**
+ * @brief	Group commit. Syncs each file written since the last commit once.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a file could not be synced.
+ */
+int8_t embedDBCommit(embedDBState *state) {
+    if (state->unsyncedFiles == 0)
+        return 0;
+
+    /* Data and variable data first so the index never refers to pages that were lost */
+    int8_t success = 1;
+    if (state->unsyncedFiles & EMBEDDB_DATA_FILE)
+        success = embedDBSyncFile(state, state->dataFile) && success;
+    if (state->unsyncedFiles & EMBEDDB_VAR_FILE)
+        success = embedDBSyncFile(state, state->varFile) && success;
+    if (state->unsyncedFiles & EMBEDDB_INDEX_FILE)
+        success = embedDBSyncFile(state, state->indexFile) && success;
+
+    state->unsyncedFiles = 0;
+    state->numUnsyncedPages = 0;
+    if (state->currentTimeMs != NULL)
+        state->lastSyncTime = state->currentTimeMs();
+    state->numSyncs++;
+
+    if (!success) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to sync files.\n");
+#endif
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Keeps every index page in memory. Loads the live index pages from storage.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBCacheIndex(embedDBState *state) {
+    if (state->indexFile == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Cannot cache the index when not using an index file.\n");
+#endif
+        return -1;
+    }
+    if (state->indexCache != NULL)
+        return 0;
+
+    void *cache = malloc((size_t)state->numIndexPages * state->pageSize);
+    if (cache == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the index cache.\n");
+#endif
+        return -1;
+    }
+
+    for (id_t pageId = state->minIndexPageId; pageId < state->nextIdxPageId; pageId++) {
+        id_t physicalPageId = pageId % state->numIndexPages;
+        if (0 == state->fileInterface->read((int8_t *)cache + (size_t)physicalPageId * state->pageSize, physicalPageId, state->pageSize, state->indexFile)) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to read index page %i (%i) into the index cache.\n", pageId, physicalPageId);
+#endif
+            free(cache);
+            return -1;
+        }
+        state->numIdxReads++;
+    }
+
+    state->indexCache = cache;
     return 0;
 }
 
+/**
+ * @brief	Commits if the durability policy set with embedDBSetDurability says it is time to.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a file could not be synced.
+ */
+int8_t embedDBCommitIfDue(embedDBState *state) {
+    if (state->numUnsyncedPages == 0)
+        return 0;
+
+    int8_t due = state->syncEveryPages > 0 && state->numUnsyncedPages >= state->syncEveryPages;
+    if (!due && state->syncIntervalMs > 0)
+        due = state->currentTimeMs() - state->lastSyncTime >= state->syncIntervalMs;
+    if (!due)
+        return 0;
+    return embedDBCommit(state);
+}
+
 /**
  * @brief	Iterates through a page in the read buffer.
  * @param	state	embedDB algorithm state structure
@@ -1392,7 +2760,7 @@ int8_t embedDBFlush(embedDBState *state) {
  */
 int8_t iterateReadBuffer(embedDBState *state, embedDBIterator *it, void *key, void *data) {
     //  Keep reading record until we find one that matches the query
-    int8_t *buf = (int8_t *)state->buffer + EMBEDDB_DATA_READ_BUFFER * state->pageSize;
+    int8_t *buf = (int8_t *)(it->dataPage != NULL ? it->dataPage : state->dataReadPage);
     uint32_t pageRecordCount = EMBEDDB_GET_COUNT(buf);
 
     while (it->nextDataRec < pageRecordCount) {
@@ -1400,13 +2768,13 @@ int8_t iterateReadBuffer(embedDBState *state, embedDBIterator *it, void *key, vo
         memcpy(data, buf + state->headerSize + it->nextDataRec * state->recordSize + state->keySize, state->dataSize);
         it->nextDataRec++;
         // Check record
-        if (it->minKey != NULL && state->compareKey(key, it->minKey) < 0)
+        if (it->minKey != NULL && compareKeys(state, key, it->minKey) < 0)
             continue;
-        if (it->maxKey != NULL && state->compareKey(key, it->maxKey) > 0)
+        if (it->maxKey != NULL && compareKeys(state, key, it->maxKey) > 0)
             return ITERATE_NO_MORE_RECORDS;
-        if (it->minData != NULL && state->compareData(data, it->minData) < 0)
+        if (it->minData != NULL && compareDataValues(state, data, it->minData) < 0)
             continue;
-        if (it->maxData != NULL && state->compareData(data, it->maxData) > 0)
+        if (it->maxData != NULL && compareDataValues(state, data, it->maxData) > 0)
             continue;
         // If we make it here, the record matches the query
         return ITERATE_MATCH;
@@ -1434,7 +2802,13 @@ int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *da
             // if there are no records in the buffer, return
             if (EMBEDDB_GET_COUNT(outputBuffer) == 0) return 0;
             // else, place write buffer in read
-            readToWriteBuf(state);
+            if (it->dataPage != NULL) {
+                // Records can still be added to the write buffer, so it is copied again on every call
+                memcpy(it->dataPage, outputBuffer, state->pageSize);
+                it->dataPageId = -1;
+            } else {
+                readToWriteBuf(state);
+            }
             // search read buffer
             int i = iterateReadBuffer(state, it, key, data);
             return (i != ITERATE_NO_MATCH) ? i : 0;
@@ -1448,15 +2822,25 @@ int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *da
             if (state->indexFile != NULL && indexPage >= state->minIndexPageId && indexPage < state->nextIdxPageId) {
                 // If the index page that contains this data page exists, else we must read the data page regardless cause we don't have the index saved for it
 
-                if (readIndexPage(state, indexPage % state->numIndexPages) != 0) {
+                // Stored index pages never change, so the iterator's copy stays valid
+                void *indexBuf = it->indexPage;
+                if (indexBuf == NULL || it->indexPageId != indexPage) {
+                    if (readIndexPage(state, indexPage % state->numIndexPages) != 0) {
 #ifdef PRINT_ERRORS
-                    printf("ERROR: Failed to read index page %i (%i)\n", indexPage, indexPage % state->numIndexPages);
+                        printf("ERROR: Failed to read index page %i (%i)\n", indexPage, indexPage % state->numIndexPages);
 #endif
-                    return 0;
+                        return 0;
+                    }
+                    if (indexBuf != NULL) {
+                        memcpy(indexBuf, state->indexReadPage, state->pageSize);
+                        it->indexPageId = indexPage;
+                    } else {
+                        indexBuf = state->indexReadPage;
+                    }
                 }
 
                 // Get bitmap for data page in question
-                void *indexBM = (int8_t *)state->buffer + EMBEDDB_INDEX_READ_BUFFER * state->pageSize + EMBEDDB_IDX_HEADER_SIZE + indexRec * state->bitmapSize;
+                void *indexBM = (int8_t *)indexBuf + EMBEDDB_IDX_HEADER_SIZE + indexRec * state->bitmapSize;
 
                 // Determine if we should read the data page
                 if (!bitmapOverlap(it->queryBitmap, indexBM, state->bitmapSize)) {
@@ -1467,15 +2851,26 @@ int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *da
             }
         }
 
-        if (readPage(state, it->nextDataPage % state->numDataPages) != 0) {
+        // Stored data pages never change, so the iterator's copy of its current page stays valid
+        if (it->dataPage == NULL || it->dataPageId != it->nextDataPage) {
+            if (readIteratorPage(state, it) != 0) {
 #ifdef PRINT_ERRORS
-            printf("ERROR: Failed to read data page %i (%i)\n", it->nextDataPage, it->nextDataPage % state->numDataPages);
+                printf("ERROR: Failed to read data page %i (%i)\n", it->nextDataPage, it->nextDataPage % state->numDataPages);
 #endif
-            return 0;
+                return 0;
+            }
+            if (it->dataPage != NULL) {
+                memcpy(it->dataPage, state->dataReadPage, state->pageSize);
+                it->dataPageId = it->nextDataPage;
+            }
         }
 
         int8_t i = iterateReadBuffer(state, it, key, data);
         if (i != ITERATE_NO_MATCH) return i;
+        // Keys increase from page to page, so there is nothing left to read if this page reached the max key
+        void *page = it->dataPage != NULL ? it->dataPage : state->dataReadPage;
+        if (it->maxKey != NULL && EMBEDDB_GET_COUNT(page) > 0 && compareKeys(state, embedDBGetMaxKey(state, page), it->maxKey) >= 0)
+            return 0;
         // Finished reading through whole data page and didn't find a match
         it->nextDataPage++;
         it->nextDataRec = 0;
@@ -1513,7 +2908,8 @@ int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void
 
     // Get the vardata address from the record
     count_t recordNum = it->nextDataRec - 1;
-    int8_t setupResult = embedDBSetupVarDataStream(state, key, varData, recordNum);
+    void *dataPage = it->dataPage != NULL ? it->dataPage : state->dataReadPage;
+    int8_t setupResult = embedDBSetupVarDataStream(state, key, varData, dataPage, recordNum);
     switch (setupResult) {
         case 0:
         case 1:
@@ -1533,9 +2929,9 @@ int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void
  * @param   varData Return variable for variable data as a embedDBVarDataStream (Unallocated). Returns NULL if no variable data. **Be sure to free the stream after you are done with it**
  * @return  Returns 0 if sucessfull or no variable data for the record, 1 if the records variable data was overwritten, 2 if the page failed to read, and 3 if the memorey failed to allocate.
  */
-int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataStream **varData, id_t recordNumber) {
+int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataStream **varData, void *dataPage, id_t recordNumber) {
     // create pointer to read buffer
-    void *dataBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+    void *dataBuf = dataPage;
     // create pointer for record inside read buffer
     void *record = (int8_t *)dataBuf + state->headerSize + recordNumber * state->recordSize;
     // create pointer for variable record which is an offset to approximate location
@@ -1548,7 +2944,7 @@ int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataS
     }
 
     // Check if the variable data associated with this key has been overwritten due to file wrap around
-    if (state->compareKey(key, &state->minVarRecordId) < 0) {
+    if (compareKeys(state, key, &state->minVarRecordId) < 0) {
         *varData = NULL;
         return 1;
     }
@@ -1564,7 +2960,7 @@ int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataS
     }
 
     // Get length of variable data
-    void *varBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    void *varBuf = state->varReadPage;
     uint32_t pageOffset = varDataAddr % state->pageSize;
     uint32_t dataLen = 0;
     memcpy(&dataLen, (int8_t *)varBuf + pageOffset, sizeof(uint32_t));
@@ -1622,12 +3018,11 @@ uint32_t embedDBVarDataStreamRead(embedDBState *state, embedDBVarDataStream *str
     }
 
     // Keep reading in data until the buffer is full
-    void *varDataBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
     uint32_t amtRead = 0;
     while (amtRead < length && stream->bytesRead < stream->totalBytes) {
         uint16_t pageOffset = stream->fileOffset % state->pageSize;
         uint32_t amtToRead = min(stream->totalBytes - stream->bytesRead, min(state->pageSize - pageOffset, length - amtRead));
-        memcpy((int8_t *)buffer + amtRead, (int8_t *)varDataBuf + pageOffset, amtToRead);
+        memcpy((int8_t *)buffer + amtRead, (int8_t *)state->varReadPage + pageOffset, amtToRead);
         amtRead += amtToRead;
         stream->bytesRead += amtToRead;
         stream->fileOffset += amtToRead;
@@ -1655,19 +3050,15 @@ uint32_t embedDBVarDataStreamRead(embedDBState *state, embedDBVarDataStream *str
 void embedDBPrintStats(embedDBState *state) {
     printf("Num reads: %d\n", state->numReads);
     printf("Buffer hits: %d\n", state->bufferHits);
+    printf("Buffer misses: %d\n", state->bufferMisses);
     printf("Num writes: %d\n", state->numWrites);
     printf("Num index reads: %d\n", state->numIdxReads);
     printf("Num index writes: %d\n", state->numIdxWrites);
+    printf("Num syncs: %d\n", state->numSyncs);
     printf("Max Error: %d\n", state->maxError);
 
-    if (SEARCH_METHOD == 2) {
-        if (RADIX_BITS > 0) {
-            splinePrint(state->rdix->spl);
-            radixsplinePrint(state->rdix);
-        } else {
-            splinePrint(state->spl);
-        }
-    }
+    if (state->searchStrategy->print != NULL)
+        state->searchStrategy->print(state);
 }
 
 /**
@@ -1677,36 +3068,63 @@ void embedDBPrintStats(embedDBState *state) {
  * @return	Return page number if success, -1 if error.
  */
 id_t writePage(embedDBState *state, void *buffer) {
-    if (state->dataFile == NULL)
+    id_t pageNum = writePartialPage(state, buffer);
+    if (pageNum == (id_t)-1)
         return -1;
 
     /* Always writes to next page number. Returned to user. */
-    id_t pageNum = state->nextDataPageId++;
+    state->nextDataPageId++;
+    state->partialPagesWritten &= ~EMBEDDB_DATA_FILE;
+    return pageNum;
+}
+
+/**
+ * @brief	Writes page in buffer to storage as the next data page without moving on to the page after it, so the page can
+ * 			be written again once more records are added. Space for the page is only made the first time it is written.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Buffer for writing out page
+ * @return	Return page number if success, -1 if error.
+ */
+id_t writePartialPage(embedDBState *state, void *buffer) {
+    if (state->dataFile == NULL)
+        return -1;
+
+    id_t pageNum = state->nextDataPageId;
 
     /* Setup page number in header */
     memcpy(buffer, &(pageNum), sizeof(id_t));
 
-    if (state->numAvailDataPages <= 0) {
-        // Erase pages to make space for new data
-        state->numAvailDataPages += state->eraseSizeInPages;
-        state->minDataPageId += state->eraseSizeInPages;
-        if (state->cleanSpline)
-            cleanSpline(state, &state->minKey);
-        // Estimate the smallest key now. Could determine exactly by reading this page
-        state->minKey += state->eraseSizeInPages * state->maxRecordsPerPage * state->avgKeyDiff;
+    if (!(state->partialPagesWritten & EMBEDDB_DATA_FILE)) {
+        if (state->numAvailDataPages <= 0) {
+            // Erase pages to make space for new data
+            embedDBEraseBlock(state, state->dataFile, pageNum % state->numDataPages);
+            state->numAvailDataPages += state->eraseSizeInPages;
+            state->minDataPageId += state->eraseSizeInPages;
+            if (state->cleanSpline && state->searchStrategy->erase != NULL)
+                state->searchStrategy->erase(state, &state->minKey);
+            // Estimate the smallest key now. Could determine exactly by reading this page
+            state->minKey += state->eraseSizeInPages * state->maxRecordsPerPage * state->avgKeyDiff;
+        }
+        state->numAvailDataPages--;
+        state->partialPagesWritten |= EMBEDDB_DATA_FILE;
     }
 
+    /* Page in the read buffer or buffer pool is being overwritten */
+    id_t physicalPageId = pageNum % state->numDataPages;
+    invalidateBufferedPage(state, EMBEDDB_DATA_FILE, physicalPageId);
+
     /* Seek to page location in file */
-    int32_t val = state->fileInterface->write(buffer, pageNum % state->numDataPages, state->pageSize, state->dataFile);
+    int32_t val = state->fileInterface->write(buffer, physicalPageId, state->pageSize, state->dataFile);
     if (val == 0) {
 #ifdef PRINT_ERRORS
-        printf("Failed to write data page: %i (%i)\n", pageNum, pageNum % state->numDataPages);
+        printf("Failed to write data page: %i (%i)\n", pageNum, physicalPageId);
 #endif
         return -1;
     }
 
-    state->numAvailDataPages--;
     state->numWrites++;
+    state->unsyncedFiles |= EMBEDDB_DATA_FILE;
+    state->numUnsyncedPages++;
 
     return pageNum;
 }
@@ -1718,11 +3136,12 @@ id_t writePage(embedDBState *state, void *buffer) {
  * @return	Returns the number of points deleted
  */
 uint32_t cleanSpline(embedDBState *state, void *key) {
+    splineSearchLoad(state);
     uint32_t numPointsErased = 0;
     void *currentPoint;
     for (size_t i = 0; i < state->spl->count; i++) {
         currentPoint = splinePointLocation(state->spl, i);
-        int8_t compareResult = state->compareKey(currentPoint, key);
+        int8_t compareResult = compareKeys(state, currentPoint, key);
         if (compareResult < 0)
             numPointsErased++;
         else
@@ -1741,32 +3160,62 @@ uint32_t cleanSpline(embedDBState *state, void *key) {
  * @return	Return page number if success, -1 if error.
  */
 id_t writeIndexPage(embedDBState *state, void *buffer) {
-    if (state->indexFile == NULL)
+    id_t pageNum = writePartialIndexPage(state, buffer);
+    if (pageNum == (id_t)-1)
         return -1;
 
     /* Always writes to next page number. Returned to user. */
-    id_t pageNum = state->nextIdxPageId++;
+    state->nextIdxPageId++;
+    state->partialPagesWritten &= ~EMBEDDB_INDEX_FILE;
+    return pageNum;
+}
+
+/**
+ * @brief	Writes index page in buffer to storage as the next index page without moving on to the page after it.
+ * 			Space for the page is only made the first time it is written.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Buffer to use for writing index page
+ * @return	Return page number if success, -1 if error.
+ */
+id_t writePartialIndexPage(embedDBState *state, void *buffer) {
+    if (state->indexFile == NULL)
+        return -1;
+
+    id_t pageNum = state->nextIdxPageId;
 
     /* Setup page number in header */
     memcpy(buffer, &(pageNum), sizeof(id_t));
 
-    if (state->numAvailIndexPages <= 0) {
-        // Erase index pages to make room for new page
-        state->numAvailIndexPages += state->eraseSizeInPages;
-        state->minIndexPageId += state->eraseSizeInPages;
+    if (!(state->partialPagesWritten & EMBEDDB_INDEX_FILE)) {
+        if (state->numAvailIndexPages <= 0) {
+            // Erase index pages to make room for new page
+            embedDBEraseBlock(state, state->indexFile, pageNum % state->numIndexPages);
+            state->numAvailIndexPages += state->eraseSizeInPages;
+            state->minIndexPageId += state->eraseSizeInPages;
+        }
+        state->numAvailIndexPages--;
+        state->partialPagesWritten |= EMBEDDB_INDEX_FILE;
     }
 
+    /* Page in the index read buffer or buffer pool is being overwritten */
+    id_t physicalPageId = pageNum % state->numIndexPages;
+    invalidateBufferedPage(state, EMBEDDB_INDEX_FILE, physicalPageId);
+
     /* Seek to page location in file */
-    int32_t val = state->fileInterface->write(buffer, pageNum % state->numIndexPages, state->pageSize, state->indexFile);
+    int32_t val = state->fileInterface->write(buffer, physicalPageId, state->pageSize, state->indexFile);
     if (val == 0) {
 #ifdef PRINT_ERRORS
-        printf("Failed to write index page: %i (%i)\n", pageNum, pageNum % state->numIndexPages);
+        printf("Failed to write index page: %i (%i)\n", pageNum, physicalPageId);
 #endif
         return -1;
     }
 
-    state->numAvailIndexPages--;
+    if (state->indexCache != NULL)
+        memcpy((int8_t *)state->indexCache + (size_t)physicalPageId * state->pageSize, buffer, state->pageSize);
+
     state->numIdxWrites++;
+    state->unsyncedFiles |= EMBEDDB_INDEX_FILE;
+    state->numUnsyncedPages++;
 
     return pageNum;
 }
@@ -1778,6 +3227,23 @@ id_t writeIndexPage(embedDBState *state, void *buffer) {
  * @return	Return page number if success, -1 if error.
  */
 id_t writeVariablePage(embedDBState *state, void *buffer) {
+    id_t pageNum = writePartialVariablePage(state, buffer);
+    if (pageNum == (id_t)-1)
+        return -1;
+
+    state->nextVarPageId++;
+    state->partialPagesWritten &= ~EMBEDDB_VAR_FILE;
+    return pageNum;
+}
+
+/**
+ * @brief	Writes variable data page in buffer to storage as the next variable data page without moving on to the page
+ * 			after it. Space for the page is only made the first time it is written.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Buffer to use to write page to storage
+ * @return	Return page number if success, -1 if error.
+ */
+id_t writePartialVariablePage(embedDBState *state, void *buffer) {
     if (state->varFile == NULL) {
         return -1;
     }
@@ -1785,25 +3251,38 @@ id_t writeVariablePage(embedDBState *state, void *buffer) {
     // Make sure the address being witten to wraps around
     id_t physicalPageId = state->nextVarPageId % state->numVarPages;
 
-    // Erase data if needed
-    if (state->numAvailVarPages <= 0) {
-        state->numAvailVarPages += state->eraseSizeInPages;
-        // Last page that is deleted
-        id_t pageNum = (physicalPageId + state->eraseSizeInPages - 1) % state->numVarPages;
-
-        // Read in that page so we can update which records we still have the data for
-        if (readVariablePage(state, pageNum) != 0) {
-            return -1;
+    if (!(state->partialPagesWritten & EMBEDDB_VAR_FILE)) {
+        // Erase data if needed
+        if (state->numAvailVarPages <= 0) {
+            // Last page that is deleted
+            id_t pageNum = (physicalPageId + state->eraseSizeInPages - 1) % state->numVarPages;
+            uint32_t blockNum = physicalPageId / state->eraseSizeInPages;
+
+            // Update which records we still have the data for with the largest key of the block. It is known if the
+            // last page of the block was written since init, otherwise the page is read
+            if (pageNum / state->eraseSizeInPages == blockNum && state->nextVarPageId + state->eraseSizeInPages - 1 >= state->varBlockKeysFromPageId + state->numVarPages) {
+                memcpy(&state->minVarRecordId, (int8_t *)state->varBlockMaxKeys + blockNum * state->keySize, state->keySize);
+            } else {
+                if (readVariablePage(state, pageNum) != 0) {
+                    return -1;
+                }
+                memcpy(&state->minVarRecordId, (int8_t *)state->varReadPage + sizeof(id_t), state->keySize);
+            }
+            state->minVarRecordId += 1;  // Add one because the result from the last line is a record that is erased
+            embedDBEraseBlock(state, state->varFile, physicalPageId);
+            state->numAvailVarPages += state->eraseSizeInPages;
         }
-        void *buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters) + sizeof(id_t);
-        memcpy(&state->minVarRecordId, buf, state->keySize);
-        state->minVarRecordId += 1;  // Add one because the result from the last line is a record that is erased
+        state->numAvailVarPages--;
+        state->partialPagesWritten |= EMBEDDB_VAR_FILE;
     }
 
     // Add logical page number to data page
     void *buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_WRITE_BUFFER(state->parameters);
     memcpy(buf, &state->nextVarPageId, sizeof(id_t));
 
+    // Page in the variable read buffer or buffer pool is being overwritten
+    invalidateBufferedPage(state, EMBEDDB_VAR_FILE, physicalPageId);
+
     // Write to file
     uint32_t val = state->fileInterface->write(buffer, physicalPageId, state->pageSize, state->varFile);
     if (val == 0) {
@@ -1813,11 +3292,14 @@ id_t writeVariablePage(embedDBState *state, void *buffer) {
         return -1;
     }
 
-    state->nextVarPageId++;
-    state->numAvailVarPages--;
+    /* Pages are written in key order, so the last page written to a block has its largest key */
+    memcpy((int8_t *)state->varBlockMaxKeys + physicalPageId / state->eraseSizeInPages * state->keySize, (int8_t *)buffer + sizeof(id_t), state->keySize);
+
     state->numWrites++;
+    state->unsyncedFiles |= EMBEDDB_VAR_FILE;
+    state->numUnsyncedPages++;
 
-    return state->nextVarPageId - 1;
+    return state->nextVarPageId;
 }
 
 /**
@@ -1827,23 +3309,354 @@ id_t writeVariablePage(embedDBState *state, void *buffer) {
  * @return	Return 0 if success, -1 if error.
  */
 int8_t readPage(embedDBState *state, id_t pageNum) {
-    /* Check if page is currently in buffer */
-    if (pageNum == state->bufferedPageId) {
+    int8_t result = readBufferedPage(state, EMBEDDB_DATA_FILE, pageNum, EMBEDDB_DATA_READ_BUFFER, &state->bufferedPageId, &state->dataReadPage);
+    if (result < 0)
+        return -1;
+    if (result == 1)
+        state->numReads++;
+    return 0;
+}
+
+/**
+ * @brief	Makes a page of a file the file's current read page. The page is used from the buffer pool if it is there.
+ * 			Otherwise it is read into a pool frame chosen by CLOCK replacement, or mapped or read into the file's read
+ * 			buffer if there is no pool or every frame is pinned.
+ * @param	state			embedDB algorithm state structure
+ * @param	file			EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	pageNum			Physical page number to read
+ * @param	bufferNum		Page of the embedDB buffer that is the file's read buffer
+ * @param	bufferedPageId	Page id held by the file's current read page (e.g. state->bufferedPageId)
+ * @param	readPage		The file's current read page (e.g. state->dataReadPage)
+ * @return	Return 0 if the page was buffered, 1 if it was read from storage, -1 if error.
+ */
+int8_t readBufferedPage(embedDBState *state, uint8_t file, id_t pageNum, uint8_t bufferNum, id_t *bufferedPageId, void **readPage) {
+    /* Check if page is the current read page */
+    if (pageNum == *bufferedPageId) {
         state->bufferHits++;
         return 0;
     }
 
-    // point to write buffer
-    void *buf = (int8_t *)state->buffer + state->pageSize;
+    /* Check if page is in the buffer pool */
+    int32_t frameNum = findPoolFrame(state, file, pageNum);
+    if (frameNum >= 0) {
+        state->poolFrames[frameNum].referenced = 1;
+        setReadPage(state, readPage, getPoolPage(state, frameNum));
+        *bufferedPageId = pageNum;
+        state->bufferHits++;
+        return 0;
+    }
+
+    void *fileData = file == EMBEDDB_DATA_FILE ? state->dataFile : (file == EMBEDDB_INDEX_FILE ? state->indexFile : state->varFile);
+    void *page;
+    frameNum = allocPoolFrame(state);
+    if (frameNum >= 0) {
+        page = getPoolPage(state, frameNum);
+        if (0 == state->fileInterface->read(page, pageNum, state->pageSize, fileData))
+            return -1;
+        state->poolFrames[frameNum].pageId = pageNum;
+        state->poolFrames[frameNum].file = file;
+        state->poolFrames[frameNum].referenced = 1;
+    } else {
+        page = mapOrReadPage(state, fileData, pageNum, bufferNum);
+        if (page == NULL)
+            return -1;
+    }
+
+    setReadPage(state, readPage, page);
+    *bufferedPageId = pageNum;
+    state->bufferMisses++;
+    return 1;
+}
+
+/**
+ * @brief	Returns a page of the buffer pool.
+ * @param	state		embedDB algorithm state structure
+ * @param	frameNum	Frame number
+ * @return	Pointer to the frame's page
+ */
+void *getPoolPage(embedDBState *state, uint32_t frameNum) {
+    return (int8_t *)state->poolPages + (size_t)state->pageSize * frameNum;
+}
+
+/**
+ * @brief	Finds the buffer pool frame holding a page.
+ * @param	state	embedDB algorithm state structure
+ * @param	file	EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	pageNum	Physical page number
+ * @return	Frame number, or -1 if the page is not in the pool
+ */
+int32_t findPoolFrame(embedDBState *state, uint8_t file, id_t pageNum) {
+    for (uint32_t i = 0; i < state->numPoolFrames; i++) {
+        if (state->poolFrames[i].pageId == pageNum && state->poolFrames[i].file == file)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief	Chooses a buffer pool frame to read a page into with the CLOCK algorithm. The clock hand skips pinned frames
+ * 			and clears the reference bit of frames used since it last passed, so the first unpinned frame that was not used
+ * 			recently is replaced. The frame is emptied.
+ * @param	state	embedDB algorithm state structure
+ * @return	Frame number, or -1 if there is no pool or every frame is pinned
+ */
+int32_t allocPoolFrame(embedDBState *state) {
+    /* Two turns of the clock clear every reference bit, so an unpinned frame is found if there is one */
+    for (uint32_t i = 0; i < 2 * state->numPoolFrames; i++) {
+        uint32_t frameNum = state->poolClockHand;
+        embedDBBufferFrame *frame = &state->poolFrames[frameNum];
+        state->poolClockHand = (frameNum + 1) % state->numPoolFrames;
+        if (frame->pinCount > 0)
+            continue;
+        if (frame->referenced) {
+            frame->referenced = 0;
+            continue;
+        }
+        frame->pageId = -1;
+        return frameNum;
+    }
+    return -1;
+}
+
+/**
+ * @brief	Changes the current read page of a file. The current read page of each file is pinned while it is in the
+ * 			buffer pool, since queries keep using it between reads.
+ * @param	state		embedDB algorithm state structure
+ * @param	readPage	state->dataReadPage, state->indexReadPage or state->varReadPage
+ * @param	page		New current read page
+ */
+void setReadPage(embedDBState *state, void **readPage, void *page) {
+    size_t poolSize = (size_t)state->pageSize * state->numPoolFrames;
+    if ((int8_t *)*readPage >= (int8_t *)state->poolPages && (int8_t *)*readPage < (int8_t *)state->poolPages + poolSize)
+        state->poolFrames[((int8_t *)*readPage - (int8_t *)state->poolPages) / state->pageSize].pinCount--;
+    if ((int8_t *)page >= (int8_t *)state->poolPages && (int8_t *)page < (int8_t *)state->poolPages + poolSize)
+        state->poolFrames[((int8_t *)page - (int8_t *)state->poolPages) / state->pageSize].pinCount++;
+    *readPage = page;
+}
+
+/**
+ * @brief	Forgets any buffered copy of a page that is being overwritten.
+ * @param	state			embedDB algorithm state structure
+ * @param	file			EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	physicalPageId	Page being written
+ */
+void invalidateBufferedPage(embedDBState *state, uint8_t file, id_t physicalPageId) {
+    if (file == EMBEDDB_DATA_FILE && state->bufferedPageId == physicalPageId)
+        state->bufferedPageId = -1;
+    else if (file == EMBEDDB_INDEX_FILE && state->bufferedIndexPageId == physicalPageId)
+        state->bufferedIndexPageId = -1;
+    else if (file == EMBEDDB_VAR_FILE && state->bufferedVarPage == physicalPageId)
+        state->bufferedVarPage = -1;
+
+    int32_t frameNum = findPoolFrame(state, file, physicalPageId);
+    if (frameNum >= 0)
+        state->poolFrames[frameNum].pageId = -1;
+}
+
+/**
+ * @brief	Returns a pointer to the given page of a file. If the file interface can map the page it is used directly,
+ * 			otherwise the page is read into the given page of the embedDB buffer.
+ * @param	state		embedDB algorithm state structure
+ * @param	file		File to get the page from
+ * @param	pageNum		Page number to get
+ * @param	bufferNum	Page of the embedDB buffer to read into if the page cannot be mapped
+ * @return	Pointer to the page, or NULL if the page could not be read.
+ */
+void *mapOrReadPage(embedDBState *state, void *file, id_t pageNum, uint8_t bufferNum) {
+    if (state->fileInterface->mapPage != NULL) {
+        void *page = state->fileInterface->mapPage(pageNum, state->pageSize, file);
+        if (page != NULL)
+            return page;
+    }
+
+    void *buf = (int8_t *)state->buffer + state->pageSize * bufferNum;
+    if (0 == state->fileInterface->read(buf, pageNum, state->pageSize, file))
+        return NULL;
+    return buf;
+}
+
+/**
+ * @brief	Checks if a data page is the current read page or is in the buffer pool.
+ * @param	state	embedDB algorithm state structure
+ * @param	pageNum	Physical page number
+ * @return	1 if the page can be read without accessing storage, else 0
+ */
+int8_t isDataPageBuffered(embedDBState *state, id_t pageNum) {
+    return pageNum == state->bufferedPageId || findPoolFrame(state, EMBEDDB_DATA_FILE, pageNum) >= 0;
+}
+
+/**
+ * @brief	Reads a run of data pages into the buffer pool with readPagesIntoPool. The run stops at the first page that is
+ * 			already buffered.
+ * @param	state		embedDB algorithm state structure
+ * @param	firstPageId	Logical page id of the first page to read
+ * @param	lastPageId	Logical page id of the last page to read. May be less than firstPageId to read backwards
+ */
+void readWindowRun(embedDBState *state, id_t firstPageId, id_t lastPageId) {
+    int8_t step = firstPageId <= lastPageId ? 1 : -1;
+    uint32_t maxPages = min((step > 0 ? lastPageId - firstPageId : firstPageId - lastPageId) + 1, state->numWindowPages);
+
+    id_t *pageIds = state->windowPageIds;
+    uint32_t numPages = 0;
+    while (numPages < maxPages) {
+        id_t pageId = step > 0 ? firstPageId + numPages : firstPageId - numPages;
+        if (isDataPageBuffered(state, pageId % state->numDataPages))
+            break;
+        pageIds[numPages++] = pageId;
+    }
+    readPagesIntoPool(state, pageIds, numPages);
+}
+
+/**
+ * @brief	Reads a list of data pages into the buffer pool. Uses one readPages request for each run of consecutive pages
+ * 			if the file interface has it, otherwise one batch of asynchronous reads. Frames are given to the pages in list
+ * 			order, so if the pool is short of unpinned frames the pages at the end of the list are not read. Pages that
+ * 			fail to read are left out of the pool and will be read again by readPage.
+ * @param	state		embedDB algorithm state structure
+ * @param	pageIds		Logical page ids of the pages to read. None of them may be buffered already
+ * @param	numPages	Number of pages in pageIds. At most numWindowPages
+ */
+void readPagesIntoPool(embedDBState *state, id_t *pageIds, uint32_t numPages) {
+    void **buffers = state->windowScratch;
+    uint32_t *frameNums = (uint32_t *)(buffers + state->numWindowPages);
+    uint32_t *order = frameNums + state->numWindowPages;
+    int8_t *results = (int8_t *)(order + state->numWindowPages);
+
+    /* Pin a frame for each page so the pages do not replace each other */
+    uint32_t numFrames = 0;
+    while (numFrames < numPages) {
+        int32_t frameNum = allocPoolFrame(state);
+        if (frameNum < 0)
+            break;
+        frameNums[numFrames++] = frameNum;
+        state->poolFrames[frameNum].pinCount++;
+    }
+
+    if (state->fileInterface->readPages != NULL) {
+        /* Order the pages by physical page id so each run of consecutive pages is one request */
+        for (uint32_t i = 0; i < numFrames; i++) {
+            uint32_t j = i;
+            while (j > 0 && pageIds[order[j - 1]] % state->numDataPages > pageIds[i] % state->numDataPages) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = i;
+        }
+
+        uint32_t runStart = 0;
+        while (runStart < numFrames) {
+            id_t physicalPageId = pageIds[order[runStart]] % state->numDataPages;
+            uint32_t runLength = 1;
+            while (runStart + runLength < numFrames && pageIds[order[runStart + runLength]] % state->numDataPages == physicalPageId + runLength)
+                runLength++;
+            for (uint32_t i = 0; i < runLength; i++)
+                buffers[i] = getPoolPage(state, frameNums[order[runStart + i]]);
+            uint32_t result = state->fileInterface->readPages(buffers, physicalPageId, runLength, state->pageSize, state->dataFile);
+            for (uint32_t i = 0; i < result && i < runLength; i++) {
+                state->poolFrames[frameNums[order[runStart + i]]].pageId = physicalPageId + i;
+                state->poolFrames[frameNums[order[runStart + i]]].file = EMBEDDB_DATA_FILE;
+            }
+            state->numReads += min(result, runLength);
+            runStart += runLength;
+        }
+    } else {
+        uint32_t numQueued = 0;
+        while (numQueued < numFrames) {
+            if (!state->fileInterface->readAsync(getPoolPage(state, frameNums[numQueued]), pageIds[numQueued] % state->numDataPages, state->pageSize, state->dataFile))
+                break;
+            numQueued++;
+        }
+
+        if (numQueued > 0) {
+            int32_t numCompleted = state->fileInterface->waitAsync(results, numQueued, state->dataFile);
+            for (int32_t i = 0; i < numCompleted && i < numQueued; i++) {
+                if (results[i]) {
+                    state->poolFrames[frameNums[i]].pageId = pageIds[i] % state->numDataPages;
+                    state->poolFrames[frameNums[i]].file = EMBEDDB_DATA_FILE;
+                    state->numReads++;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < numFrames; i++)
+        state->poolFrames[frameNums[i]].pinCount--;
+}
+
+/**
+ * @brief	Reads a data page that is part of a sequential scan. If the page is not buffered, the following pages of the
+ * 			scan are read into the read window along with it.
+ * @param	state		embedDB algorithm state structure
+ * @param	pageId		Logical page id to read
+ * @param	lastPageId	Logical page id of the last page of the scan
+ * @return	Return 0 if success, -1 if error.
+ */
+int8_t readDataPageForScan(embedDBState *state, id_t pageId, id_t lastPageId) {
+    if (state->numWindowPages > 1 && !isDataPageBuffered(state, pageId % state->numDataPages))
+        readWindowRun(state, pageId, min(pageId + state->numWindowPages - 1, lastPageId));
+    return readPage(state, pageId % state->numDataPages);
+}
+
+/**
+ * @brief	Reads the data page an iterator is at. Iterators only move forward, so on a miss the pages the iterator will
+ * 			read next are read ahead into the buffer pool in the same request. Pages ruled out by the query bitmap are not
+ * 			read. The read-ahead starts at one page and doubles on each miss up to the read window size, so a query that
+ * 			only needs a page or two does not read a full window.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @return	Return 0 if success, -1 if error.
+ */
+int8_t readIteratorPage(embedDBState *state, embedDBIterator *it) {
+    id_t physicalPageId = it->nextDataPage % state->numDataPages;
+    if (state->numWindowPages > 1 && !isDataPageBuffered(state, physicalPageId)) {
+        if (it->readAheadPages > 1) {
+            id_t *pageIds = state->windowPageIds;
+            uint32_t numPages = 0;
+            uint32_t maxPages = min(it->readAheadPages, state->numWindowPages);
+            for (id_t pageId = it->nextDataPage; numPages < maxPages && pageId < state->nextDataPageId; pageId++) {
+                if (pageId != it->nextDataPage && it->queryBitmap != NULL) {
+                    int8_t mayMatch = iteratorPageMayMatch(state, it, pageId);
+                    if (mayMatch < 0)
+                        break;
+                    if (mayMatch == 0)
+                        continue;
+                }
+                if (isDataPageBuffered(state, pageId % state->numDataPages))
+                    break;
+                pageIds[numPages++] = pageId;
+            }
+            readPagesIntoPool(state, pageIds, numPages);
+        }
+        it->readAheadPages = min(it->readAheadPages * 2, state->numWindowPages);
+    }
+    return readPage(state, physicalPageId);
+}
+
+/**
+ * @brief	Checks the bitmap index for whether a data page may have records in an iterator's data range. Only index pages
+ * 			already in memory are used.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	pageId	Logical id of the data page
+ * @return	1 if the page may have matching records or is not indexed, 0 if it does not, -1 if its index page is not in memory
+ */
+int8_t iteratorPageMayMatch(embedDBState *state, embedDBIterator *it, id_t pageId) {
+    id_t indexPage = pageId / state->maxIdxRecordsPerPage;
+    if (state->indexFile == NULL || indexPage < state->minIndexPageId || indexPage >= state->nextIdxPageId)
+        return 1;
 
-    /* Page is not in buffer. Read from storage. */
-    /* Read page into start of buffer 1 */
-    if (0 == state->fileInterface->read(buf, pageNum, state->pageSize, state->dataFile))
+    void *indexBuf;
+    if (state->indexCache != NULL)
+        indexBuf = (int8_t *)state->indexCache + (size_t)(indexPage % state->numIndexPages) * state->pageSize;
+    else if (it->indexPage != NULL && it->indexPageId == indexPage)
+        indexBuf = it->indexPage;
+    else if (state->bufferedIndexPageId == indexPage % state->numIndexPages)
+        indexBuf = state->indexReadPage;
+    else
         return -1;
 
-    state->numReads++;
-    state->bufferedPageId = pageNum;
-    return 0;
+    void *indexBM = (int8_t *)indexBuf + EMBEDDB_IDX_HEADER_SIZE + (pageId % state->maxIdxRecordsPerPage) * state->bitmapSize;
+    return bitmapOverlap(it->queryBitmap, indexBM, state->bitmapSize) ? 1 : 0;
 }
 
 /**
@@ -1857,6 +3670,9 @@ void readToWriteBuf(embedDBState *state) {
     void *writeBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_WRITE_BUFFER;
     // copy write buffer to the read buffer.
     memcpy(readBuf, writeBuf, state->pageSize);
+    // read buffer no longer holds a page from storage
+    setReadPage(state, &state->dataReadPage, readBuf);
+    state->bufferedPageId = -1;
 }
 
 /**
@@ -1870,6 +3686,9 @@ void readToWriteBufVar(embedDBState *state) {
     void *writeBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_WRITE_BUFFER(state->parameters);
     // copy write buffer to the read buffer.
     memcpy(readBuf, writeBuf, state->pageSize);
+    // read buffer no longer holds a page from storage
+    setReadPage(state, &state->varReadPage, readBuf);
+    state->bufferedVarPage = -1;
 }
 
 /**
@@ -1879,21 +3698,18 @@ void readToWriteBufVar(embedDBState *state) {
  * @return	Return 0 if success, -1 if error.
  */
 int8_t readIndexPage(embedDBState *state, id_t pageNum) {
-    /* Check if page is currently in buffer */
-    if (pageNum == state->bufferedIndexPageId) {
+    if (state->indexCache != NULL) {
+        setReadPage(state, &state->indexReadPage, (int8_t *)state->indexCache + (size_t)pageNum * state->pageSize);
+        state->bufferedIndexPageId = pageNum;
         state->bufferHits++;
         return 0;
     }
 
-    void *buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
-
-    /* Page is not in buffer. Read from storage. */
-    /* Read page into start of buffer */
-    if (0 == state->fileInterface->read(buf, pageNum, state->pageSize, state->indexFile))
+    int8_t result = readBufferedPage(state, EMBEDDB_INDEX_FILE, pageNum, EMBEDDB_INDEX_READ_BUFFER, &state->bufferedIndexPageId, &state->indexReadPage);
+    if (result < 0)
         return -1;
-
-    state->numIdxReads++;
-    state->bufferedIndexPageId = pageNum;
+    if (result == 1)
+        state->numIdxReads++;
     return 0;
 }
 
@@ -1904,24 +3720,174 @@ int8_t readIndexPage(embedDBState *state, id_t pageNum) {
  * @return 	Return 0 if success, -1 if error
  */
 int8_t readVariablePage(embedDBState *state, id_t pageNum) {
-    // Check if page is currently in buffer
-    if (pageNum == state->bufferedVarPage) {
-        state->bufferHits++;
-        return 0;
+    int8_t result = readBufferedPage(state, EMBEDDB_VAR_FILE, pageNum, EMBEDDB_VAR_READ_BUFFER(state->parameters), &state->bufferedVarPage, &state->varReadPage);
+    if (result < 0)
+        return -1;
+    // Track stats
+    if (result == 1)
+        state->numReads++;
+    return 0;
+}
+
+/**
+ * @brief	Reserves storage for a file if the file interface supports it.
+ * @param	state		embedDB algorithm state structure
+ * @param	file		File to reserve storage for
+ * @param	numPages	Number of pages the file holds
+ */
+void embedDBPreallocateFile(embedDBState *state, void *file, uint32_t numPages) {
+    if (state->fileInterface->preallocate == NULL)
+        return;
+    if (!state->fileInterface->preallocate(numPages, state->pageSize, file)) {
+#ifdef PRINT_ERRORS
+        printf("WARN: Unable to preallocate %u pages. The file will grow as it is written.\n", numPages);
+#endif
     }
+}
 
-    // Get buffer to read into
-    void *buf = (int8_t *)state->buffer + EMBEDDB_VAR_READ_BUFFER(state->parameters) * state->pageSize;
+/**
+ * @brief	Erases the erase block starting at a physical page if the file interface supports it.
+ * 			The pages are written again anyway, so a failed erase is not an error.
+ * @param	state			embedDB algorithm state structure
+ * @param	file			File the erase block is in
+ * @param	physicalPageId	First page of the erase block
+ */
+void embedDBEraseBlock(embedDBState *state, void *file, id_t physicalPageId) {
+    if (state->fileInterface->erase == NULL)
+        return;
+    if (!state->fileInterface->erase(physicalPageId, state->eraseSizeInPages, state->pageSize, file)) {
+#ifdef PRINT_ERRORS
+        printf("WARN: Failed to erase pages %u to %u.\n", physicalPageId, physicalPageId + state->eraseSizeInPages - 1);
+#endif
+    }
+}
 
-    // Read in one page worth of data
-    if (state->fileInterface->read(buf, pageNum, state->pageSize, state->varFile) == 0) {
-        return -1;
+/**
+ * @brief	Reads a page while recovering a file. If the file interface erases pages, a page of zeros was erased and
+ * 			counts as unreadable.
+ * @param	state			embedDB algorithm state structure
+ * @param	file			EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	physicalPageId	Page to read
+ * @param	readAhead		1 to read the data pages after it in the same request, as the pages are being read in order
+ * @return	Return 0 if the page holds data, -1 if it could not be read or was erased
+ */
+int8_t readRecoveryPage(embedDBState *state, uint8_t file, id_t physicalPageId, int8_t readAhead) {
+    int8_t result;
+    uint8_t *page;
+    if (file == EMBEDDB_DATA_FILE) {
+        result = readAhead ? readDataPageForScan(state, physicalPageId, state->numDataPages - 1) : readPage(state, physicalPageId);
+        page = (uint8_t *)state->dataReadPage;
+    } else if (file == EMBEDDB_INDEX_FILE) {
+        result = readIndexPage(state, physicalPageId);
+        page = (uint8_t *)state->indexReadPage;
+    } else {
+        result = readVariablePage(state, physicalPageId);
+        page = (uint8_t *)state->varReadPage;
     }
+    if (result != 0 || state->fileInterface->erase == NULL)
+        return result;
 
-    // Track stats
-    state->numReads++;
-    state->bufferedVarPage = pageNum;
-    return 0;
+    for (uint32_t i = 0; i < state->pageSize; i++) {
+        if (page[i] != 0)
+            return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief	Returns the logical page id of the page in a file's read buffer.
+ * @param	state	embedDB algorithm state structure
+ * @param	file	EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ */
+id_t recoveryPageId(embedDBState *state, uint8_t file) {
+    void *page = file == EMBEDDB_DATA_FILE ? state->dataReadPage : file == EMBEDDB_INDEX_FILE ? state->indexReadPage : state->varReadPage;
+    id_t logicalPageId = 0;
+    memcpy(&logicalPageId, page, sizeof(id_t));
+    return logicalPageId;
+}
+
+/**
+ * @brief	Checks whether a physical page holds the logical page it would if the newest run of pages reached it. Data
+ * 			pages that do are included in the maximum key error.
+ * @param	state			embedDB algorithm state structure
+ * @param	file			EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	physicalPageId	Page to read
+ * @param	logicalPageId	Logical page id the page holds if it is in the run
+ * @return	1 if the page is in the run, 0 if not
+ */
+int8_t recoveryPageInRun(embedDBState *state, uint8_t file, id_t physicalPageId, id_t logicalPageId) {
+    if (readRecoveryPage(state, file, physicalPageId, 0) != 0 || recoveryPageId(state, file) != logicalPageId)
+        return 0;
+    if (file == EMBEDDB_DATA_FILE)
+        updateMaxiumError(state, state->dataReadPage);
+    return 1;
+}
+
+/**
+ * @brief	Finds the end of the run of pages that starts at a physical page and ends with the newest page of a file.
+ * 			Logical page ids go up by one from page to page in the run, and pages after it are unwritten, erased or
+ * 			older, so the end is found with a binary search in O(log numPages) reads. If the pages around the end it
+ * 			finds do not look like that, for example because a page is corrupt, the pages are read in order instead.
+ * @param	state				embedDB algorithm state structure
+ * @param	file				EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	firstPhysicalPageId	First page of the run. Must be in the file's read buffer
+ * @param	numPages			Number of pages in the file
+ * @param	endHasData			Return value. 1 if the page after the run holds data, in which case it is left in the
+ * 								file's read buffer
+ * @return	Physical page after the last page of the run
+ */
+id_t findEndOfRun(embedDBState *state, uint8_t file, id_t firstPhysicalPageId, id_t numPages, int8_t *endHasData) {
+    id_t firstLogicalPageId = recoveryPageId(state, file);
+    id_t low = firstPhysicalPageId, high = numPages;
+    while (high - low > 1) {
+        id_t middle = low + (high - low) / 2;
+        if (recoveryPageInRun(state, file, middle, firstLogicalPageId + (middle - firstPhysicalPageId)))
+            low = middle;
+        else
+            high = middle;
+    }
+
+    /* The last page of the file must not continue the run, and the page after the run must be unwritten or older */
+    int8_t consistent = high + 1 >= numPages ||
+                        !recoveryPageInRun(state, file, numPages - 1, firstLogicalPageId + (numPages - 1 - firstPhysicalPageId));
+    *endHasData = high < numPages && readRecoveryPage(state, file, high, 0) == 0;
+    if (*endHasData) {
+        id_t logicalPageId = recoveryPageId(state, file);
+        consistent = consistent && (logicalPageId == 0 || logicalPageId == firstLogicalPageId + (high - firstPhysicalPageId) - numPages);
+    }
+    if (consistent)
+        return high;
+
+#ifdef PRINT_ERRORS
+    printf("WARN: Pages of file %d are not in order. Reading each page to recover it.\n", file);
+#endif
+    for (high = firstPhysicalPageId + 1; high < numPages; high++) {
+        *endHasData = readRecoveryPage(state, file, high, 1) == 0;
+        if (!*endHasData || recoveryPageId(state, file) != firstLogicalPageId + (high - firstPhysicalPageId))
+            return high;
+        if (file == EMBEDDB_DATA_FILE)
+            updateMaxiumError(state, state->dataReadPage);
+    }
+    *endHasData = 0;
+    return high;
+}
+
+/**
+ * @brief	Finds the first erase block at or after a physical page that was not erased. Only erase blocks can be erased,
+ * 			so this is where the data continues after erased pages. The page is left in the file's read buffer.
+ * @param	state			embedDB algorithm state structure
+ * @param	file			EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE
+ * @param	physicalPageId	Page to start looking from. Rounded up to the start of an erase block
+ * @param	numPages		Number of pages in the file
+ * @return	First page of the erase block, or numPages if every later block was erased or the file does not erase pages
+ */
+id_t findNextWrittenBlock(embedDBState *state, uint8_t file, id_t physicalPageId, id_t numPages) {
+    if (state->fileInterface->erase == NULL)
+        return numPages;
+    id_t blockPageId = (physicalPageId + state->eraseSizeInPages - 1) / state->eraseSizeInPages * state->eraseSizeInPages;
+    while (blockPageId < numPages && readRecoveryPage(state, file, blockPageId, 1) != 0)
+        blockPageId += state->eraseSizeInPages;
+    return blockPageId < numPages ? blockPageId : numPages;
 }
 
 /**
@@ -1932,8 +3898,10 @@ void embedDBResetStats(embedDBState *state) {
     state->numReads = 0;
     state->numWrites = 0;
     state->bufferHits = 0;
+    state->bufferMisses = 0;
     state->numIdxReads = 0;
     state->numIdxWrites = 0;
+    state->numSyncs = 0;
 }
 
 /**
@@ -1941,6 +3909,15 @@ void embedDBResetStats(embedDBState *state) {
  * @param	state	embedDB state structure
  */
 void embedDBClose(embedDBState *state) {
+    if (state->splineFile != NULL) {
+        embedDBCheckpointSpline(state);
+        state->fileInterface->close(state->splineFile);
+        state->splineFile = NULL;
+    }
+    if (state->splineCheckpointPage != NULL) {
+        embedDBAlignedFree(state->splineCheckpointPage);
+        state->splineCheckpointPage = NULL;
+    }
     if (state->dataFile != NULL) {
         state->fileInterface->close(state->dataFile);
     }
@@ -1950,17 +3927,48 @@ void embedDBClose(embedDBState *state) {
     if (state->varFile != NULL) {
         state->fileInterface->close(state->varFile);
     }
-    if (SEARCH_METHOD == 2) {  // Spline
-        if (RADIX_BITS > 0) {
-            radixsplineClose(state->rdix);
-            free(state->rdix);
-            state->rdix = NULL;
-            // Spl already freed by radixsplineClose
-            state->spl = NULL;
-        } else {
-            splineClose(state->spl);
-            free(state->spl);
-            state->spl = NULL;
-        }
+    if (state->indexCache != NULL) {
+        free(state->indexCache);
+        state->indexCache = NULL;
+    }
+    if (state->varBlockMaxKeys != NULL) {
+        free(state->varBlockMaxKeys);
+        state->varBlockMaxKeys = NULL;
     }
+    embedDBFreeBufferPool(state);
+    if (state->searchStrategy != NULL && state->searchStrategy->close != NULL)
+        state->searchStrategy->close(state);
+}
+
+/**
+ * @brief	Allocates memory starting at a multiple of alignment.
+ * @param	alignment	Required alignment in bytes. Must be a power of two
+ * @param	size		Number of bytes to allocate
+ * @return	Pointer to the memory, or NULL if it could not be allocated. Must be freed with embedDBAlignedFree
+ */
+void *embedDBAlignedAlloc(size_t alignment, size_t size) {
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+
+    /* Allocate extra space to move the start forward to the alignment and to remember where the allocation began */
+    int8_t *allocation = malloc(size + alignment - 1 + sizeof(void *));
+    if (allocation == NULL)
+        return NULL;
+
+    uintptr_t start = (uintptr_t)(allocation + sizeof(void *));
+    void *buffer = (void *)((start + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    memcpy((int8_t *)buffer - sizeof(void *), &allocation, sizeof(void *));
+    return buffer;
+}
+
+/**
+ * @brief	Frees memory allocated by embedDBAlignedAlloc.
+ * @param	buffer	Memory to free. May be NULL
+ */
+void embedDBAlignedFree(void *buffer) {
+    if (buffer == NULL)
+        return;
+    void *allocation;
+    memcpy(&allocation, (int8_t *)buffer - sizeof(void *), sizeof(void *));
+    free(allocation);
 }
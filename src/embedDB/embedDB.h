@@ -59,6 +59,8 @@ typedef uint16_t count_t;
 #define EMBEDDB_USE_BMAP 8
 #define EMBEDDB_USE_VDATA 16
 #define EMBEDDB_RESET_DATA 32
+#define EMBEDDB_REWRITE_PARTIAL_PAGES 64
+#define EMBEDDB_CACHE_INDEX 128
 
 #define EMBEDDB_USING_INDEX(x) ((x & EMBEDDB_USE_INDEX) > 0 ? 1 : 0)
 #define EMBEDDB_USING_MAX_MIN(x) ((x & EMBEDDB_USE_MAX_MIN) > 0 ? 1 : 0)
@@ -66,6 +68,25 @@ typedef uint16_t count_t;
 #define EMBEDDB_USING_BMAP(x) ((x & EMBEDDB_USE_BMAP) > 0 ? 1 : 0)
 #define EMBEDDB_USING_VDATA(x) ((x & EMBEDDB_USE_VDATA) > 0 ? 1 : 0)
 #define EMBEDDB_RESETING_DATA(x) ((x & EMBEDDB_RESET_DATA) > 0 ? 1 : 0)
+#define EMBEDDB_REWRITING_PARTIAL_PAGES(x) ((x & EMBEDDB_REWRITE_PARTIAL_PAGES) > 0 ? 1 : 0)
+#define EMBEDDB_CACHING_INDEX(x) ((x & EMBEDDB_CACHE_INDEX) > 0 ? 1 : 0)
+
+/* Search methods for finding the data page holding a key. See embedDBSetSearchMethod */
+#define EMBEDDB_SEARCH_MODIFIED_BINARY 0
+#define EMBEDDB_SEARCH_BINARY 1
+#define EMBEDDB_SEARCH_SPLINE 2
+
+/* How keys are compared. See embedDBSetKeyType */
+#define EMBEDDB_KEY_CUSTOM 0
+#define EMBEDDB_KEY_UINT32 1
+#define EMBEDDB_KEY_UINT64 2
+
+/* How the first data column is compared by min/max tracking and data filters. See embedDBSetDataType */
+#define EMBEDDB_DATA_CUSTOM 0
+#define EMBEDDB_DATA_INT32 1
+#define EMBEDDB_DATA_UINT32 2
+#define EMBEDDB_DATA_INT64 3
+#define EMBEDDB_DATA_UINT64 4
 
 /* Offsets with header */
 #define EMBEDDB_COUNT_OFFSET 4
@@ -97,6 +118,11 @@ typedef uint16_t count_t;
 #define EMBEDDB_VAR_WRITE_BUFFER(x) ((x & EMBEDDB_USE_INDEX) ? 4 : 2)
 #define EMBEDDB_VAR_READ_BUFFER(x) ((x & EMBEDDB_USE_INDEX) ? 5 : 3)
 
+/* Flags for the files of an embedDB state */
+#define EMBEDDB_DATA_FILE 1
+#define EMBEDDB_INDEX_FILE 2
+#define EMBEDDB_VAR_FILE 4
+
 #define EMBEDDB_FILE_MODE_W_PLUS_B 0  // Open file as read/write, creates file if doesn't exist, overwrites if it does. aka "w+b"
 #define EMBEDDB_FILE_MODE_R_PLUS_B 1  // Open file as read/write, file must exist, keeps data if it does. aka "r+b"
 
@@ -175,8 +201,105 @@ typedef struct {
      * @return	1 for success and 0 for failure
      */
     int8_t (*flush)(void *file);
+
+    /**
+     * @brief	Optional. Returns a read-only pointer to a page without copying it. Set to NULL if the storage cannot map pages.
+     * 			The pointer must stay valid until the file is closed and must reflect later writes to the page.
+     * @param	pageNum		Page number to map. Is treated as an offset from the beginning of the file
+     * @param	pageSize	Number of bytes in a page
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	Pointer to the page, or NULL if the page cannot be mapped (embedDB then falls back to read)
+     */
+    void *(*mapPage)(uint32_t pageNum, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Queues a read of a single page. The buffer must not be used until waitAsync returns.
+     * @param	buffer		Pre-allocated space where data is read into
+     * @param	pageNum		Page number to read. Is treated as an offset from the beginning of the file
+     * @param	pageSize	Number of bytes in a page
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	1 if the read was queued and 0 if it could not be (e.g. the queue is full)
+     */
+    int8_t (*readAsync)(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Queues a write of a single page. The buffer must not be changed until waitAsync returns.
+     * @return	1 if the write was queued and 0 if it could not be (e.g. the queue is full)
+     */
+    int8_t (*writeAsync)(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Starts all reads and writes queued on the file and waits for them to finish.
+     * @param	results		Set to 1 or 0 for the success of each queued request, in the order they were queued
+     * @param	maxResults	Size of results
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	Number of requests that were waited for, or -1 if the requests could not be completed
+     */
+    int32_t (*waitAsync)(int8_t *results, uint32_t maxResults, void *file);
+
+    /**
+     * @brief	Optional. Returns the block size of an open file that bypasses the operating system cache (e.g. O_DIRECT).
+     * 			Page sizes, file offsets and buffer addresses must all be multiples of it. embedDBInit checks this.
+     * @param	file	The file data that was stored in embedDBState->dataFile etc
+     * @return	Block size in bytes, or 0 if the file has no alignment requirement
+     */
+    uint32_t (*blockSize)(void *file);
+
+    /**
+     * @brief	Optional. Reads consecutive pages with one request to storage.
+     * @param	buffers		Pre-allocated space for each page. buffers[i] receives page pageNum + i
+     * @param	pageNum		First page number to read. Is treated as an offset from the beginning of the file
+     * @param	numPages	Number of pages to read
+     * @param	pageSize	Number of bytes in a page
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	Number of pages read, counting from pageNum. Less than numPages if the end of the file or an error was reached
+     */
+    uint32_t (*readPages)(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Writes consecutive pages with one request to storage.
+     * @param	buffers		Data for each page. buffers[i] is written to page pageNum + i
+     * @return	Number of pages written, counting from pageNum. Less than numPages if there was an error
+     */
+    uint32_t (*writePages)(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Makes every page written to the file durable (e.g. fdatasync). If NULL, embedDB calls flush instead.
+     * @param	file	The file data that was stored in embedDBState->dataFile etc
+     * @return	1 for success and 0 for failure
+     */
+    int8_t (*sync)(void *file);
+
+    /**
+     * @brief	Optional. Reserves storage for the first numPages pages of the file without changing the file's size (e.g.
+     * 			fallocate), so writes do not have to allocate space. embedDBInit calls it after opening each file.
+     * @param	numPages	Number of pages the file holds (e.g. embedDBState->numDataPages)
+     * @param	pageSize	Size of page in bytes
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	1 for success and 0 for failure. A failure is not an error, the file then grows as it is written
+     */
+    int8_t (*preallocate)(uint32_t numPages, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Erases an erase block whose data embedDB no longer needs, before its first page is written again
+     * 			(e.g. punching a hole so the storage can reclaim it). Erased pages must read as zeros or fail to read.
+     * 			If set, numDataPages and numVarPages must be multiples of eraseSizeInPages.
+     * @param	pageNum		First page of the erase block
+     * @param	numPages	Number of pages to erase (embedDBState->eraseSizeInPages)
+     * @param	pageSize	Size of page in bytes
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	1 for success and 0 for failure
+     */
+    int8_t (*erase)(uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
 } embedDBFileInterface;
 
+typedef struct {
+    id_t pageId;        /* Physical page id held in the frame, or -1 if the frame is empty */
+    uint8_t file;       /* File the page is from (EMBEDDB_DATA_FILE etc) */
+    uint8_t referenced; /* Set when the page is used. Cleared as the clock hand passes, so unused pages are replaced first */
+    uint8_t pinCount;   /* Number of current users of the page. Pinned frames are never replaced */
+} embedDBBufferFrame;
+
 typedef struct {
     void *dataFile;                                                       /* File for storing data records. */
     void *indexFile;                                                      /* File for storing index records. */
@@ -192,6 +315,8 @@ typedef struct {
     uint32_t minDataPageId;                                               /* Lowest logical data page id that is saved on file */
     uint32_t minIndexPageId;                                              /* Lowest logical index page id that is saved on file */
     uint64_t minVarRecordId;                                              /* Minimum record id that we still have variable data for */
+    void *varBlockMaxKeys;                                                /* Largest key on each variable data erase block, so erasing a block does not read it */
+    id_t varBlockKeysFromPageId;                                          /* First variable data page written since init. Only blocks written since then have their key */
     id_t nextDataPageId;                                                  /* Next logical page id. Page id is an incrementing value and may not always be same as physical page id. */
     id_t nextIdxPageId;                                                   /* Next logical page id for index. Page id is an incrementing value and may not always be same as physical page id. */
     id_t nextVarPageId;                                                   /* Page number of next var page to be written */
@@ -200,12 +325,16 @@ typedef struct {
     spline *spl;                                                          /* Spline model */
     uint32_t numSplinePoints;                                             /* Number of spline points to allocate */
     radixspline *rdix;                                                    /* Radix Spline search model */
+    uint8_t radixBits;                                                    /* Number of bits indexed by the radix table over the spline. 0 if there is no radix table */
+    struct embedDBSearchStrategy *searchStrategy;                         /* Method used to find the data page holding a key. Set with embedDBSetSearchMethod */
     int32_t indexMaxError;                                                /* Max error for indexing structure (Spline or PGM) */
     int8_t bufferSizeInBlocks;                                            /* Size of buffer in blocks */
     count_t pageSize;                                                     /* Size of physical page on device */
-    int8_t parameters;                                                    /* Parameter flags for indexing and bitmaps */
+    uint8_t parameters;                                                   /* Parameter flags for indexing and bitmaps */
     int8_t keySize;                                                       /* Size of key in bytes (fixed-size records) */
+    int8_t keyType;                                                       /* EMBEDDB_KEY_UINT32 or EMBEDDB_KEY_UINT64 to compare keys directly, EMBEDDB_KEY_CUSTOM to use compareKey. Set by embedDBInit from keySize */
     int8_t dataSize;                                                      /* Size of data in bytes (fixed-size records). Do not include space for variable size records if you are using them. */
+    int8_t dataType;                                                      /* Type of the first data column so it is compared directly, or EMBEDDB_DATA_CUSTOM to use compareData. Set with embedDBSetDataType */
     int8_t recordSize;                                                    /* Size of record in bytes (fixed-size records) */
     int8_t headerSize;                                                    /* Size of header in bytes (calculated during init()) */
     int8_t variableDataHeaderSize;                                        /* Size of page header in variable data files (calculated during init()) */
@@ -221,17 +350,45 @@ typedef struct {
     void (*updateBitmap)(void *data, void *bm);                           /* Given a record, updates bitmap based on its data (key) value */
     int8_t (*inBitmap)(void *data, void *bm);                             /* Returns 1 if data (key) value is a valid value given the bitmap */
     uint64_t minKey;                                                      /* Minimum key */
-    uint64_t maxKey;                                                      /* Maximum key */
+    uint64_t maxKey;                                                      /* Largest key inserted. Only valid once minKey is set */
     int32_t maxError;                                                     /* Maximum key error */
     id_t numWrites;                                                       /* Number of page writes */
     id_t numReads;                                                        /* Number of page reads */
     id_t numIdxWrites;                                                    /* Number of index page writes */
     id_t numIdxReads;                                                     /* Number of index page reads */
     id_t bufferHits;                                                      /* Number of pages returned from buffer rather than storage */
+    id_t bufferMisses;                                                    /* Number of pages that had to be read from storage */
+    id_t numSyncs;                                                        /* Number of group commits that synced files */
     id_t bufferedPageId;                                                  /* Page id currently in read buffer */
     id_t bufferedIndexPageId;                                             /* Index page id currently in index read buffer */
     id_t bufferedVarPage;                                                 /* Variable page id currently in variable read buffer */
+    void *dataReadPage;                                                   /* Data page currently buffered for reading. Either the data read buffer or a page mapped by the file interface */
+    void *indexReadPage;                                                  /* Index page currently buffered for reading. Either the index read buffer or a mapped page */
+    void *varReadPage;                                                    /* Variable data page currently buffered for reading. Either the variable read buffer or a mapped page */
+    void *poolPages;                                                      /* Buffer pool of recently read pages of every file. The buffer pages after the ones embedDB requires, or poolAllocation */
+    void *poolAllocation;                                                 /* Pool pages allocated by embedDBSetBufferPoolSize. NULL if the pool uses the embedDB buffer */
+    embedDBBufferFrame *poolFrames;                                       /* Page held in each page of the buffer pool */
+    id_t *windowPageIds;                                                  /* Pages of the data run being read into the pool. numWindowPages long */
+    void *windowScratch;                                                  /* Buffers, frames, order and results of each page of a run read into the pool */
+    uint32_t numPoolFrames;                                               /* Number of pages in the buffer pool. 0 if it is not used */
+    uint32_t poolClockHand;                                               /* Next frame the CLOCK replacement considers */
+    uint32_t numWindowPages;                                              /* Most data pages read into the pool together by a scan. 0 if the file interface cannot read several pages at once */
+    void *indexCache;                                                     /* Copy of every index page by physical page number, kept with EMBEDDB_CACHE_INDEX or embedDBCacheIndex. NULL if not used */
     uint8_t recordHasVarData;                                             /* Internal flag to signal that the record currently being written has var data */
+    uint32_t syncEveryPages;                                              /* Durability policy. Commit after this many page writes. 0 to disable */
+    uint32_t syncIntervalMs;                                              /* Durability policy. Commit when a page is written this long after the last commit. 0 to disable */
+    uint32_t (*currentTimeMs)(void);                                      /* Millisecond clock used by syncIntervalMs */
+    uint32_t lastSyncTime;                                                /* currentTimeMs at the last commit */
+    uint32_t numUnsyncedPages;                                            /* Pages written since the last commit */
+    uint8_t unsyncedFiles;                                                /* Flags (EMBEDDB_DATA_FILE etc) of the files written since the last commit */
+    uint8_t partialPagesWritten;                                          /* Flags of the files whose page in the write buffer has already been written to storage by a flush */
+    id_t splineRecoveredPageId;                                           /* Data pages recovered from storage before this id are added to the spline when it is first used. 0 once they are */
+    void *splineFile;                                                     /* File the spline is checkpointed to so restarts do not rebuild it. Set with embedDBSetSplineCheckpoint. NULL if not used */
+    void *splineCheckpointPage;                                           /* Page buffer for reading and writing spline checkpoints */
+    uint32_t splineCheckpointEveryPages;                                  /* Checkpoint the spline after this many data pages are written. 0 to only checkpoint at close */
+    uint32_t splineCheckpointSequence;                                    /* Number of the next checkpoint. Checkpoints alternate between two slots of the file */
+    id_t splineCheckpointSlotPages;                                       /* Number of pages in each checkpoint slot */
+    id_t splineCheckpointPageId;                                          /* nextDataPageId when the spline was last checkpointed */
 } embedDBState;
 
 typedef struct {
@@ -242,6 +399,11 @@ typedef struct {
     void *minData;
     void *maxData;
     void *queryBitmap;
+    void *dataPage;          /* Optional copy of the data page the iterator is reading, so other queries do not replace it. NULL to use the state's read page */
+    void *indexPage;         /* Optional copy of the index page the iterator last checked */
+    id_t dataPageId;         /* Logical id of the page in dataPage, or -1 if it holds no stored page */
+    id_t indexPageId;        /* Logical id of the page in indexPage, or -1 if it holds none */
+    uint32_t readAheadPages; /* Number of pages read together on the iterator's next miss. Doubles on each miss up to the read window size */
 } embedDBIterator;
 
 typedef struct {
@@ -291,6 +453,30 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data);
  */
 int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableData, uint32_t length);
 
+/**
+ * @brief	Puts an array of records into the structure. Faster than calling embedDBPut for each record. Nothing is
+ * 			inserted if the keys are not in strictly ascending order after the last key inserted.
+ * @param	state		embedDB algorithm state structure
+ * @param	keys		Array of numRecords keys in strictly ascending order
+ * @param	data		Array of numRecords data values
+ * @param	numRecords	Number of records
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutBatch(embedDBState *state, void *keys, void *data, uint32_t numRecords);
+
+/**
+ * @brief	Puts an array of records with variable length data into the structure. Nothing is inserted if the keys are not
+ * 			in strictly ascending order after the last key inserted.
+ * @param	state			embedDB algorithm state structure
+ * @param	keys			Array of numRecords keys in strictly ascending order
+ * @param	data			Array of numRecords data values
+ * @param	variableData	Variable length data for each record. An entry may be NULL if the record has none
+ * @param	lengths			Length of the variable length data of each record in bytes
+ * @param	numRecords		Number of records
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutBatchVar(embedDBState *state, void *keys, void *data, void **variableData, uint32_t *lengths, uint32_t numRecords);
+
 /**
  * @brief	Given a key, returns data associated with key.
  * 			Note: Space for data must be already allocated.
@@ -322,6 +508,16 @@ int8_t embedDBGetVar(embedDBState *state, void *key, void *data, embedDBVarDataS
  */
 void embedDBInitIterator(embedDBState *state, embedDBIterator *it);
 
+/**
+ * @brief	Gives an iterator its own data and index page buffers. The iterator keeps its current pages in them, so other
+ * 			iterators and queries on the same state can run between calls to embedDBNext without the iterator reading its
+ * 			pages again. Call after embedDBInitIterator. The buffers are freed by embedDBCloseIterator.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @return	Return 0 if success, -1 if memory could not be allocated.
+ */
+int8_t embedDBIteratorAllocBuffers(embedDBState *state, embedDBIterator *it);
+
 /**
  * @brief	Close iterator after use.
  * @param	it		embedDB iterator structure
@@ -362,9 +558,107 @@ uint32_t embedDBVarDataStreamRead(embedDBState *state, embedDBVarDataStream *str
 /**
  * @brief	Flushes output buffer.
  * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a page could not be written or a file could not be flushed.
  */
 int8_t embedDBFlush(embedDBState *state);
 
+/**
+ * @brief	Sets when pages written to storage are made durable. Pages are synced in group commits: every file with
+ * 			writes since the last commit is synced once, data file first. Records still in the write buffer are not part
+ * 			of a commit until a page is written or embedDBFlush is called. The default is to only commit when
+ * 			embedDBCommit is called. Must be called after embedDBInit.
+ * @param	state			embedDB algorithm state structure
+ * @param	syncEveryPages	Commit after this many pages have been written. 0 to disable
+ * @param	syncIntervalMs	Commit when a page is written at least this many milliseconds after the last commit. 0 to disable
+ * @param	currentTimeMs	Returns the current time in milliseconds. Required if syncIntervalMs is not 0
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBSetDurability(embedDBState *state, uint32_t syncEveryPages, uint32_t syncIntervalMs, uint32_t (*currentTimeMs)(void));
+
+/**
+ * @brief	Group commit. Makes every page written since the last commit durable by syncing each file that was written
+ * 			once. Does not write the pages in the write buffers, call embedDBFlush first to include them.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a file could not be synced.
+ */
+int8_t embedDBCommit(embedDBState *state);
+
+/**
+ * @brief	Sets the number of pages in the buffer pool of recently read pages, in place of the embedDB buffer's spare
+ * 			pages. The pool pages are allocated and freed by embedDBClose. The pages buffered before the call are
+ * 			dropped. Has no effect if the file interface maps pages. Must be called after embedDBInit while no iterator
+ * 			is open.
+ * @param	state			embedDB algorithm state structure
+ * @param	numPoolPages	Number of pages in the pool. 0 to go back to the embedDB buffer's spare pages
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBSetBufferPoolSize(embedDBState *state, uint32_t numPoolPages);
+
+/**
+ * @brief	Keeps every index page in memory so that iterators check the bitmap index without reading from storage. The
+ * 			live index pages are loaded now and each index page written afterwards is copied in. Uses numIndexPages * pageSize
+ * 			bytes, which is freed by embedDBClose. Must be called after embedDBInit. Setting EMBEDDB_CACHE_INDEX in the
+ * 			parameters does the same in embedDBInit, loading the pages as the index is recovered.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBCacheIndex(embedDBState *state);
+
+/**
+ * @brief	Changes how embedDBGet finds the data page holding a key and how iterators find their first page. embedDBInit
+ * 			uses a spline. The new search structure is built from the data pages on storage when it is first used, which
+ * 			reads each of them for the spline. Must be called after embedDBInit.
+ * @param	state			embedDB algorithm state structure
+ * @param	searchMethod	EMBEDDB_SEARCH_MODIFIED_BINARY, EMBEDDB_SEARCH_BINARY or EMBEDDB_SEARCH_SPLINE
+ * @param	radixBits		Number of bits of the key indexed by a radix table over the spline. 0 for a spline without a
+ * 							radix table. Ignored by the binary searches
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBSetSearchMethod(embedDBState *state, int8_t searchMethod, uint8_t radixBits);
+
+/**
+ * @brief	Saves the spline to splineFile so that reopening the database restores it instead of reading every data page
+ * 			to rebuild it. If the data was recovered from storage, the newest checkpoint in the file that matches the
+ * 			recovered pages is restored now and only the pages written after it are read. Otherwise the spline is rebuilt
+ * 			from every data page. A checkpoint is written every checkpointEveryPages data pages and by embedDBClose,
+ * 			which also closes the file. Checkpoints alternate between two slots of the file, so one torn by a power
+ * 			failure falls back to the previous one. Requires the spline search method. Must be called after embedDBInit
+ * 			and embedDBSetSearchMethod, and before any other call.
+ * @param	state					embedDB algorithm state structure
+ * @param	splineFile				File for the checkpoints, set up like the data file
+ * @param	checkpointEveryPages	Checkpoint after this many data pages are written. 0 to only checkpoint at close
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBSetSplineCheckpoint(embedDBState *state, void *splineFile, uint32_t checkpointEveryPages);
+
+/**
+ * @brief	Writes a checkpoint of the spline to the file given to embedDBSetSplineCheckpoint and syncs it.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBCheckpointSpline(embedDBState *state);
+
+/**
+ * @brief	Sets how keys are compared when inserting, searching a page and iterating. embedDBInit uses EMBEDDB_KEY_UINT32
+ * 			for 4 byte keys and EMBEDDB_KEY_UINT64 for 8 byte keys, which compare keys as unsigned numbers without calling
+ * 			compareKey. Use EMBEDDB_KEY_CUSTOM if compareKey orders keys differently. Must be called after embedDBInit.
+ * @param	state	embedDB algorithm state structure
+ * @param	keyType	EMBEDDB_KEY_CUSTOM, EMBEDDB_KEY_UINT32 or EMBEDDB_KEY_UINT64
+ * @return	Return 0 if success. Non-zero value if the key type does not match the key size.
+ */
+int8_t embedDBSetKeyType(embedDBState *state, int8_t keyType);
+
+/**
+ * @brief	Sets how the first data column is compared when tracking the min and max data of a page and when filtering
+ * 			records by data in an iterator. embedDBInit uses EMBEDDB_DATA_CUSTOM, which calls compareData. The other types
+ * 			compare the first bytes of the data as a number of that type without calling compareData, so they must order
+ * 			data the same way compareData does. Must be called after embedDBInit.
+ * @param	state		embedDB algorithm state structure
+ * @param	dataType	EMBEDDB_DATA_CUSTOM, EMBEDDB_DATA_INT32, EMBEDDB_DATA_UINT32, EMBEDDB_DATA_INT64 or EMBEDDB_DATA_UINT64
+ * @return	Return 0 if success. Non-zero value if the data is smaller than the type.
+ */
+int8_t embedDBSetDataType(embedDBState *state, int8_t dataType);
+
 /**
  * @brief	Reads given page from storage.
  * @param	state	embedDB algorithm state structure
@@ -431,6 +725,21 @@ void embedDBResetStats(embedDBState *state);
  */
 void embedDBClose(embedDBState *state);
 
+/**
+ * @brief	Allocates memory starting at a multiple of alignment. Use for embedDBState->buffer when the file interface
+ * 			requires aligned buffers (see blockSize in embedDBFileInterface).
+ * @param	alignment	Required alignment in bytes. Must be a power of two
+ * @param	size		Number of bytes to allocate
+ * @return	Pointer to the memory, or NULL if it could not be allocated. Must be freed with embedDBAlignedFree
+ */
+void *embedDBAlignedAlloc(size_t alignment, size_t size);
+
+/**
+ * @brief	Frees memory allocated by embedDBAlignedAlloc.
+ * @param	buffer	Memory to free. May be NULL
+ */
+void embedDBAlignedFree(void *buffer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,475 @@
+/******************************************************************************/
+/**
+ * @file        posixFileInterface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB built on POSIX file descriptors.
+ *              Pages are accessed with positional I/O (pread/pwrite) so there is
+ *              no stdio buffering and no shared file position.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "posixFileInterface.h"
+
+#ifdef EMBEDDB_POSIX_FILE_INTERFACE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+typedef struct {
+    char *filename;
+    int fd;
+    uint8_t role;
+    size_t mapReserved; /* Bytes of address space reserved for the mapping. 0 if the file is not memory-mapped */
+    void *map;          /* Start of the reserved address space, NULL while the file is closed */
+    size_t mapLength;   /* Bytes at the start of the reservation that currently map the file */
+    size_t fileSize;    /* Size of the file in bytes as known from open and from writes */
+    uint8_t direct;     /* 1 if the file should be opened to bypass the page cache */
+    uint32_t blockSize; /* Alignment direct I/O needs on the open file. 0 if the page cache is used */
+} POSIX_FILE_INFO;
+
+void *setupPosixFile(char *filename, uint8_t role) {
+    return setupMmapFile(filename, role, 0);
+}
+
+void *setupMmapFile(char *filename, uint8_t role, size_t maxFileSize) {
+    POSIX_FILE_INFO *fileInfo = malloc(sizeof(POSIX_FILE_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    int nameLen = strlen(filename);
+    fileInfo->filename = calloc(1, nameLen + 1);
+    memcpy(fileInfo->filename, filename, nameLen);
+    fileInfo->fd = -1;
+    fileInfo->role = role;
+    fileInfo->mapReserved = maxFileSize;
+    fileInfo->map = NULL;
+    fileInfo->mapLength = 0;
+    fileInfo->fileSize = 0;
+    fileInfo->direct = 0;
+    fileInfo->blockSize = 0;
+    return fileInfo;
+}
+
+void *setupDirectFile(char *filename, uint8_t role) {
+    POSIX_FILE_INFO *fileInfo = setupMmapFile(filename, role, 0);
+    if (fileInfo != NULL)
+        fileInfo->direct = 1;
+    return fileInfo;
+}
+
+static void posixUnmap(POSIX_FILE_INFO *fileInfo) {
+    if (fileInfo->map != NULL)
+        munmap(fileInfo->map, fileInfo->mapReserved);
+    fileInfo->map = NULL;
+    fileInfo->mapLength = 0;
+}
+
+void tearDownPosixFile(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    free(fileInfo->filename);
+    posixUnmap(fileInfo);
+    if (fileInfo->fd != -1)
+        close(fileInfo->fd);
+    free(file);
+}
+
+/**
+ * @brief	Reads or writes exactly one page at the given offset, retrying on short transfers and interrupts.
+ * @return	1 if the whole page was transferred, 0 otherwise (including end of file on read)
+ */
+static int8_t posixTransferPage(int fd, void *buffer, uint32_t pageSize, off_t offset, int8_t isWrite) {
+    uint32_t done = 0;
+    while (done < pageSize) {
+        ssize_t result;
+        if (isWrite)
+            result = pwrite(fd, (int8_t *)buffer + done, pageSize - done, offset + done);
+        else
+            result = pread(fd, (int8_t *)buffer + done, pageSize - done, offset + done);
+
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        if (result == 0)
+            return 0;
+        done += result;
+    }
+    return 1;
+}
+
+/* Maximum number of pages given to one preadv/pwritev call */
+#define POSIX_MAX_IOVECS 64
+
+/**
+ * @brief	Reads or writes consecutive pages with vectored positional I/O, retrying on short transfers and interrupts.
+ * @return	Number of whole pages transferred
+ */
+static uint32_t posixTransferPages(int fd, void **buffers, uint32_t numPages, uint32_t pageSize, off_t offset, int8_t isWrite) {
+    uint64_t totalBytes = (uint64_t)numPages * pageSize;
+    uint64_t done = 0;
+    while (done < totalBytes) {
+        /* Describe the remaining part of the run, starting part way through a page after a short transfer */
+        struct iovec iov[POSIX_MAX_IOVECS];
+        uint32_t firstPage = done / pageSize;
+        uint32_t pageOffset = done % pageSize;
+        int numIov = 0;
+        for (uint32_t i = firstPage; i < numPages && numIov < POSIX_MAX_IOVECS; i++) {
+            iov[numIov].iov_base = (int8_t *)buffers[i] + (i == firstPage ? pageOffset : 0);
+            iov[numIov].iov_len = pageSize - (i == firstPage ? pageOffset : 0);
+            numIov++;
+        }
+
+        ssize_t result;
+        if (isWrite)
+            result = pwritev(fd, iov, numIov, offset + done);
+        else
+            result = preadv(fd, iov, numIov, offset + done);
+
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (result == 0)
+            break;
+        done += result;
+    }
+    return done / pageSize;
+}
+
+int8_t POSIX_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    return posixTransferPage(fileInfo->fd, buffer, pageSize, (off_t)pageNum * pageSize, 0);
+}
+
+int8_t POSIX_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    return posixTransferPage(fileInfo->fd, buffer, pageSize, (off_t)pageNum * pageSize, 1);
+}
+
+uint32_t POSIX_READ_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    return posixTransferPages(fileInfo->fd, buffers, numPages, pageSize, (off_t)pageNum * pageSize, 0);
+}
+
+uint32_t POSIX_WRITE_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    return posixTransferPages(fileInfo->fd, buffers, numPages, pageSize, (off_t)pageNum * pageSize, 1);
+}
+
+int posixFileDescriptor(void *file) {
+    return ((POSIX_FILE_INFO *)file)->fd;
+}
+
+int8_t POSIX_CLOSE(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    if (fileInfo->fd == -1)
+        return 1;
+    int result = close(fileInfo->fd);
+    fileInfo->fd = -1;
+    return result == 0;
+}
+
+/* Writes go straight to the kernel, so there is no user space buffer to flush. */
+int8_t POSIX_FLUSH(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    return fileInfo->fd != -1;
+}
+
+int8_t POSIX_SYNC(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    if (fileInfo->fd == -1)
+        return 0;
+#if defined(__APPLE__)
+    /* fsync on macOS does not ask the drive to write its cache */
+    if (fcntl(fileInfo->fd, F_FULLFSYNC) == 0)
+        return 1;
+    return fsync(fileInfo->fd) == 0;
+#else
+    /* Only the data and the file size have to reach storage, not other metadata */
+    return fdatasync(fileInfo->fd) == 0;
+#endif
+}
+
+int8_t POSIX_PREALLOCATE(uint32_t numPages, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    if (fileInfo->fd == -1)
+        return 0;
+    off_t length = (off_t)numPages * pageSize;
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    /* Keep the file size so reading a page that was never written still fails */
+    return fallocate(fileInfo->fd, FALLOC_FL_KEEP_SIZE, 0, length) == 0;
+#elif defined(F_PREALLOCATE)
+    /* F_PREALLOCATE allocates past the space the file already has and does not change its size */
+    struct stat fileStat;
+    if (fstat(fileInfo->fd, &fileStat) != 0)
+        return 0;
+    if ((off_t)fileStat.st_blocks * 512 >= length)
+        return 1;
+    fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, length - (off_t)fileStat.st_blocks * 512, 0};
+    if (fcntl(fileInfo->fd, F_PREALLOCATE, &store) != -1)
+        return 1;
+    store.fst_flags = F_ALLOCATEALL;
+    return fcntl(fileInfo->fd, F_PREALLOCATE, &store) != -1;
+#else
+    (void)length;
+    return 0;
+#endif
+}
+
+int8_t POSIX_ERASE(uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    /* The hole reads as zeros. On an SSD the file system can pass it on as a discard */
+    return fallocate(fileInfo->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)pageNum * pageSize, (off_t)numPages * pageSize) == 0;
+#else
+    (void)fileInfo;
+    return 0;
+#endif
+}
+
+/**
+ * @brief	Tells the kernel how the file will be accessed based on the role it has in embedDB.
+ */
+static void posixAdvise(POSIX_FILE_INFO *fileInfo) {
+#ifdef POSIX_FADV_NORMAL
+    int advice;
+    switch (fileInfo->role) {
+        case EMBEDDB_FILE_ROLE_DATA:
+            /* Lookups jump between pages, so kernel read-ahead would only pollute the page cache */
+            advice = POSIX_FADV_RANDOM;
+            break;
+        case EMBEDDB_FILE_ROLE_INDEX:
+            /* The index is small and is read by every filtered iterator */
+            advice = POSIX_FADV_WILLNEED;
+            break;
+        case EMBEDDB_FILE_ROLE_VAR:
+            /* Variable data is read as a stream of consecutive pages */
+            advice = POSIX_FADV_SEQUENTIAL;
+            break;
+        default:
+            advice = POSIX_FADV_NORMAL;
+            break;
+    }
+    posix_fadvise(fileInfo->fd, 0, 0, advice);
+#endif
+}
+
+/**
+ * @brief	Finds the alignment direct I/O needs for buffers and file offsets on the open file.
+ */
+static uint32_t posixDirectBlockSize(POSIX_FILE_INFO *fileInfo) {
+#ifdef STATX_DIOALIGN
+    struct statx fileStatx;
+    if (statx(fileInfo->fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &fileStatx) == 0 && (fileStatx.stx_mask & STATX_DIOALIGN) && fileStatx.stx_dio_offset_align > 0)
+        return max(fileStatx.stx_dio_mem_align, fileStatx.stx_dio_offset_align);
+#endif
+    /* Alignment is unknown, so use the preferred I/O size which is a multiple of the logical block size */
+    struct stat fileStat;
+    if (fstat(fileInfo->fd, &fileStat) == 0 && fileStat.st_blksize > 0)
+        return (uint32_t)fileStat.st_blksize;
+    return 4096;
+}
+
+int8_t POSIX_OPEN(void *file, uint8_t mode) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+
+    int flags;
+    if (mode == EMBEDDB_FILE_MODE_W_PLUS_B) {
+        flags = O_RDWR | O_CREAT | O_TRUNC;
+    } else if (mode == EMBEDDB_FILE_MODE_R_PLUS_B) {
+        flags = O_RDWR;
+    } else {
+        return 0;
+    }
+
+    fileInfo->fd = -1;
+    fileInfo->blockSize = 0;
+#ifdef O_DIRECT
+    if (fileInfo->direct) {
+        fileInfo->fd = open(fileInfo->filename, flags | O_DIRECT, 0644);
+        if (fileInfo->fd != -1) {
+            fileInfo->blockSize = posixDirectBlockSize(fileInfo);
+        } else if (errno == EINVAL) {
+#ifdef PRINT_ERRORS
+            printf("WARN: %s does not support O_DIRECT. The page cache will be used.\n", fileInfo->filename);
+#endif
+        } else {
+            return 0;
+        }
+    }
+#endif
+
+    if (fileInfo->fd == -1)
+        fileInfo->fd = open(fileInfo->filename, flags, 0644);
+    if (fileInfo->fd == -1) {
+        return 0;
+    }
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if (fileInfo->direct && fcntl(fileInfo->fd, F_NOCACHE, 1) != -1)
+        fileInfo->blockSize = posixDirectBlockSize(fileInfo);
+#endif
+
+    posixAdvise(fileInfo);
+    return 1;
+}
+
+uint32_t POSIX_BLOCK_SIZE(void *file) {
+    return ((POSIX_FILE_INFO *)file)->blockSize;
+}
+
+embedDBFileInterface *getPosixFileInterface() {
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
+    fileInterface->close = POSIX_CLOSE;
+    fileInterface->read = POSIX_READ;
+    fileInterface->write = POSIX_WRITE;
+    fileInterface->open = POSIX_OPEN;
+    fileInterface->flush = POSIX_FLUSH;
+    fileInterface->sync = POSIX_SYNC;
+    fileInterface->blockSize = POSIX_BLOCK_SIZE;
+    fileInterface->readPages = POSIX_READ_PAGES;
+    fileInterface->writePages = POSIX_WRITE_PAGES;
+    fileInterface->preallocate = POSIX_PREALLOCATE;
+    return fileInterface;
+}
+
+int8_t MMAP_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    size_t end = ((size_t)pageNum + 1) * pageSize;
+    if (!posixTransferPage(fileInfo->fd, buffer, pageSize, (off_t)pageNum * pageSize, 1))
+        return 0;
+    if (end > fileInfo->fileSize)
+        fileInfo->fileSize = end;
+    return 1;
+}
+
+uint32_t MMAP_WRITE_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    uint32_t numWritten = POSIX_WRITE_PAGES(buffers, pageNum, numPages, pageSize, file);
+    size_t end = ((size_t)pageNum + numWritten) * pageSize;
+    if (end > fileInfo->fileSize)
+        fileInfo->fileSize = end;
+    return numWritten;
+}
+
+/**
+ * @brief	Returns a pointer to the page inside the mapping, extending the mapping over the reserved address space
+ * 			if the file has grown. The mapping is shared, so pages written with MMAP_WRITE are visible through it.
+ */
+void *MMAP_MAP_PAGE(uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    size_t end = ((size_t)pageNum + 1) * pageSize;
+    if (fileInfo->map == NULL || end > fileInfo->mapReserved || end > fileInfo->fileSize)
+        return NULL;
+
+    if (end > fileInfo->mapLength) {
+        /* Map the whole file in place over the reservation so previously returned pointers stay valid */
+        size_t systemPageSize = (size_t)sysconf(_SC_PAGESIZE);
+        size_t length = (fileInfo->fileSize + systemPageSize - 1) / systemPageSize * systemPageSize;
+        if (length > fileInfo->mapReserved)
+            length = fileInfo->mapReserved;
+        if (mmap(fileInfo->map, length, PROT_READ, MAP_SHARED | MAP_FIXED, fileInfo->fd, 0) == MAP_FAILED)
+            return NULL;
+        if (fileInfo->role == EMBEDDB_FILE_ROLE_DATA)
+            posix_madvise(fileInfo->map, length, POSIX_MADV_RANDOM);
+        else if (fileInfo->role == EMBEDDB_FILE_ROLE_VAR)
+            posix_madvise(fileInfo->map, length, POSIX_MADV_SEQUENTIAL);
+        fileInfo->mapLength = length;
+    }
+
+    return (int8_t *)fileInfo->map + (size_t)pageNum * pageSize;
+}
+
+int8_t MMAP_OPEN(void *file, uint8_t mode) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    if (!POSIX_OPEN(file, mode))
+        return 0;
+
+    struct stat fileStat;
+    if (fstat(fileInfo->fd, &fileStat) != 0) {
+        POSIX_CLOSE(file);
+        return 0;
+    }
+    fileInfo->fileSize = (size_t)fileStat.st_size;
+
+    /* Reserve address space for the largest size the file can reach. Pages are mapped into it as the file grows */
+    posixUnmap(fileInfo);
+    if (fileInfo->mapReserved > 0) {
+        void *map = mmap(NULL, fileInfo->mapReserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (map == MAP_FAILED) {
+#ifdef PRINT_ERRORS
+            printf("WARN: Unable to reserve memory to map %s. Pages will be read instead.\n", fileInfo->filename);
+#endif
+        } else {
+            fileInfo->map = map;
+        }
+    }
+    return 1;
+}
+
+int8_t MMAP_CLOSE(void *file) {
+    posixUnmap((POSIX_FILE_INFO *)file);
+    return POSIX_CLOSE(file);
+}
+
+embedDBFileInterface *getMmapFileInterface() {
+    embedDBFileInterface *fileInterface = getPosixFileInterface();
+    if (fileInterface == NULL)
+        return NULL;
+    fileInterface->close = MMAP_CLOSE;
+    fileInterface->write = MMAP_WRITE;
+    fileInterface->writePages = MMAP_WRITE_PAGES;
+    fileInterface->open = MMAP_OPEN;
+    fileInterface->mapPage = MMAP_MAP_PAGE;
+    return fileInterface;
+}
+
+#endif
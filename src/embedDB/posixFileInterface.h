@@ -0,0 +1,136 @@
+/******************************************************************************/
+/**
+ * @file        posixFileInterface.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB built on POSIX file descriptors.
+ *              Pages are accessed with positional I/O (pread/pwrite) so there is
+ *              no stdio buffering and no shared file position.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#ifndef POSIX_FILE_INTERFACE_H_
+#define POSIX_FILE_INTERFACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "embedDB.h"
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define EMBEDDB_POSIX_FILE_INTERFACE 1
+
+/* Role of a file within EmbedDB. Used to give the kernel access pattern hints. */
+#define EMBEDDB_FILE_ROLE_DATA 0  /* Data pages: appended sequentially, read at random by lookups */
+#define EMBEDDB_FILE_ROLE_INDEX 1 /* Index pages: small and read repeatedly by iterators */
+#define EMBEDDB_FILE_ROLE_VAR 2   /* Variable data pages: read as sequential streams */
+
+/**
+ * @brief	Returns a file interface that uses pread/pwrite on raw file descriptors.
+ * 			Files for this interface must be created with setupPosixFile.
+ */
+embedDBFileInterface *getPosixFileInterface();
+
+/**
+ * @brief	Creates the file data to be given to embedDB for the POSIX file interface.
+ * @param	filename	Path of the file
+ * @param	role		One of the EMBEDDB_FILE_ROLE defines. Determines the access hint given to the kernel
+ * @return	Pointer to the file data, or NULL if memory could not be allocated
+ */
+void *setupPosixFile(char *filename, uint8_t role);
+
+/* Functions of the POSIX file interface. Other interfaces that use file descriptors build on these. */
+int8_t POSIX_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+int8_t POSIX_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+int8_t POSIX_CLOSE(void *file);
+int8_t POSIX_OPEN(void *file, uint8_t mode);
+int8_t POSIX_FLUSH(void *file);
+int8_t POSIX_SYNC(void *file);
+uint32_t POSIX_BLOCK_SIZE(void *file);
+uint32_t POSIX_READ_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+uint32_t POSIX_WRITE_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+int8_t POSIX_PREALLOCATE(uint32_t numPages, uint32_t pageSize, void *file);
+
+/**
+ * @brief	Erase function that punches a hole over the erased pages so the file system can free them (Linux only).
+ * 			Not set by getPosixFileInterface, because freed pages have to be allocated again when they are next
+ * 			written. To use it, set fileInterface->erase = POSIX_ERASE.
+ */
+int8_t POSIX_ERASE(uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+
+/**
+ * @brief	Returns the file descriptor of a file created by setupPosixFile or setupMmapFile, or -1 if the file is not open.
+ */
+int posixFileDescriptor(void *file);
+
+/**
+ * @brief	Creates the file data to be given to embedDB for a POSIX file that bypasses the operating system page cache
+ * 			(O_DIRECT, or F_NOCACHE on macOS). Use with getPosixFileInterface. Pages go straight between storage and
+ * 			embedDB's buffer, so the buffer must be allocated with embedDBAlignedAlloc and the page size must be a
+ * 			multiple of the storage block size. embedDBInit checks both.
+ * 			If the file system does not support direct I/O, the file is opened normally.
+ * @param	filename	Path of the file
+ * @param	role		One of the EMBEDDB_FILE_ROLE defines. Determines the access hint given to the kernel
+ * @return	Pointer to the file data, or NULL if memory could not be allocated
+ */
+void *setupDirectFile(char *filename, uint8_t role);
+
+/**
+ * @brief	Returns a file interface that memory-maps each file so embedDB can use pages in place instead of copying them
+ * 			into its buffer. Writes still use pwrite. Files for this interface must be created with setupMmapFile.
+ */
+embedDBFileInterface *getMmapFileInterface();
+
+/**
+ * @brief	Creates the file data to be given to embedDB for the memory-mapped file interface.
+ * @param	filename	Path of the file
+ * @param	role		One of the EMBEDDB_FILE_ROLE defines. Determines the access hint given to the kernel
+ * @param	maxFileSize	Largest size the file can grow to in bytes (e.g. numDataPages * pageSize). Address space for this is
+ * 						reserved when the file is opened. Pages beyond it are read instead of mapped
+ * @return	Pointer to the file data, or NULL if memory could not be allocated
+ */
+void *setupMmapFile(char *filename, uint8_t role, size_t maxFileSize);
+
+/**
+ * @brief	Closes the file if it is open and frees the file data created by setupPosixFile or setupMmapFile.
+ * @param	file	File data created by setupPosixFile or setupMmapFile
+ */
+void tearDownPosixFile(void *file);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
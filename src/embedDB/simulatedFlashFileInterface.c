@@ -0,0 +1,201 @@
+/******************************************************************************/
+/**
+ * @file        simulatedFlashFileInterface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB that simulates a raw flash device in
+ *              memory, with page read and program latency, erase blocks and
+ *              wear counters.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include "simulatedFlashFileInterface.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int8_t *pages;               /* Contents of every page */
+    uint8_t *programmed;         /* 1 for each page programmed since its erase block was last erased */
+    uint32_t *blockErases;       /* Number of times each erase block was erased */
+    uint32_t pageSize;           /* Size of a page in bytes */
+    uint32_t numPages;           /* Number of pages on the device */
+    uint32_t eraseSizeInPages;   /* Size of an erase block in pages */
+    uint32_t numBlocks;          /* Number of erase blocks. The last may be shorter than eraseSizeInPages */
+    simulatedFlashTiming timing; /* Time each operation takes */
+    simulatedFlashStats stats;   /* Counters since the device was set up. Block erase counts are found when requested */
+    int8_t exists;               /* 1 once the device has been opened with EMBEDDB_FILE_MODE_W_PLUS_B */
+} SIMULATED_FLASH_INFO;
+
+void *setupSimulatedFlash(uint32_t pageSize, uint32_t numPages, uint32_t eraseSizeInPages, simulatedFlashTiming *timing) {
+    if (eraseSizeInPages == 0)
+        return NULL;
+    SIMULATED_FLASH_INFO *fileInfo = calloc(1, sizeof(SIMULATED_FLASH_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    fileInfo->numBlocks = (numPages + eraseSizeInPages - 1) / eraseSizeInPages;
+    fileInfo->pages = malloc((size_t)numPages * pageSize);
+    fileInfo->programmed = calloc(numPages, sizeof(uint8_t));
+    fileInfo->blockErases = calloc(fileInfo->numBlocks, sizeof(uint32_t));
+    if (fileInfo->pages == NULL || fileInfo->programmed == NULL || fileInfo->blockErases == NULL) {
+        tearDownSimulatedFlash(fileInfo);
+        return NULL;
+    }
+    fileInfo->pageSize = pageSize;
+    fileInfo->numPages = numPages;
+    fileInfo->eraseSizeInPages = eraseSizeInPages;
+    fileInfo->timing = *timing;
+    return fileInfo;
+}
+
+void tearDownSimulatedFlash(void *file) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    free(fileInfo->pages);
+    free(fileInfo->programmed);
+    free(fileInfo->blockErases);
+    free(file);
+}
+
+void getSimulatedFlashStats(void *file, simulatedFlashStats *stats) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    *stats = fileInfo->stats;
+    stats->maxBlockErases = 0;
+    stats->minBlockErases = UINT32_MAX;
+    for (uint32_t i = 0; i < fileInfo->numBlocks; i++) {
+        if (fileInfo->blockErases[i] > stats->maxBlockErases)
+            stats->maxBlockErases = fileInfo->blockErases[i];
+        if (fileInfo->blockErases[i] < stats->minBlockErases)
+            stats->minBlockErases = fileInfo->blockErases[i];
+    }
+}
+
+uint32_t getSimulatedFlashBlockErases(void *file, uint32_t blockNum) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    if (blockNum >= fileInfo->numBlocks)
+        return 0;
+    return fileInfo->blockErases[blockNum];
+}
+
+/**
+ * @brief	Erases one erase block, counting its wear and the time taken.
+ */
+static void simulatedFlashEraseBlock(SIMULATED_FLASH_INFO *fileInfo, uint32_t blockNum) {
+    uint32_t firstPage = blockNum * fileInfo->eraseSizeInPages;
+    uint32_t numPages = fileInfo->eraseSizeInPages;
+    if (firstPage + numPages > fileInfo->numPages)
+        numPages = fileInfo->numPages - firstPage;
+    memset(fileInfo->programmed + firstPage, 0, numPages);
+    fileInfo->blockErases[blockNum]++;
+    fileInfo->stats.numErases++;
+    fileInfo->stats.elapsedTimeInMicros += fileInfo->timing.eraseTimeInMicros;
+}
+
+int8_t SIMULATED_FLASH_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    if (pageNum >= fileInfo->numPages || pageSize != fileInfo->pageSize)
+        return 0;
+    fileInfo->stats.numReads++;
+    fileInfo->stats.elapsedTimeInMicros += fileInfo->timing.readTimeInMicros;
+    if (!fileInfo->programmed[pageNum])
+        return 0;
+    memcpy(buffer, fileInfo->pages + (size_t)pageNum * pageSize, pageSize);
+    return 1;
+}
+
+int8_t SIMULATED_FLASH_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    if (pageNum >= fileInfo->numPages || pageSize != fileInfo->pageSize)
+        return 0;
+    if (fileInfo->programmed[pageNum]) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Page %u of the simulated flash was written again without being erased.\n", pageNum);
+#endif
+        fileInfo->stats.numViolations++;
+        return 0;
+    }
+    memcpy(fileInfo->pages + (size_t)pageNum * pageSize, buffer, pageSize);
+    fileInfo->programmed[pageNum] = 1;
+    fileInfo->stats.numWrites++;
+    fileInfo->stats.elapsedTimeInMicros += fileInfo->timing.writeTimeInMicros;
+    return 1;
+}
+
+int8_t SIMULATED_FLASH_ERASE(uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    if (pageNum % fileInfo->eraseSizeInPages != 0 || numPages % fileInfo->eraseSizeInPages != 0 || pageNum + numPages > fileInfo->numPages) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Pages %u to %u of the simulated flash are not whole erase blocks.\n", pageNum, pageNum + numPages - 1);
+#endif
+        fileInfo->stats.numViolations++;
+        return 0;
+    }
+    for (uint32_t blockNum = pageNum / fileInfo->eraseSizeInPages; blockNum < (pageNum + numPages) / fileInfo->eraseSizeInPages; blockNum++)
+        simulatedFlashEraseBlock(fileInfo, blockNum);
+    return 1;
+}
+
+/* Every page is programmed straight to the device, so there is nothing to flush. */
+int8_t SIMULATED_FLASH_FLUSH(void *file) {
+    return 1;
+}
+
+int8_t SIMULATED_FLASH_OPEN(void *file, uint8_t mode) {
+    SIMULATED_FLASH_INFO *fileInfo = (SIMULATED_FLASH_INFO *)file;
+    if (mode == EMBEDDB_FILE_MODE_W_PLUS_B) {
+        /* Creating the file erases every block that holds data, as the device has to */
+        for (uint32_t blockNum = 0; blockNum < fileInfo->numBlocks; blockNum++) {
+            uint32_t firstPage = blockNum * fileInfo->eraseSizeInPages;
+            for (uint32_t pageNum = firstPage; pageNum < firstPage + fileInfo->eraseSizeInPages && pageNum < fileInfo->numPages; pageNum++) {
+                if (fileInfo->programmed[pageNum]) {
+                    simulatedFlashEraseBlock(fileInfo, blockNum);
+                    break;
+                }
+            }
+        }
+        fileInfo->exists = 1;
+        return 1;
+    }
+    return mode == EMBEDDB_FILE_MODE_R_PLUS_B && fileInfo->exists;
+}
+
+int8_t SIMULATED_FLASH_CLOSE(void *file) {
+    return 1;
+}
+
+embedDBFileInterface *getSimulatedFlashFileInterface() {
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
+    fileInterface->close = SIMULATED_FLASH_CLOSE;
+    fileInterface->read = SIMULATED_FLASH_READ;
+    fileInterface->write = SIMULATED_FLASH_WRITE;
+    fileInterface->open = SIMULATED_FLASH_OPEN;
+    fileInterface->flush = SIMULATED_FLASH_FLUSH;
+    fileInterface->erase = SIMULATED_FLASH_ERASE;
+    return fileInterface;
+}
@@ -0,0 +1,115 @@
+/******************************************************************************/
+/**
+ * @file        simulatedFlashFileInterface.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB that simulates a raw flash device in
+ *              memory, with page read and program latency, erase blocks and
+ *              wear counters.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#ifndef SIMULATED_FLASH_FILE_INTERFACE_H_
+#define SIMULATED_FLASH_FILE_INTERFACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "embedDB.h"
+
+/**
+ * @brief	Time each operation takes on the simulated device.
+ */
+typedef struct {
+    uint32_t readTimeInMicros;  /* Time to read a page */
+    uint32_t writeTimeInMicros; /* Time to program a page */
+    uint32_t eraseTimeInMicros; /* Time to erase an erase block */
+} simulatedFlashTiming;
+
+/**
+ * @brief	Counters of a simulated device since it was set up.
+ */
+typedef struct {
+    uint32_t numReads;            /* Number of pages read */
+    uint32_t numWrites;           /* Number of pages programmed */
+    uint32_t numErases;           /* Number of erase blocks erased */
+    uint32_t numViolations;       /* Writes to pages that were not erased, and erases not on erase block boundaries */
+    uint32_t maxBlockErases;      /* Most times any one erase block was erased */
+    uint32_t minBlockErases;      /* Fewest times any one erase block was erased */
+    uint64_t elapsedTimeInMicros; /* Time the device spent reading, programming and erasing */
+} simulatedFlashStats;
+
+/**
+ * @brief	Returns a file interface that simulates a raw flash device, so tuning choices for flash targets can be
+ * 			measured without the hardware. Like flash, a page can only be programmed once until its erase block is
+ * 			erased, and blocks can only be erased whole. Writes and erases that break these rules fail and are
+ * 			counted as violations. Pages that have not been programmed since they were erased fail to read.
+ * 			Opening a device with EMBEDDB_FILE_MODE_W_PLUS_B erases every block that has been programmed.
+ * 			Files for this interface must be created with setupSimulatedFlash.
+ */
+embedDBFileInterface *getSimulatedFlashFileInterface();
+
+/**
+ * @brief	Creates a simulated flash device. Its pages stay in memory when it is closed, so it can be recovered.
+ * @param	pageSize			Size of a page in bytes. Must match embedDBState->pageSize
+ * @param	numPages			Number of pages on the device (e.g. embedDBState->numDataPages)
+ * @param	eraseSizeInPages	Size of an erase block in pages. Must match embedDBState->eraseSizeInPages
+ * @param	timing				Time each operation takes. Copied, so it does not have to stay valid
+ * @return	Pointer to the device data, or NULL if memory could not be allocated
+ */
+void *setupSimulatedFlash(uint32_t pageSize, uint32_t numPages, uint32_t eraseSizeInPages, simulatedFlashTiming *timing);
+
+/**
+ * @brief	Copies the counters of a simulated device.
+ * @param	file	Device data created by setupSimulatedFlash
+ * @param	stats	Counters are returned here
+ */
+void getSimulatedFlashStats(void *file, simulatedFlashStats *stats);
+
+/**
+ * @brief	Returns the number of times an erase block of a simulated device has been erased.
+ * @param	file		Device data created by setupSimulatedFlash
+ * @param	blockNum	Erase block number. Block n holds pages n * eraseSizeInPages onwards
+ * @return	Number of erases, or 0 if blockNum is past the end of the device
+ */
+uint32_t getSimulatedFlashBlockErases(void *file, uint32_t blockNum);
+
+/**
+ * @brief	Frees the device data created by setupSimulatedFlash.
+ */
+void tearDownSimulatedFlash(void *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,367 @@
+/******************************************************************************/
+/**
+ * @file        uringFileInterface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB built on Linux io_uring.
+ *              Several page reads or writes can be queued and completed with a
+ *              single system call.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+
+#include "uringFileInterface.h"
+
+#ifdef EMBEDDB_URING_FILE_INTERFACE
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* A request queued with readAsync or writeAsync */
+typedef struct {
+    void *buffer;
+    uint32_t pageNum;
+    uint32_t pageSize;
+    int8_t isWrite;
+    int8_t done;
+    int8_t result;
+} URING_REQUEST;
+
+typedef struct {
+    void *posixFile;           /* File data of the POSIX file interface that owns the file descriptor */
+    uint32_t queueDepth;       /* Maximum number of queued requests */
+    URING_REQUEST *requests;   /* Requests queued since the last waitAsync */
+    uint32_t numQueued;        /* Number of requests queued since the last waitAsync */
+    uint32_t numUnsubmitted;   /* Number of queued requests not yet given to the kernel */
+    uint32_t numInFlight;      /* Number of requests given to the kernel that have not completed */
+    int ringFd;                /* io_uring file descriptor. -1 if io_uring is not available */
+    void *sqRing;              /* Submission queue ring */
+    size_t sqRingSize;
+    void *cqRing;              /* Completion queue ring. Same as sqRing if the kernel maps both rings together */
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes; /* Submission queue entries */
+    size_t sqesSize;
+    uint32_t *sqTail;
+    uint32_t *sqMask;
+    uint32_t *sqArray;
+    uint32_t *cqHead;
+    uint32_t *cqTail;
+    uint32_t *cqMask;
+    struct io_uring_cqe *cqes;
+} URING_FILE_INFO;
+
+void *setupUringFile(char *filename, uint8_t role, uint32_t queueDepth) {
+    URING_FILE_INFO *fileInfo = malloc(sizeof(URING_FILE_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    fileInfo->posixFile = setupPosixFile(filename, role);
+    fileInfo->queueDepth = queueDepth > 0 ? queueDepth : 1;
+    fileInfo->requests = malloc(fileInfo->queueDepth * sizeof(URING_REQUEST));
+    if (fileInfo->posixFile == NULL || fileInfo->requests == NULL) {
+        if (fileInfo->posixFile != NULL)
+            tearDownPosixFile(fileInfo->posixFile);
+        free(fileInfo->requests);
+        free(fileInfo);
+        return NULL;
+    }
+    fileInfo->numQueued = 0;
+    fileInfo->numUnsubmitted = 0;
+    fileInfo->numInFlight = 0;
+    fileInfo->ringFd = -1;
+    fileInfo->sqRing = NULL;
+    fileInfo->cqRing = NULL;
+    fileInfo->sqes = NULL;
+    return fileInfo;
+}
+
+/**
+ * @brief	Unmaps and closes the io_uring instance of the file if it has one.
+ */
+static void uringTearDownRing(URING_FILE_INFO *fileInfo) {
+    if (fileInfo->ringFd == -1)
+        return;
+    if (fileInfo->sqes != NULL)
+        munmap(fileInfo->sqes, fileInfo->sqesSize);
+    if (fileInfo->cqRing != NULL && fileInfo->cqRing != fileInfo->sqRing)
+        munmap(fileInfo->cqRing, fileInfo->cqRingSize);
+    if (fileInfo->sqRing != NULL)
+        munmap(fileInfo->sqRing, fileInfo->sqRingSize);
+    close(fileInfo->ringFd);
+    fileInfo->ringFd = -1;
+    fileInfo->sqRing = NULL;
+    fileInfo->cqRing = NULL;
+    fileInfo->sqes = NULL;
+}
+
+/**
+ * @brief	Creates an io_uring instance for the file. If the kernel does not support or allow io_uring, ringFd is left as -1.
+ */
+static void uringSetupRing(URING_FILE_INFO *fileInfo) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fileInfo->ringFd = (int)syscall(__NR_io_uring_setup, fileInfo->queueDepth, &params);
+    if (fileInfo->ringFd < 0) {
+        fileInfo->ringFd = -1;
+        return;
+    }
+
+    fileInfo->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    fileInfo->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        fileInfo->sqRingSize = max(fileInfo->sqRingSize, fileInfo->cqRingSize);
+        fileInfo->cqRingSize = fileInfo->sqRingSize;
+    }
+
+    void *sqRing = mmap(NULL, fileInfo->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileInfo->ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        uringTearDownRing(fileInfo);
+        return;
+    }
+    fileInfo->sqRing = sqRing;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        fileInfo->cqRing = sqRing;
+    } else {
+        void *cqRing = mmap(NULL, fileInfo->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileInfo->ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            uringTearDownRing(fileInfo);
+            return;
+        }
+        fileInfo->cqRing = cqRing;
+    }
+
+    fileInfo->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, fileInfo->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileInfo->ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        uringTearDownRing(fileInfo);
+        return;
+    }
+    fileInfo->sqes = sqes;
+
+    int8_t *sq = (int8_t *)fileInfo->sqRing;
+    int8_t *cq = (int8_t *)fileInfo->cqRing;
+    fileInfo->sqTail = (uint32_t *)(sq + params.sq_off.tail);
+    fileInfo->sqMask = (uint32_t *)(sq + params.sq_off.ring_mask);
+    fileInfo->sqArray = (uint32_t *)(sq + params.sq_off.array);
+    fileInfo->cqHead = (uint32_t *)(cq + params.cq_off.head);
+    fileInfo->cqTail = (uint32_t *)(cq + params.cq_off.tail);
+    fileInfo->cqMask = (uint32_t *)(cq + params.cq_off.ring_mask);
+    fileInfo->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+}
+
+void tearDownUringFile(void *file) {
+    URING_FILE_INFO *fileInfo = (URING_FILE_INFO *)file;
+    uringTearDownRing(fileInfo);
+    tearDownPosixFile(fileInfo->posixFile);
+    free(fileInfo->requests);
+    free(file);
+}
+
+int8_t uringFileIsAsync(void *file) {
+    return ((URING_FILE_INFO *)file)->ringFd != -1;
+}
+
+int8_t URING_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    return POSIX_READ(buffer, pageNum, pageSize, ((URING_FILE_INFO *)file)->posixFile);
+}
+
+int8_t URING_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    return POSIX_WRITE(buffer, pageNum, pageSize, ((URING_FILE_INFO *)file)->posixFile);
+}
+
+int8_t URING_FLUSH(void *file) {
+    return POSIX_FLUSH(((URING_FILE_INFO *)file)->posixFile);
+}
+
+int8_t URING_SYNC(void *file) {
+    return POSIX_SYNC(((URING_FILE_INFO *)file)->posixFile);
+}
+
+int8_t URING_PREALLOCATE(uint32_t numPages, uint32_t pageSize, void *file) {
+    return POSIX_PREALLOCATE(numPages, pageSize, ((URING_FILE_INFO *)file)->posixFile);
+}
+
+int8_t URING_OPEN(void *file, uint8_t mode) {
+    URING_FILE_INFO *fileInfo = (URING_FILE_INFO *)file;
+    if (!POSIX_OPEN(fileInfo->posixFile, mode))
+        return 0;
+    fileInfo->numQueued = 0;
+    fileInfo->numUnsubmitted = 0;
+    fileInfo->numInFlight = 0;
+    if (fileInfo->ringFd == -1)
+        uringSetupRing(fileInfo);
+    return 1;
+}
+
+int8_t URING_CLOSE(void *file) {
+    URING_FILE_INFO *fileInfo = (URING_FILE_INFO *)file;
+    uringTearDownRing(fileInfo);
+    return POSIX_CLOSE(fileInfo->posixFile);
+}
+
+/**
+ * @brief	Does a queued request with pread/pwrite. Used when io_uring is not available or a request comes back short.
+ */
+static void uringCompleteSynchronously(URING_FILE_INFO *fileInfo, URING_REQUEST *request) {
+    if (request->isWrite)
+        request->result = POSIX_WRITE(request->buffer, request->pageNum, request->pageSize, fileInfo->posixFile);
+    else
+        request->result = POSIX_READ(request->buffer, request->pageNum, request->pageSize, fileInfo->posixFile);
+    request->done = 1;
+}
+
+static int8_t uringQueue(URING_FILE_INFO *fileInfo, void *buffer, uint32_t pageNum, uint32_t pageSize, int8_t isWrite) {
+    if (fileInfo->numQueued >= fileInfo->queueDepth)
+        return 0;
+
+    uint32_t requestNum = fileInfo->numQueued++;
+    URING_REQUEST *request = &fileInfo->requests[requestNum];
+    request->buffer = buffer;
+    request->pageNum = pageNum;
+    request->pageSize = pageSize;
+    request->isWrite = isWrite;
+    request->done = 0;
+    request->result = 0;
+
+    if (fileInfo->ringFd == -1) {
+        uringCompleteSynchronously(fileInfo, request);
+        return 1;
+    }
+
+    /* Only this thread writes the tail, so it can be read without a barrier */
+    uint32_t tail = *fileInfo->sqTail;
+    uint32_t index = tail & *fileInfo->sqMask;
+    struct io_uring_sqe *sqe = &fileInfo->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = posixFileDescriptor(fileInfo->posixFile);
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = pageSize;
+    sqe->off = (uint64_t)pageNum * pageSize;
+    sqe->user_data = requestNum;
+    fileInfo->sqArray[index] = index;
+    __atomic_store_n(fileInfo->sqTail, tail + 1, __ATOMIC_RELEASE);
+    fileInfo->numUnsubmitted++;
+    return 1;
+}
+
+int8_t URING_READ_ASYNC(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    return uringQueue((URING_FILE_INFO *)file, buffer, pageNum, pageSize, 0);
+}
+
+int8_t URING_WRITE_ASYNC(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    return uringQueue((URING_FILE_INFO *)file, buffer, pageNum, pageSize, 1);
+}
+
+/**
+ * @brief	Takes all available entries off the completion queue.
+ */
+static void uringReap(URING_FILE_INFO *fileInfo) {
+    uint32_t head = *fileInfo->cqHead;
+    uint32_t tail = __atomic_load_n(fileInfo->cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &fileInfo->cqes[head & *fileInfo->cqMask];
+        URING_REQUEST *request = &fileInfo->requests[cqe->user_data];
+        if (cqe->res == (int32_t)request->pageSize) {
+            request->result = 1;
+            request->done = 1;
+        } else if (cqe->res == 0 && !request->isWrite) {
+            /* End of file */
+            request->result = 0;
+            request->done = 1;
+        } else {
+            /* Short transfer, interrupted request or an operation the kernel does not support */
+            uringCompleteSynchronously(fileInfo, request);
+        }
+        fileInfo->numInFlight--;
+        head++;
+    }
+    __atomic_store_n(fileInfo->cqHead, head, __ATOMIC_RELEASE);
+}
+
+int32_t URING_WAIT_ASYNC(int8_t *results, uint32_t maxResults, void *file) {
+    URING_FILE_INFO *fileInfo = (URING_FILE_INFO *)file;
+    int8_t failed = 0;
+
+    while (fileInfo->ringFd != -1 && fileInfo->numUnsubmitted + fileInfo->numInFlight > 0) {
+        int submitted = (int)syscall(__NR_io_uring_enter, fileInfo->ringFd, fileInfo->numUnsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            failed = 1;
+            break;
+        }
+        fileInfo->numUnsubmitted -= submitted;
+        fileInfo->numInFlight += submitted;
+        uringReap(fileInfo);
+    }
+
+    if (failed) {
+#ifdef PRINT_ERRORS
+        printf("WARN: io_uring failed (%d). Switching to synchronous reads and writes.\n", errno);
+#endif
+        /* Requests still in the kernel may complete later, so the ring cannot be reused */
+        uringTearDownRing(fileInfo);
+        for (uint32_t i = 0; i < fileInfo->numQueued; i++) {
+            if (!fileInfo->requests[i].done)
+                uringCompleteSynchronously(fileInfo, &fileInfo->requests[i]);
+        }
+    }
+
+    uint32_t numCompleted = fileInfo->numQueued;
+    for (uint32_t i = 0; i < numCompleted && i < maxResults; i++)
+        results[i] = fileInfo->requests[i].result;
+    fileInfo->numQueued = 0;
+    fileInfo->numUnsubmitted = 0;
+    fileInfo->numInFlight = 0;
+    return numCompleted;
+}
+
+embedDBFileInterface *getUringFileInterface() {
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
+    fileInterface->close = URING_CLOSE;
+    fileInterface->read = URING_READ;
+    fileInterface->write = URING_WRITE;
+    fileInterface->open = URING_OPEN;
+    fileInterface->flush = URING_FLUSH;
+    fileInterface->sync = URING_SYNC;
+    fileInterface->preallocate = URING_PREALLOCATE;
+    fileInterface->readAsync = URING_READ_ASYNC;
+    fileInterface->writeAsync = URING_WRITE_ASYNC;
+    fileInterface->waitAsync = URING_WAIT_ASYNC;
+    return fileInterface;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/******************************************************************************/
+/**
+ * @file        uringFileInterface.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB built on Linux io_uring.
+ *              Several page reads or writes can be queued and completed with a
+ *              single system call.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+
+#ifndef URING_FILE_INTERFACE_H_
+#define URING_FILE_INTERFACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "embedDB.h"
+#include "posixFileInterface.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define EMBEDDB_URING_FILE_INTERFACE 1
+
+/**
+ * @brief	Returns a file interface that supports queueing page reads and writes (readAsync/writeAsync) and completing
+ * 			them together with waitAsync. Single page reads and writes use pread/pwrite.
+ * 			If the kernel does not allow io_uring, queued requests are done synchronously when they are queued.
+ * 			Files for this interface must be created with setupUringFile.
+ */
+embedDBFileInterface *getUringFileInterface();
+
+/**
+ * @brief	Creates the file data to be given to embedDB for the io_uring file interface.
+ * @param	filename	Path of the file
+ * @param	role		One of the EMBEDDB_FILE_ROLE defines. Determines the access hint given to the kernel
+ * @param	queueDepth	Maximum number of requests that can be queued before waitAsync is called
+ * @return	Pointer to the file data, or NULL if memory could not be allocated
+ */
+void *setupUringFile(char *filename, uint8_t role, uint32_t queueDepth);
+
+/**
+ * @brief	Closes the file if it is open and frees the file data created by setupUringFile.
+ * @param	file	File data created by setupUringFile
+ */
+void tearDownUringFile(void *file);
+
+/**
+ * @brief	Returns 1 if queued requests on the open file are done with io_uring, or 0 if they fall back to pread/pwrite.
+ */
+int8_t uringFileIsAsync(void *file);
+
+#endif
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
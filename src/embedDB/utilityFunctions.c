@@ -55,7 +55,8 @@ embedDBState *defaultInitializedState() {
     state->numSplinePoints = 300;
     state->bitmapSize = 1;
     state->bufferSizeInBlocks = 4;
-    state->buffer = malloc((size_t)state->bufferSizeInBlocks * state->pageSize);
+    /* Aligned to the page size so the buffer also works with file interfaces that bypass the operating system cache */
+    state->buffer = embedDBAlignedAlloc(state->pageSize, (size_t)state->bufferSizeInBlocks * state->pageSize);
 
     /* Address level parameters */
     state->numDataPages = 20000;  // Enough for 620,000 records
@@ -82,7 +83,7 @@ embedDBState *defaultInitializedState() {
 #ifdef PRINT_ERRORS
         printf("Initialization error.\n");
 #endif
-        free(state->buffer);
+        embedDBAlignedFree(state->buffer);
         free(state->fileInterface);
         tearDownFile(state->dataFile);
         tearDownFile(state->indexFile);
@@ -289,19 +290,21 @@ int8_t int32Comparator(void *a, void *b) {
     int32_t i1, i2;
     memcpy(&i1, a, sizeof(int32_t));
     memcpy(&i2, b, sizeof(int32_t));
-    int32_t result = i1 - i2;
-    if (result < 0)
+    /* Compare instead of subtracting, which overflows for values far apart */
+    if (i1 < i2)
         return -1;
-    if (result > 0)
+    if (i1 > i2)
         return 1;
     return 0;
 }
 
 int8_t int64Comparator(void *a, void *b) {
-    int64_t result = *((int64_t *)a) - *((int64_t *)b);
-    if (result < 0)
+    int64_t i1, i2;
+    memcpy(&i1, a, sizeof(int64_t));
+    memcpy(&i2, b, sizeof(int64_t));
+    if (i1 < i2)
         return -1;
-    if (result > 0)
+    if (i1 > i2)
         return 1;
     return 0;
 }
@@ -371,7 +374,7 @@ int8_t FILE_OPEN(void *file, uint8_t mode) {
 }
 
 embedDBFileInterface *getFileInterface() {
-    embedDBFileInterface *fileInterface = malloc(sizeof(embedDBFileInterface));
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
     fileInterface->close = FILE_CLOSE;
     fileInterface->read = FILE_READ;
     fileInterface->write = FILE_WRITE;
@@ -379,3 +382,140 @@ embedDBFileInterface *getFileInterface() {
     fileInterface->flush = FILE_FLUSH;
     return fileInterface;
 }
+
+typedef struct {
+    int8_t *pages;        /* Storage for numPages pages */
+    uint32_t pageSize;    /* Size of a page in bytes */
+    uint32_t numPages;    /* Number of pages that fit in pages */
+    uint32_t length;      /* Number of pages in the file. Pages at or after this fail to read, like the end of a file */
+    int8_t exists;        /* 1 once the file has been created, so it can be opened with EMBEDDB_FILE_MODE_R_PLUS_B */
+    int8_t isOpen;        /* 1 while the file is open */
+    char *snapshotPath;   /* File the pages are saved to, or NULL */
+} RAM_FILE_INFO;
+
+void *setupRamFile(uint32_t pageSize, uint32_t numPages, char *snapshotPath) {
+    RAM_FILE_INFO *fileInfo = malloc(sizeof(RAM_FILE_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    /* Pages between ones that were written must read as zeros, as they would from a file */
+    fileInfo->pages = calloc(numPages, pageSize);
+    if (fileInfo->pages == NULL) {
+        free(fileInfo);
+        return NULL;
+    }
+    fileInfo->pageSize = pageSize;
+    fileInfo->numPages = numPages;
+    fileInfo->length = 0;
+    fileInfo->exists = 0;
+    fileInfo->isOpen = 0;
+    fileInfo->snapshotPath = NULL;
+    if (snapshotPath != NULL) {
+        int nameLen = strlen(snapshotPath);
+        fileInfo->snapshotPath = calloc(1, nameLen + 1);
+        memcpy(fileInfo->snapshotPath, snapshotPath, nameLen);
+    }
+    return fileInfo;
+}
+
+void tearDownRamFile(void *file) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    free(fileInfo->pages);
+    free(fileInfo->snapshotPath);
+    free(file);
+}
+
+int8_t RAM_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    if (pageNum >= fileInfo->length || pageSize != fileInfo->pageSize)
+        return 0;
+    memcpy(buffer, fileInfo->pages + (size_t)pageNum * pageSize, pageSize);
+    return 1;
+}
+
+int8_t RAM_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    if (pageNum >= fileInfo->numPages || pageSize != fileInfo->pageSize) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Page %u does not fit in the RAM file.\n", pageNum);
+#endif
+        return 0;
+    }
+    memcpy(fileInfo->pages + (size_t)pageNum * pageSize, buffer, pageSize);
+    if (pageNum >= fileInfo->length)
+        fileInfo->length = pageNum + 1;
+    return 1;
+}
+
+/**
+ * @brief	Pages stay at the same address until the file is torn down, so they can be used in place.
+ */
+void *RAM_MAP_PAGE(uint32_t pageNum, uint32_t pageSize, void *file) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    if (pageNum >= fileInfo->length || pageSize != fileInfo->pageSize)
+        return NULL;
+    return fileInfo->pages + (size_t)pageNum * pageSize;
+}
+
+/**
+ * @brief	Writes the pages of the file to its snapshot file.
+ * @return	1 for success (or if there is no snapshot file) and 0 for failure
+ */
+int8_t RAM_SYNC(void *file) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    if (fileInfo->snapshotPath == NULL)
+        return 1;
+    FILE *snapshot = fopen(fileInfo->snapshotPath, "wb");
+    if (snapshot == NULL)
+        return 0;
+    int8_t success = fwrite(fileInfo->pages, fileInfo->pageSize, fileInfo->length, snapshot) == fileInfo->length;
+    success = fclose(snapshot) == 0 && success;
+    return success;
+}
+
+/* Pages are written straight to memory, so there is nothing to flush. */
+int8_t RAM_FLUSH(void *file) {
+    return ((RAM_FILE_INFO *)file)->isOpen;
+}
+
+int8_t RAM_OPEN(void *file, uint8_t mode) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    if (mode == EMBEDDB_FILE_MODE_W_PLUS_B) {
+        memset(fileInfo->pages, 0, (size_t)fileInfo->length * fileInfo->pageSize);
+        fileInfo->length = 0;
+    } else if (mode == EMBEDDB_FILE_MODE_R_PLUS_B) {
+        if (!fileInfo->exists && fileInfo->snapshotPath != NULL) {
+            FILE *snapshot = fopen(fileInfo->snapshotPath, "rb");
+            if (snapshot == NULL)
+                return 0;
+            fileInfo->length = fread(fileInfo->pages, fileInfo->pageSize, fileInfo->numPages, snapshot);
+            fclose(snapshot);
+        } else if (!fileInfo->exists) {
+            return 0;
+        }
+    } else {
+        return 0;
+    }
+    fileInfo->exists = 1;
+    fileInfo->isOpen = 1;
+    return 1;
+}
+
+int8_t RAM_CLOSE(void *file) {
+    RAM_FILE_INFO *fileInfo = (RAM_FILE_INFO *)file;
+    if (!fileInfo->isOpen)
+        return 1;
+    fileInfo->isOpen = 0;
+    return RAM_SYNC(file);
+}
+
+embedDBFileInterface *getRamFileInterface() {
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
+    fileInterface->close = RAM_CLOSE;
+    fileInterface->read = RAM_READ;
+    fileInterface->write = RAM_WRITE;
+    fileInterface->open = RAM_OPEN;
+    fileInterface->flush = RAM_FLUSH;
+    fileInterface->sync = RAM_SYNC;
+    fileInterface->mapPage = RAM_MAP_PAGE;
+    return fileInterface;
+}
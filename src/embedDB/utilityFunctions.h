@@ -46,6 +46,7 @@ extern "C" {
 #include "embedDB.h"
 
 /* Constructors */
+/* The buffer of the returned state is allocated with embedDBAlignedAlloc and must be freed with embedDBAlignedFree */
 embedDBState *defaultInitializedState();
 
 /* Bitmap functions */
@@ -68,6 +69,28 @@ embedDBFileInterface *getFileInterface();
 void *setupFile(char *filename);
 void tearDownFile(void *file);
 
+/**
+ * @brief	Returns a file interface that keeps pages in memory. Pages are used in place through mapPage, so lookups
+ * 			and iterators do not copy them. Files for this interface must be created with setupRamFile.
+ */
+embedDBFileInterface *getRamFileInterface();
+
+/**
+ * @brief	Creates the file data for a file that keeps its pages in memory. Like a file on storage, the pages stay
+ * 			when the file is closed and are cleared when it is opened with EMBEDDB_FILE_MODE_W_PLUS_B.
+ * @param	pageSize		Size of a page in bytes. Must match embedDBState->pageSize
+ * @param	numPages		Number of pages the file can hold (e.g. embedDBState->numDataPages)
+ * @param	snapshotPath	Optional. If not NULL, the pages are saved to this file by sync and close, and loaded from it
+ * 							when the file is opened with EMBEDDB_FILE_MODE_R_PLUS_B before it has any pages
+ * @return	Pointer to the file data, or NULL if memory could not be allocated
+ */
+void *setupRamFile(uint32_t pageSize, uint32_t numPages, char *snapshotPath);
+
+/**
+ * @brief	Frees the file data and pages created by setupRamFile.
+ */
+void tearDownRamFile(void *file);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,343 @@
+/******************************************************************************/
+/**
+ * @file        writerThreadFileInterface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB that writes pages on a background thread.
+ *              Pages are copied into a ring of page buffers and written by the
+ *              thread, so inserts do not wait for storage.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include "writerThreadFileInterface.h"
+
+#ifdef EMBEDDB_WRITER_THREAD_FILE_INTERFACE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Most pages the thread gives to writePages at once */
+#define WRITER_THREAD_MAX_RUN 64
+
+typedef struct {
+    embedDBFileInterface *baseInterface; /* Interface of the wrapped file */
+    void *baseFile;                      /* File data of the wrapped file */
+    uint32_t pageSize;                   /* Size of a page in bytes */
+    uint32_t numSlots;                   /* Number of pages in the ring */
+    void *pages;                         /* Ring of queued pages */
+    uint32_t *pageNums;                  /* Page number each queued page is written to */
+    uint32_t head;                       /* Slot of the oldest queued page */
+    uint32_t numQueued;                  /* Number of queued pages, including the ones the thread is writing */
+    int8_t error;                        /* Set when a background write fails. Cleared when the file is opened */
+    int8_t running;                      /* 1 if the thread has been started */
+    int8_t stop;                         /* Tells the thread to exit once the ring is empty */
+    pthread_t thread;
+    pthread_mutex_t lock;   /* Protects the ring and flags */
+    pthread_cond_t queued;  /* Signalled when a page is queued or the thread should stop */
+    pthread_cond_t written; /* Signalled when the thread finishes writing pages */
+} WRITER_THREAD_FILE_INFO;
+
+void *setupWriterThreadFile(embedDBFileInterface *baseInterface, void *baseFile, uint32_t pageSize, uint32_t numPages) {
+    WRITER_THREAD_FILE_INFO *fileInfo = malloc(sizeof(WRITER_THREAD_FILE_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    fileInfo->baseInterface = baseInterface;
+    fileInfo->baseFile = baseFile;
+    fileInfo->pageSize = pageSize;
+    fileInfo->numSlots = numPages > 0 ? numPages : 1;
+    /* Aligned to the page size so the pages can be written by files that bypass the operating system cache */
+    fileInfo->pages = embedDBAlignedAlloc(pageSize, (size_t)pageSize * fileInfo->numSlots);
+    fileInfo->pageNums = malloc(fileInfo->numSlots * sizeof(uint32_t));
+    if (fileInfo->pages == NULL || fileInfo->pageNums == NULL) {
+        embedDBAlignedFree(fileInfo->pages);
+        free(fileInfo->pageNums);
+        free(fileInfo);
+        return NULL;
+    }
+    fileInfo->head = 0;
+    fileInfo->numQueued = 0;
+    fileInfo->error = 0;
+    fileInfo->running = 0;
+    fileInfo->stop = 0;
+    pthread_mutex_init(&fileInfo->lock, NULL);
+    pthread_cond_init(&fileInfo->queued, NULL);
+    pthread_cond_init(&fileInfo->written, NULL);
+    return fileInfo;
+}
+
+/**
+ * @brief	Returns the page held in a slot of the ring.
+ */
+static void *writerThreadSlot(WRITER_THREAD_FILE_INFO *fileInfo, uint32_t slot) {
+    return (int8_t *)fileInfo->pages + (size_t)fileInfo->pageSize * slot;
+}
+
+/**
+ * @brief	Writes queued pages until told to stop. Consecutive page numbers are written together if the wrapped
+ * 			interface has writePages. Pages stay in the ring until they are written so reads can still find them.
+ */
+static void *writerThreadRun(void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    embedDBFileInterface *base = fileInfo->baseInterface;
+    void *buffers[WRITER_THREAD_MAX_RUN];
+
+    pthread_mutex_lock(&fileInfo->lock);
+    while (1) {
+        while (fileInfo->numQueued == 0 && !fileInfo->stop)
+            pthread_cond_wait(&fileInfo->queued, &fileInfo->lock);
+        if (fileInfo->numQueued == 0)
+            break;
+
+        /* The caller only adds pages after the queued ones, so this run can be written without the lock */
+        uint32_t head = fileInfo->head;
+        uint32_t firstPageNum = fileInfo->pageNums[head];
+        uint32_t runLength = 1;
+        buffers[0] = writerThreadSlot(fileInfo, head);
+        while (base->writePages != NULL && runLength < fileInfo->numQueued && runLength < WRITER_THREAD_MAX_RUN) {
+            uint32_t slot = (head + runLength) % fileInfo->numSlots;
+            if (fileInfo->pageNums[slot] != firstPageNum + runLength)
+                break;
+            buffers[runLength++] = writerThreadSlot(fileInfo, slot);
+        }
+        pthread_mutex_unlock(&fileInfo->lock);
+
+        int8_t success;
+        if (runLength > 1)
+            success = base->writePages(buffers, firstPageNum, runLength, fileInfo->pageSize, fileInfo->baseFile) == runLength;
+        else
+            success = base->write(buffers[0], firstPageNum, fileInfo->pageSize, fileInfo->baseFile);
+
+        pthread_mutex_lock(&fileInfo->lock);
+        if (!success) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Background write of page %u failed.\n", firstPageNum);
+#endif
+            fileInfo->error = 1;
+        }
+        fileInfo->head = (head + runLength) % fileInfo->numSlots;
+        fileInfo->numQueued -= runLength;
+        pthread_cond_broadcast(&fileInfo->written);
+    }
+    pthread_mutex_unlock(&fileInfo->lock);
+    return NULL;
+}
+
+/**
+ * @brief	Waits until the thread has written every queued page.
+ * @return	1 if every background write since the file was opened succeeded, else 0
+ */
+static int8_t writerThreadDrain(WRITER_THREAD_FILE_INFO *fileInfo) {
+    pthread_mutex_lock(&fileInfo->lock);
+    while (fileInfo->numQueued > 0)
+        pthread_cond_wait(&fileInfo->written, &fileInfo->lock);
+    int8_t success = !fileInfo->error;
+    pthread_mutex_unlock(&fileInfo->lock);
+    return success;
+}
+
+/**
+ * @brief	Copies a queued page into buffer if the page has not been written yet.
+ * 			Must be called with the lock held.
+ * @return	1 if the page was queued, else 0
+ */
+static int8_t writerThreadFindQueued(WRITER_THREAD_FILE_INFO *fileInfo, void *buffer, uint32_t pageNum, uint32_t pageSize) {
+    /* Search newest to oldest in case the page was queued more than once */
+    for (uint32_t i = fileInfo->numQueued; i > 0; i--) {
+        uint32_t slot = (fileInfo->head + i - 1) % fileInfo->numSlots;
+        if (fileInfo->pageNums[slot] == pageNum) {
+            memcpy(buffer, writerThreadSlot(fileInfo, slot), pageSize);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int8_t WRITER_THREAD_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    pthread_mutex_lock(&fileInfo->lock);
+    int8_t found = writerThreadFindQueued(fileInfo, buffer, pageNum, pageSize);
+    pthread_mutex_unlock(&fileInfo->lock);
+    if (found)
+        return 1;
+    /* Only the caller queues pages, so the page cannot become queued before it is read */
+    return fileInfo->baseInterface->read(buffer, pageNum, pageSize, fileInfo->baseFile);
+}
+
+uint32_t WRITER_THREAD_READ_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    embedDBFileInterface *base = fileInfo->baseInterface;
+    uint32_t numRead = 0;
+    while (numRead < numPages) {
+        /* Copy out queued pages, then read the run of pages up to the next queued one from the wrapped file */
+        pthread_mutex_lock(&fileInfo->lock);
+        while (numRead < numPages && writerThreadFindQueued(fileInfo, buffers[numRead], pageNum + numRead, pageSize))
+            numRead++;
+        uint32_t runLength = numPages - numRead;
+        for (uint32_t i = 0; i < fileInfo->numQueued; i++) {
+            uint32_t queuedPageNum = fileInfo->pageNums[(fileInfo->head + i) % fileInfo->numSlots];
+            if (queuedPageNum > pageNum + numRead && queuedPageNum < pageNum + numRead + runLength)
+                runLength = queuedPageNum - pageNum - numRead;
+        }
+        pthread_mutex_unlock(&fileInfo->lock);
+        if (numRead == numPages)
+            break;
+
+        uint32_t result;
+        if (base->readPages != NULL) {
+            result = base->readPages(buffers + numRead, pageNum + numRead, runLength, pageSize, fileInfo->baseFile);
+        } else {
+            for (result = 0; result < runLength; result++) {
+                if (!base->read(buffers[numRead + result], pageNum + numRead + result, pageSize, fileInfo->baseFile))
+                    break;
+            }
+        }
+        numRead += result < runLength ? result : runLength;
+        if (result < runLength)
+            break;
+    }
+    return numRead;
+}
+
+int8_t WRITER_THREAD_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    if (!fileInfo->running || pageSize != fileInfo->pageSize) {
+        if (!writerThreadDrain(fileInfo))
+            return 0;
+        return fileInfo->baseInterface->write(buffer, pageNum, pageSize, fileInfo->baseFile);
+    }
+
+    pthread_mutex_lock(&fileInfo->lock);
+    while (fileInfo->numQueued == fileInfo->numSlots && !fileInfo->error)
+        pthread_cond_wait(&fileInfo->written, &fileInfo->lock);
+    if (fileInfo->error) {
+        pthread_mutex_unlock(&fileInfo->lock);
+        return 0;
+    }
+    uint32_t slot = (fileInfo->head + fileInfo->numQueued) % fileInfo->numSlots;
+    memcpy(writerThreadSlot(fileInfo, slot), buffer, pageSize);
+    fileInfo->pageNums[slot] = pageNum;
+    fileInfo->numQueued++;
+    pthread_cond_signal(&fileInfo->queued);
+    pthread_mutex_unlock(&fileInfo->lock);
+    return 1;
+}
+
+int8_t WRITER_THREAD_FLUSH(void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    int8_t success = writerThreadDrain(fileInfo);
+    return fileInfo->baseInterface->flush(fileInfo->baseFile) && success;
+}
+
+int8_t WRITER_THREAD_SYNC(void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    int8_t success = writerThreadDrain(fileInfo);
+    if (fileInfo->baseInterface->sync == NULL)
+        return fileInfo->baseInterface->flush(fileInfo->baseFile) && success;
+    return fileInfo->baseInterface->sync(fileInfo->baseFile) && success;
+}
+
+int8_t WRITER_THREAD_PREALLOCATE(uint32_t numPages, uint32_t pageSize, void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    if (fileInfo->baseInterface->preallocate == NULL)
+        return 0;
+    return fileInfo->baseInterface->preallocate(numPages, pageSize, fileInfo->baseFile);
+}
+
+int8_t WRITER_THREAD_OPEN(void *file, uint8_t mode) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    if (!fileInfo->baseInterface->open(fileInfo->baseFile, mode))
+        return 0;
+    if (fileInfo->running)
+        return 1;
+
+    fileInfo->head = 0;
+    fileInfo->numQueued = 0;
+    fileInfo->error = 0;
+    fileInfo->stop = 0;
+    if (pthread_create(&fileInfo->thread, NULL, writerThreadRun, fileInfo) == 0) {
+        fileInfo->running = 1;
+    } else {
+#ifdef PRINT_ERRORS
+        printf("WARN: Unable to start writer thread. Pages will be written synchronously.\n");
+#endif
+    }
+    return 1;
+}
+
+int8_t WRITER_THREAD_CLOSE(void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    int8_t success = 1;
+    if (fileInfo->running) {
+        success = writerThreadDrain(fileInfo);
+        pthread_mutex_lock(&fileInfo->lock);
+        fileInfo->stop = 1;
+        pthread_cond_signal(&fileInfo->queued);
+        pthread_mutex_unlock(&fileInfo->lock);
+        pthread_join(fileInfo->thread, NULL);
+        fileInfo->running = 0;
+    }
+    return fileInfo->baseInterface->close(fileInfo->baseFile) && success;
+}
+
+uint32_t WRITER_THREAD_BLOCK_SIZE(void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    if (fileInfo->baseInterface->blockSize == NULL)
+        return 0;
+    return fileInfo->baseInterface->blockSize(fileInfo->baseFile);
+}
+
+void tearDownWriterThreadFile(void *file) {
+    WRITER_THREAD_FILE_INFO *fileInfo = (WRITER_THREAD_FILE_INFO *)file;
+    if (fileInfo->running)
+        WRITER_THREAD_CLOSE(file);
+    pthread_mutex_destroy(&fileInfo->lock);
+    pthread_cond_destroy(&fileInfo->queued);
+    pthread_cond_destroy(&fileInfo->written);
+    embedDBAlignedFree(fileInfo->pages);
+    free(fileInfo->pageNums);
+    free(file);
+}
+
+embedDBFileInterface *getWriterThreadFileInterface() {
+    embedDBFileInterface *fileInterface = calloc(1, sizeof(embedDBFileInterface));
+    fileInterface->close = WRITER_THREAD_CLOSE;
+    fileInterface->read = WRITER_THREAD_READ;
+    fileInterface->write = WRITER_THREAD_WRITE;
+    fileInterface->open = WRITER_THREAD_OPEN;
+    fileInterface->flush = WRITER_THREAD_FLUSH;
+    fileInterface->sync = WRITER_THREAD_SYNC;
+    fileInterface->preallocate = WRITER_THREAD_PREALLOCATE;
+    fileInterface->blockSize = WRITER_THREAD_BLOCK_SIZE;
+    fileInterface->readPages = WRITER_THREAD_READ_PAGES;
+    return fileInterface;
+}
+
+#endif
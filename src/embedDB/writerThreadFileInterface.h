@@ -0,0 +1,89 @@
+/******************************************************************************/
+/**
+ * @file        writerThreadFileInterface.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       File interface for EmbedDB that writes pages on a background thread.
+ *              Pages are copied into a ring of page buffers and written by the
+ *              thread, so inserts do not wait for storage.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#ifndef WRITER_THREAD_FILE_INTERFACE_H_
+#define WRITER_THREAD_FILE_INTERFACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "embedDB.h"
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define EMBEDDB_WRITER_THREAD_FILE_INTERFACE 1
+
+/**
+ * @brief	Returns a file interface that hands page writes to a background thread and returns as soon as the page is
+ * 			copied into the file's ring of page buffers. Reads return queued pages that have not been written yet.
+ * 			flush waits for all queued pages to be written, so embedDBFlush is a barrier for outstanding writes.
+ * 			A failed background write is remembered and reported by the next write, flush or close of the file.
+ * 			Files for this interface must be created with setupWriterThreadFile.
+ */
+embedDBFileInterface *getWriterThreadFileInterface();
+
+/**
+ * @brief	Creates the file data to be given to embedDB for the writer thread file interface. The file wraps a file of
+ * 			another interface, which does the actual reads and writes. The thread writes while embedDB reads, so the
+ * 			wrapped interface must allow a read and a write of the file at the same time. The POSIX interface does. The
+ * 			FILE * interface from getFileInterface does not, since its reads and writes share one file position and
+ * 			would corrupt pages.
+ * @param	baseInterface	File interface of the wrapped file. Only its read, write, open, close and flush are required.
+ * 							Its read and write must be safe to call at the same time
+ * @param	baseFile		File data of the wrapped file (e.g. from setupPosixFile)
+ * @param	pageSize		Size of a page in bytes. Must match embedDBState->pageSize
+ * @param	numPages		Number of pages that can be queued before a write has to wait for the thread
+ * @return	Pointer to the file data, or NULL if memory could not be allocated
+ */
+void *setupWriterThreadFile(embedDBFileInterface *baseInterface, void *baseFile, uint32_t pageSize, uint32_t numPages);
+
+/**
+ * @brief	Closes the file if it is open and frees the file data created by setupWriterThreadFile.
+ * 			The wrapped file is not freed.
+ * @param	file	File data created by setupWriterThreadFile
+ */
+void tearDownWriterThreadFile(void *file);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -73,12 +73,13 @@ void radixsplineRebuild(radixspline *rsidx, int8_t radixSize, int8_t shiftAmount
     // radixsplinePrint(rsidx);
     rsidx->prevPrefix = rsidx->prevPrefix >> shiftAmount;
 
+    /* Table entries are point indexes, not keys, so they are sizeof(id_t) apart whatever the key size */
     for (id_t i = 0; i < rsidx->size / pow(2, shiftAmount); i++) {
-        memcpy((int8_t *)rsidx->table + i * rsidx->keySize, (int8_t *)rsidx->table + (i << shiftAmount) * rsidx->keySize, rsidx->keySize);
+        memcpy(rsidx->table + i, rsidx->table + (i << shiftAmount), sizeof(id_t));
     }
     uint64_t maxKey = UINT64_MAX;
     for (id_t i = rsidx->size / pow(2, shiftAmount); i < rsidx->size; i++) {
-        memcpy((int8_t *)rsidx->table + i * rsidx->keySize, &maxKey, rsidx->keySize);
+        memcpy(rsidx->table + i, &maxKey, sizeof(id_t));
     }
 }
 
@@ -169,6 +170,7 @@ void radixsplineInit(radixspline *rsidx, spline *spl, int8_t radixSize, uint8_t
     rsidx->keySize = keySize;
     rsidx->shiftSize = 0;
     rsidx->size = pow(2, radixSize);
+    rsidx->table = NULL;
 
     /* Determine the prefix size (shift bits) based on min and max keys */
     rsidx->minKey = spl->points;
@@ -178,40 +180,6 @@ void radixsplineInit(radixspline *rsidx, spline *spl, int8_t radixSize, uint8_t
     rsidx->prevPrefix = 0;
 }
 
-/**
- * @brief	Performs a recursive binary search on the spine points for a key
- * @param	rsidx		Array to search through
- * @param	low		    Lower search bound (Index of spline point)
- * @param	high	    Higher search bound (Index of spline point)
- * @param	key		    Key to search for
- * @param	compareKey	Function to compare keys
- * @return	Index of spline point that is the upper end of the spline segment that contains the key
- */
-size_t radixBinarySearch(radixspline *rsidx, int low, int high, void *key, int8_t compareKey(void *, void *)) {
-    void *arr = rsidx->spl->points;
-
-    int32_t mid;
-    if (high >= low) {
-        mid = low + (high - low) / 2;
-        void *midKey = splinePointLocation(rsidx->spl, mid);
-        void *midKeyMinusOne = splinePointLocation(rsidx->spl, mid - 1);
-        if (compareKey(midKey, key) >= 0 && compareKey(midKeyMinusOne, key) <= 0)
-            return mid;
-
-        if (compareKey(midKey, key) > 0)
-            return radixBinarySearch(rsidx, low, mid - 1, key, compareKey);
-
-        return radixBinarySearch(rsidx, mid + 1, high, key, compareKey);
-    }
-
-    mid = low + (high - low) / 2;
-    if (mid >= high) {
-        return high;
-    } else {
-        return low;
-    }
-}
-
 /**
  * @brief	Initialize and build a radix spline index of given size using pre-built spline structure.
  * @param	rsdix		Radix spline structure
@@ -230,7 +198,7 @@ void radixsplineInitBuild(radixspline *rsidx, spline *spl, uint32_t radixSize, v
  * @brief	Returns the radix index that is end of spline segment containing key using radix table.
  * @param	rsidx	    Radix spline structure
  * @param	key		    Search key
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys. Not used by the search, which compares keys as unsigned numbers
  * @return	Index of spline point that is the upper end of the spline segment that contains the key
  */
 size_t radixsplineGetEntry(radixspline *rsidx, void *key, int8_t compareKey(void *, void *)) {
@@ -267,18 +235,22 @@ size_t radixsplineGetEntry(radixspline *rsidx, void *key, int8_t compareKey(void
         memcpy(&begin, rsidx->table + (prefix - 1), sizeof(id_t));
     }
 
-    return radixBinarySearch(rsidx, begin, end, key, compareKey);
+    // After a rebuild an entry can be the point after the start of its segment, so search from the point before it
+    if (begin > 0)
+        begin--;
+
+    return pointsBinarySearch(rsidx->spl, begin, end, key);
 }
 
 /**
  * @brief	Returns the radix index that is end of spline segment containing key using binary search.
  * @param	rsidx	    Radix spline structure
  * @param	key		    Search key
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys. Not used by the search, which compares keys as unsigned numbers
  * @return  Index of spline point that is the upper end of the spline segment that contains the key
  */
 size_t radixsplineGetEntryBinarySearch(radixspline *rsidx, void *key, int8_t compareKey(void *, void *)) {
-    return radixBinarySearch(rsidx, 0, rsidx->spl->count - 1, key, compareKey);
+    return pointsBinarySearch(rsidx->spl, 0, rsidx->spl->count - 1, key);
 }
 
 /**
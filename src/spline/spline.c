@@ -278,42 +278,77 @@ uint32_t splineSize(spline *spl) {
 }
 
 /**
- * @brief	Performs a recursive binary search on the spine points for a key
- * @param	arr			Array of spline points to search through
- * @param	low		    Lower search bound (Index of spline point)
- * @param	high	    Higher search bound (Index of spline point)
- * @param	key		    Key to search for
- * @param	compareKey	Function to compare keys
- * @return	Index of spline point that is the upper end of the spline segment that contains the key
+ * @brief	Returns the key of a spline point as an unsigned number. Keys of 4 and 8 bytes are copied with a fixed size so
+ * 			the copy is inlined.
  */
-size_t pointsBinarySearch(spline *spl, int low, int high, void *key, int8_t compareKey(void *, void *)) {
-    int32_t mid;
-    if (high >= low) {
-        mid = low + (high - low) / 2;
-
-        // If mid is zero, then low = 0 and high = 1. Therefore there is only one spline segment and we return 1, the upper bound.
-        if (mid == 0) {
-            return 1;
-        }
-
-        void *midSplinePoint = splinePointLocation(spl, mid);
-        void *midSplineMinusOnePoint = splinePointLocation(spl, mid - 1);
-
-        if (compareKey(midSplinePoint, key) >= 0 && compareKey(midSplineMinusOnePoint, key) <= 0)
-            return mid;
-
-        if (compareKey(midSplinePoint, key) > 0)
-            return pointsBinarySearch(spl, low, mid - 1, key, compareKey);
-
-        return pointsBinarySearch(spl, mid + 1, high, key, compareKey);
+static inline uint64_t splinePointKey(spline *spl, int8_t *point) {
+    if (spl->keySize == sizeof(uint32_t)) {
+        uint32_t key;
+        memcpy(&key, point, sizeof(uint32_t));
+        return key;
     }
+    uint64_t key = 0;
+    if (spl->keySize == sizeof(uint64_t))
+        memcpy(&key, point, sizeof(uint64_t));
+    else
+        memcpy(&key, point, spl->keySize);
+    return key;
+}
 
-    mid = low + (high - low) / 2;
-    if (mid >= high) {
+/**
+ * @brief	Returns the first point in [low, high) with a key greater than or equal to key, or high if there is none.
+ * 			The points must be next to each other in the points array, so each probe is an offset from the first point
+ * 			rather than a modulo into the circular array. The loop has no branch on the comparison, so it runs the same
+ * 			number of iterations for every key and the compiler can use a conditional move.
+ */
+static size_t pointsLowerBound(spline *spl, size_t low, size_t high, uint64_t key) {
+    size_t pointSize = spl->keySize + sizeof(uint32_t);
+    int8_t *first = (int8_t *)splinePointLocation(spl, low);
+    size_t base = 0, n = high - low;
+    if (n == 0)
         return high;
+    while (n > 1) {
+        size_t half = n / 2;
+        base = splinePointKey(spl, first + (base + half - 1) * pointSize) < key ? base + half : base;
+        n -= half;
+    }
+    return low + base + (splinePointKey(spl, first + base * pointSize) < key);
+}
+
+/**
+ * @brief	Searches the spline points for the segment holding a key. Points are compared as unsigned numbers, which is
+ * 			how splineAdd orders them. The points are a circular array, so a range that wraps around its end is split
+ * 			into the two runs on either side of the wrap, using the key of the point at the start of the array.
+ * @param	spl		Spline structure
+ * @param	low		Lower search bound (Index of spline point)
+ * @param	high	Higher search bound (Index of spline point)
+ * @param	key		Key to search for
+ * @return	Index of spline point that is the upper end of the spline segment that contains the key
+ */
+size_t pointsBinarySearch(spline *spl, size_t low, size_t high, void *key) {
+    uint64_t keyVal = 0;
+    memcpy(&keyVal, key, spl->keySize);
+
+    if (low > high)
+        low = high;
+    size_t end = high + 1;
+    size_t wrap = spl->size - spl->pointsStartIndex;
+    size_t index;
+    if (low < wrap && wrap < end) {
+        if (splinePointKey(spl, (int8_t *)spl->points) < keyVal)
+            index = pointsLowerBound(spl, wrap, end, keyVal);
+        else
+            index = pointsLowerBound(spl, low, wrap, keyVal);
     } else {
-        return low;
+        index = pointsLowerBound(spl, low, end, keyVal);
     }
+
+    /* The key is above the last point searched, or below the first point, which is the lower end of the first segment */
+    if (index > high)
+        index = high;
+    if (index == 0 && high > 0)
+        index = 1;
+    return index;
 }
 
 /**
@@ -352,7 +387,7 @@ void splineFind(spline *spl, void *key, int8_t compareKey(void *, void *), id_t
         return;
     } else {
         // Perform a binary seach to find the spline point above the key we're looking for
-        pointIdx = pointsBinarySearch(spl, 0, spl->count - 1, key, compareKey);
+        pointIdx = pointsBinarySearch(spl, 0, spl->count - 1, key);
     }
 
     // Interpolate between two spline points
@@ -118,6 +118,16 @@ uint32_t splineSize(spline *spl);
  */
 void splineFind(spline *spl, void *key, int8_t compareKey(void *, void *), id_t *loc, id_t *low, id_t *high);
 
+/**
+ * @brief	Searches the spline points for the segment holding a key, comparing keys as unsigned numbers.
+ * @param	spl		Spline structure
+ * @param	low		Lower search bound (Index of spline point)
+ * @param	high	Higher search bound (Index of spline point)
+ * @param	key		Key to search for
+ * @return	Index of spline point that is the upper end of the spline segment that contains the key
+ */
+size_t pointsBinarySearch(spline *spl, size_t low, size_t high, void *key);
+
 /**
  * @brief    Free memory allocated for spline structure.
  * @param    spl        Spline structure
@@ -0,0 +1,245 @@
+/******************************************************************************/
+/**
+ * @file        Test_buffer_pool.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test the EmbedDB buffer pool of recently read pages.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_REQUIRED_PAGES 6
+
+embedDBState *state;
+
+int8_t createState(uint32_t numDataPages, int8_t numPoolPages, char *indexPath) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = NUM_REQUIRED_PAGES + numPoolPages;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = numDataPages;
+    state->numIndexPages = 48;
+    state->numVarPages = 1000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/dataFile.bin", varPath[] = "build/artifacts/varFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->varFile = setupFile(varPath);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    return embedDBInit(state, 1);
+}
+
+void initializeState(uint32_t numDataPages, int8_t numPoolPages) {
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    int8_t result = createState(numDataPages, numPoolPages, indexPath);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(1000, 8);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    tearDownFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t numRecords) {
+    char varData[] = "Record 00";
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        varData[7] = '0' + data / 10;
+        varData[8] = '0' + data % 10;
+        int8_t result = embedDBPutVar(state, &key, &data, varData, sizeof(varData));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+    embedDBFlush(state);
+}
+
+void getRecord(uint32_t key) {
+    uint32_t data = 0;
+    embedDBVarDataStream *varStream = NULL;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &data, &varStream), "embedDBGetVar did not find an inserted record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGetVar returned the wrong data.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "embedDBGetVar did not return vardata");
+    free(varStream);
+}
+
+id_t readPageId(void *page) {
+    id_t pageId;
+    memcpy(&pageId, page, sizeof(id_t));
+    return pageId;
+}
+
+void buffer_pool_uses_spare_buffer_pages(void) {
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(8, state->numPoolFrames, "Spare buffer pages were not used as a buffer pool.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numWindowPages, "The file interface cannot read several pages at once, so there should be no read window.");
+}
+
+void buffer_pool_serves_repeated_lookups_of_data_and_var_pages(void) {
+    insertRecords(3000);
+    getRecord(123);
+    getRecord(2500);
+    embedDBResetStats(state);
+
+    /* Each lookup alternates between a data page and a var page */
+    for (uint8_t i = 0; i < 5; i++) {
+        getRecord(123);
+        getRecord(2500);
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->bufferMisses, "Repeated lookups should not read from storage.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numReads, "Repeated lookups should not read from storage.");
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, state->bufferHits, "Repeated lookups were not counted as buffer hits.");
+}
+
+void buffer_pool_replaces_pages_not_used_recently(void) {
+    insertRecords(state->maxRecordsPerPage * 12);
+    for (id_t pageNum = 0; pageNum < 8; pageNum++)
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, pageNum), "Failed to read data page.");
+    /* Using page 0 again keeps it while the clock replaces pages 1 and 2 */
+    readPage(state, 0);
+    readPage(state, 8);
+    readPage(state, 9);
+
+    embedDBResetStats(state);
+    readPage(state, 0);
+    readPage(state, 5);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->bufferMisses, "Recently used pages should still be in the buffer pool.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, state->bufferHits, "Pages in the buffer pool were not counted as hits.");
+    readPage(state, 1);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->bufferMisses, "The least recently used page should have been replaced.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, readPageId(state->dataReadPage), "Read the wrong data page.");
+}
+
+void buffer_pool_does_not_replace_current_read_pages(void) {
+    tearDown();
+    initializeState(1000, 3);
+    insertRecords(3000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, 0), "Failed to read data page.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readIndexPage(state, 0), "Failed to read index page.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readVariablePage(state, 0), "Failed to read var page.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readVariablePage(state, 1), "Failed to read var page when every frame is pinned.");
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, readPageId(state->dataReadPage), "The current data page was replaced.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, readPageId(state->indexReadPage), "The current index page was replaced.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, readPageId(state->varReadPage), "Read the wrong var page.");
+    void *varReadBuffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    TEST_ASSERT_TRUE_MESSAGE(state->varReadPage == varReadBuffer, "A page should be read into its read buffer when every frame is pinned.");
+}
+
+void buffer_pool_forgets_pages_that_are_overwritten(void) {
+    tearDown();
+    initializeState(16, 8);
+    insertRecords(state->maxRecordsPerPage * 12);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, 0), "Failed to read data page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, readPageId(state->dataReadPage), "Read the wrong data page.");
+    readPage(state, 1);
+
+    /* Wrap around the data file so page 0 is overwritten */
+    uint32_t key = state->maxRecordsPerPage * 12, data = 0;
+    for (uint32_t i = 0; i < state->maxRecordsPerPage * 8; i++, key++)
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut failed.");
+    embedDBFlush(state);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, 0), "Failed to read data page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(16, readPageId(state->dataReadPage), "The buffer pool returned a page that was overwritten.");
+}
+
+void buffer_pool_is_freed_when_init_fails(void) {
+    tearDown();
+    /* The pool is set up before the files, so init fails after it when the index file cannot be created */
+    char indexPath[] = "build/artifacts/missingDirectory/indexFile.bin";
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, createState(1000, 8, indexPath), "embedDBInit should fail when the index file cannot be created.");
+    TEST_ASSERT_NULL_MESSAGE(state->poolFrames, "The buffer pool was not freed when embedDBInit failed.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numPoolFrames, "The buffer pool was not freed when embedDBInit failed.");
+
+    /* Only the data file was opened */
+    state->fileInterface->close(state->dataFile);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    tearDownFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+    initializeState(1000, 8);
+}
+
+void buffer_pool_size_can_be_set_beyond_the_buffer(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetBufferPoolSize(state, 300), "Failed to set the buffer pool size.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(300, state->numPoolFrames, "The buffer pool has the wrong number of pages.");
+    insertRecords(state->maxRecordsPerPage * 280);
+    TEST_ASSERT_TRUE_MESSAGE(state->nextDataPageId >= 280, "Expected more data pages than an 8-bit frame number can hold.");
+
+    for (id_t pageNum = 0; pageNum < state->nextDataPageId; pageNum++)
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, pageNum), "Failed to read data page.");
+    embedDBResetStats(state);
+    for (id_t pageNum = 0; pageNum < state->nextDataPageId; pageNum++)
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, pageNum), "Failed to read data page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->bufferMisses, "Every data page should still be in the buffer pool.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->nextDataPageId, readPageId(state->dataReadPage) + 1, "Read the wrong data page.");
+
+    /* 0 goes back to the spare buffer pages */
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetBufferPoolSize(state, 0), "Failed to reset the buffer pool size.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(8, state->numPoolFrames, "The buffer pool should use the spare buffer pages again.");
+    TEST_ASSERT_NULL_MESSAGE(state->poolAllocation, "The allocated pool pages were not freed.");
+    getRecord(123);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(buffer_pool_uses_spare_buffer_pages);
+    RUN_TEST(buffer_pool_serves_repeated_lookups_of_data_and_var_pages);
+    RUN_TEST(buffer_pool_replaces_pages_not_used_recently);
+    RUN_TEST(buffer_pool_does_not_replace_current_read_pages);
+    RUN_TEST(buffer_pool_forgets_pages_that_are_overwritten);
+    RUN_TEST(buffer_pool_is_freed_when_init_fails);
+    RUN_TEST(buffer_pool_size_can_be_set_beyond_the_buffer);
+    return UNITY_END();
+}
@@ -0,0 +1,228 @@
+/******************************************************************************/
+/**
+ * @file        Test_container_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB insertion, querying, and recovery with all files stored in one container file.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/containerFileInterface.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+embedDBFileInterface *baseInterface;
+void *baseFile;
+void *container;
+uint32_t numBaseSyncs;
+
+int8_t COUNTING_SYNC(void *file) {
+    numBaseSyncs++;
+    return 1;
+}
+
+int8_t initializeState(int8_t parameters, uint32_t numDataPages) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = numDataPages;
+    state->numIndexPages = 48;
+    state->numVarPages = 1000;
+    state->eraseSizeInPages = 4;
+
+    baseInterface = getFileInterface();
+    baseInterface->sync = COUNTING_SYNC;
+    char containerPath[] = "build/artifacts/containerFile.bin";
+    baseFile = setupFile(containerPath);
+    container = setupContainerFile(baseInterface, baseFile, state->pageSize, state->numDataPages, state->numIndexPages, state->numVarPages, state->eraseSizeInPages);
+    TEST_ASSERT_NOT_NULL_MESSAGE(container, "Unable to allocate the container file.");
+    state->fileInterface = getContainerFileInterface();
+    state->dataFile = getContainerRegion(container, EMBEDDB_DATA_FILE);
+    state->indexFile = getContainerRegion(container, EMBEDDB_INDEX_FILE);
+    state->varFile = getContainerRegion(container, EMBEDDB_VAR_FILE);
+
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    numBaseSyncs = 0;
+    return embedDBInit(state, 1);
+}
+
+void setUp(void) {
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 1000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the container file interface.");
+}
+
+void freeState(void) {
+    tearDownContainerFile(container);
+    tearDownFile(baseFile);
+    free(baseInterface);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    freeState();
+}
+
+void insertRecords(uint32_t numRecords) {
+    char varData[] = "Record 00";
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        varData[7] = '0' + data / 10;
+        varData[8] = '0' + data % 10;
+        int8_t result = embedDBPutVar(state, &key, &data, varData, sizeof(varData));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void checkRecord(uint32_t key) {
+    uint32_t data = 0;
+    embedDBVarDataStream *varStream = NULL;
+    char buf[16];
+    char expected[] = "Record 00";
+    expected[7] = '0' + key % 100 / 10;
+    expected[8] = '0' + key % 10;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &data, &varStream), "embedDBGetVar did not find an inserted record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGetVar returned the wrong data.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "embedDBGetVar did not return vardata");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(sizeof(expected), embedDBVarDataStreamRead(state, varStream, buf, sizeof(buf)), "Returned vardata was not the right length");
+    TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(expected, buf, sizeof(expected), "embedDBGetVar returned the wrong vardata.");
+    free(varStream);
+}
+
+void container_get_and_iterator_return_inserted_records(void) {
+    insertRecords(5000);
+    embedDBFlush(state);
+    for (uint32_t key = 0; key < 5000; key += 7)
+        checkRecord(key);
+
+    embedDBIterator it;
+    uint32_t minData = 23, maxData = 38;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t key, data, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(50 * 16, numRecordsRead, "Iterator did not read the correct number of records");
+}
+
+void container_recovers_every_region_after_reopen(void) {
+    insertRecords(state->maxRecordsPerPage * 600);
+    embedDBFlush(state);
+    uint32_t expectedNextDataPage = state->nextDataPageId;
+    uint32_t expectedNextIndexPage = state->nextIdxPageId;
+    uint32_t expectedNextVarPage = state->nextVarPageId;
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, expectedNextIndexPage, "Test should write an index page.");
+    tearDown();
+
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA, 1000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not recover from the container file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextDataPage, state->nextDataPageId, "nextDataPageId was not recovered from the container file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextIndexPage, state->nextIdxPageId, "nextIdxPageId was not recovered from the container file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextVarPage, state->nextVarPageId, "nextVarPageId was not recovered from the container file.");
+    /* The oldest variable data has been overwritten, so only check recent records */
+    for (uint32_t key = state->maxRecordsPerPage * 600 - 1; key > state->maxRecordsPerPage * 500; key -= 97)
+        checkRecord(key);
+}
+
+void container_commit_syncs_the_file_once(void) {
+    insertRecords(state->maxRecordsPerPage * 600);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(EMBEDDB_DATA_FILE | EMBEDDB_INDEX_FILE | EMBEDDB_VAR_FILE, state->unsyncedFiles, "Test should write to every region.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCommit(state), "embedDBCommit failed.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, numBaseSyncs, "Committing every region should sync the container file once.");
+}
+
+void container_regions_do_not_overlap(void) {
+    uint8_t page[512];
+    void *region[3] = {state->dataFile, state->indexFile, state->varFile};
+    uint32_t lastPage[3] = {state->numDataPages - 1, state->numIndexPages - 1, state->numVarPages - 1};
+    for (uint8_t i = 0; i < 3; i++) {
+        memset(page, i + 1, sizeof(page));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->write(page, 0, sizeof(page), region[i]), "Writing the first page of a region failed.");
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->write(page, lastPage[i], sizeof(page), region[i]), "Writing the last page of a region failed.");
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->fileInterface->write(page, lastPage[i] + 1, sizeof(page), region[i]), "Writing past the end of a region should fail.");
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->read(page, 0, sizeof(page), region[i]), "Reading the first page of a region failed.");
+        TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(i + 1, page, sizeof(page), "The first page of a region was overwritten by another region.");
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->read(page, lastPage[i], sizeof(page), region[i]), "Reading the last page of a region failed.");
+        TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(i + 1, page, sizeof(page), "The last page of a region was overwritten by another region.");
+        /* Never written, but before the end of the file */
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->fileInterface->read(page, 1, sizeof(page), region[i]), "Reading a page that was never written should fail.");
+    }
+}
+
+void container_with_a_different_layout_is_not_overwritten(void) {
+    insertRecords(3000);
+    embedDBFlush(state);
+    uint32_t expectedNextDataPage = state->nextDataPageId;
+    tearDown();
+
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA, 500);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, result, "EmbedDB should not open a container with a different layout.");
+    freeState();
+
+    result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA, 1000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not recover from the container file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextDataPage, state->nextDataPageId, "The container file was overwritten.");
+    checkRecord(1234);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(container_get_and_iterator_return_inserted_records);
+    RUN_TEST(container_recovers_every_region_after_reopen);
+    RUN_TEST(container_commit_syncs_the_file_once);
+    RUN_TEST(container_regions_do_not_overlap);
+    RUN_TEST(container_with_a_different_layout_is_not_overwritten);
+    return UNITY_END();
+}
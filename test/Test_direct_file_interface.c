@@ -0,0 +1,166 @@
+/******************************************************************************/
+/**
+ * @file        Test_direct_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB with files that bypass the page cache (O_DIRECT) and aligned buffers.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/posixFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+
+/* Creates the state without initializing it so tests can change the page size and buffer first */
+void createState(uint32_t pageSize, int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = pageSize;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = embedDBAlignedAlloc(4096, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    memset(state->buffer, 0, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getPosixFileInterface();
+    char dataPath[] = "build/artifacts/directDataFile.bin", indexPath[] = "build/artifacts/directIndexFile.bin";
+    state->dataFile = setupDirectFile(dataPath, EMBEDDB_FILE_ROLE_DATA);
+    state->indexFile = setupDirectFile(indexPath, EMBEDDB_FILE_ROLE_INDEX);
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+}
+
+void destroyState(void) {
+    tearDownPosixFile(state->dataFile);
+    tearDownPosixFile(state->indexFile);
+    embedDBAlignedFree(state->buffer);
+    free(state->fileInterface);
+    free(state);
+    state = NULL;
+}
+
+/* Returns the block size direct I/O needs for files in the artifacts folder, or 0 if the file system does not support it */
+uint32_t directBlockSize(void) {
+    char path[] = "build/artifacts/directProbeFile.bin";
+    void *file = setupDirectFile(path, EMBEDDB_FILE_ROLE_DATA);
+    embedDBFileInterface *fileInterface = getPosixFileInterface();
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->open(file, EMBEDDB_FILE_MODE_W_PLUS_B), "Unable to open direct file.");
+    uint32_t blockSize = fileInterface->blockSize(file);
+    fileInterface->close(file);
+    tearDownPosixFile(file);
+    free(fileInterface);
+    return blockSize;
+}
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL) {
+        embedDBClose(state);
+        destroyState();
+    }
+}
+
+void aligned_alloc_returns_aligned_memory(void) {
+    for (size_t alignment = 8; alignment <= 8192; alignment *= 2) {
+        void *buffer = embedDBAlignedAlloc(alignment, 1000);
+        TEST_ASSERT_NOT_NULL_MESSAGE(buffer, "embedDBAlignedAlloc failed to allocate memory.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, (uintptr_t)buffer % alignment, "embedDBAlignedAlloc returned unaligned memory.");
+        memset(buffer, 1, 1000);
+        embedDBAlignedFree(buffer);
+    }
+}
+
+void direct_init_rejects_page_size_that_is_not_a_multiple_of_block_size(void) {
+    uint32_t blockSize = directBlockSize();
+    if (blockSize <= 1)
+        return;
+    createState(blockSize / 2, EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, embedDBInit(state, 1), "embedDBInit accepted a page size that is smaller than the block size.");
+    destroyState();
+}
+
+void direct_init_rejects_unaligned_buffer(void) {
+    uint32_t blockSize = directBlockSize();
+    if (blockSize <= 1)
+        return;
+    createState(4096, EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    void *alignedBuffer = state->buffer;
+    state->buffer = (int8_t *)alignedBuffer + 8;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, embedDBInit(state, 1), "embedDBInit accepted a buffer that is not aligned to the block size.");
+    state->buffer = alignedBuffer;
+    destroyState();
+}
+
+void direct_interface_inserts_queries_and_recovers(void) {
+    createState(4096, EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBInit(state, 1), "EmbedDB did not initialize correctly with direct files.");
+    for (uint32_t key = 0; key < 10000; key++) {
+        uint32_t data = key % 100;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+    embedDBFlush(state);
+    uint32_t expectedNextPage = state->nextDataPageId;
+    embedDBClose(state);
+    destroyState();
+
+    createState(4096, EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBInit(state, 1), "EmbedDB did not recover from direct files.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered from the data file.");
+    uint32_t data = 0;
+    for (uint32_t key = 0; key < 10000; key += 13) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a recovered record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data after recovery.");
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(aligned_alloc_returns_aligned_memory);
+    RUN_TEST(direct_init_rejects_page_size_that_is_not_a_multiple_of_block_size);
+    RUN_TEST(direct_init_rejects_unaligned_buffer);
+    RUN_TEST(direct_interface_inserts_queries_and_recovers);
+    return UNITY_END();
+}
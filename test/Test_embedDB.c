@@ -71,7 +71,7 @@ void embedDB_initial_configuration_is_correct() {
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(UINT32_MAX, state->bufferedIndexPageId, "EmbedDB bufferedIndexPageId was not initialized correctly.");
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(UINT32_MAX, state->bufferedVarPage, "EmbedDB bufferedVarPage was not initialized correctly.");
     TEST_ASSERT_EQUAL_UINT16_MESSAGE(63, state->maxRecordsPerPage, "EmbedDB maxRecordsPerPage was not initialized correctly.");
-    TEST_ASSERT_EQUAL_INT32_MESSAGE(63, state->maxError, "EmbedDB maxError was not initialized correctly.");
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(0, state->maxError, "EmbedDB maxError was not initialized correctly.");
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(1000, state->numDataPages, "EmbedDB numDataPages was not initialized correctly.");
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->minDataPageId, "EmbedDB minDataPageId was not initialized correctly.");
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->avgKeyDiff, "EmbedDB avgKeyDiff was not initialized correctly.");
@@ -150,6 +150,35 @@ void embedDB_put_inserts_one_more_than_one_page_of_records_correctly() {
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, EMBEDDB_GET_COUNT(state->buffer), "embedDBPut did not reset buffer count to correct value after writing the page");
 }
 
+void embedDB_get_finds_every_record_in_write_buffer(void) {
+    uint32_t key = 100;
+    int32_t data = 0;
+    for (int32_t i = 0; i < 10; i++, key += 5) {
+        int8_t result = embedDBPut(state, &key, &i);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->nextDataPageId, "Records should still be in the write buffer.");
+    key = 100;
+    for (int32_t i = 0; i < 10; i++, key += 5) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record in the write buffer.");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(i, data, "embedDBGet returned the wrong data.");
+    }
+    key = 101;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, embedDBGet(state, &key, &data), "embedDBGet found a key that was not inserted.");
+
+    /* Once a page is written the write buffer is searched for keys after it */
+    for (int32_t i = 10; i < 70; i++) {
+        key = 100 + 5 * i;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &i), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->nextDataPageId, "The first page should have been written.");
+    for (int32_t i = 63; i < 70; i++) {
+        key = 100 + 5 * i;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record in the write buffer.");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(i, data, "embedDBGet returned the wrong data.");
+    }
+}
+
 void iteratorReturnsCorrectRecords(void) {
     int32_t numRecordsToInsert = 1000;
     for (uint32_t key = 0; key < numRecordsToInsert; key++) {
@@ -205,6 +234,7 @@ int main(void) {
     RUN_TEST(embedDB_put_inserts_eleven_records_correctly);
     RUN_TEST(embedDB_put_inserts_one_page_of_records_correctly);
     RUN_TEST(embedDB_put_inserts_one_more_than_one_page_of_records_correctly);
+    RUN_TEST(embedDB_get_finds_every_record_in_write_buffer);
     RUN_TEST(iteratorReturnsCorrectRecords);
     return UNITY_END();
 }
@@ -0,0 +1,175 @@
+/******************************************************************************/
+/**
+ * @file        Test_posix_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test the EmbedDB durability policy and group commits.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+
+/* Files in the order they were synced */
+void *syncedFiles[64];
+uint32_t numSyncedFiles;
+uint32_t fakeTime;
+
+int8_t RECORDING_SYNC(void *file) {
+    if (numSyncedFiles < 64)
+        syncedFiles[numSyncedFiles] = file;
+    numSyncedFiles++;
+    return 1;
+}
+
+uint32_t fakeClock(void) {
+    return fakeTime;
+}
+
+void setUp(void) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    state->fileInterface->sync = RECORDING_SYNC;
+    char dataPath[] = "build/artifacts/durabilityDataFile.bin", indexPath[] = "build/artifacts/durabilityIndexFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+    numSyncedFiles = 0;
+    fakeTime = 0;
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t firstKey, uint32_t numRecords) {
+    for (uint32_t key = firstKey; key < firstKey + numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void durability_default_policy_only_syncs_on_commit(void) {
+    /* Enough records to write data pages and an index page */
+    insertRecords(0, state->maxRecordsPerPage * 600);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numSyncedFiles, "Files were synced without a durability policy.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCommit(state), "embedDBCommit failed.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, numSyncedFiles, "Each written file should be synced once per commit.");
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(state->dataFile, syncedFiles[0], "The data file should be synced first.");
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(state->indexFile, syncedFiles[1], "The index file should be synced after the data file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->numSyncs, "Commit was not counted.");
+}
+
+void durability_commit_without_writes_does_not_sync(void) {
+    insertRecords(0, 10);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCommit(state), "embedDBCommit failed.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numSyncedFiles, "Commit synced files that had no writes.");
+
+    /* The flush writes a data page and an index page */
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCommit(state), "embedDBCommit failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCommit(state), "embedDBCommit failed.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, numSyncedFiles, "Files were synced more than once for the same writes.");
+}
+
+void durability_syncs_every_n_pages(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetDurability(state, 10, 0, NULL), "embedDBSetDurability failed.");
+    /* 100 full data pages. The next insert writes the 100th page */
+    insertRecords(0, state->maxRecordsPerPage * 100 + 1);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(10, state->numSyncs, "Did not commit once every 10 pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(10, numSyncedFiles, "Only the data file has been written, so it should be the only file synced.");
+}
+
+void durability_syncs_after_interval(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetDurability(state, 0, 1000, fakeClock), "embedDBSetDurability failed.");
+    uint32_t key = 0;
+    insertRecords(key, state->maxRecordsPerPage * 5);
+    key += state->maxRecordsPerPage * 5;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numSyncs, "Committed before the interval passed.");
+
+    fakeTime = 999;
+    insertRecords(key, state->maxRecordsPerPage);
+    key += state->maxRecordsPerPage;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numSyncs, "Committed before the interval passed.");
+
+    /* Commits when the next page is written, not as soon as the time passes */
+    fakeTime = 1000;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numSyncs, "Committed without writing a page.");
+    insertRecords(key, state->maxRecordsPerPage);
+    key += state->maxRecordsPerPage;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->numSyncs, "Did not commit after the interval passed.");
+
+    insertRecords(key, state->maxRecordsPerPage);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->numSyncs, "Interval should restart after a commit.");
+}
+
+void durability_interval_requires_clock(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, embedDBSetDurability(state, 0, 1000, NULL), "A timed policy without a clock should be rejected.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->syncIntervalMs, "Rejected policy was applied.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(durability_default_policy_only_syncs_on_commit);
+    RUN_TEST(durability_commit_without_writes_does_not_sync);
+    RUN_TEST(durability_syncs_every_n_pages);
+    RUN_TEST(durability_syncs_after_interval);
+    RUN_TEST(durability_interval_requires_clock);
+    return UNITY_END();
+}
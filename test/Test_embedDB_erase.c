@@ -0,0 +1,226 @@
+/******************************************************************************/
+/**
+ * @file        Test_embedDB_erase.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test preallocation, erasing reclaimed pages and recovering files that contain erased pages.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/posixFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+char dataPath[] = "build/artifacts/eraseDataFile.bin";
+char indexPath[] = "build/artifacts/eraseIndexFile.bin";
+char varPath[] = "build/artifacts/eraseVarFile.bin";
+
+void initializeState(int8_t parameters, uint32_t numIndexPages) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = numIndexPages;
+    state->numVarPages = 64;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getPosixFileInterface();
+    state->fileInterface->erase = POSIX_ERASE;
+    state->dataFile = setupPosixFile(dataPath, EMBEDDB_FILE_ROLE_DATA);
+    state->indexFile = setupPosixFile(indexPath, EMBEDDB_FILE_ROLE_INDEX);
+    state->varFile = setupPosixFile(varPath, EMBEDDB_FILE_ROLE_VAR);
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 48);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownPosixFile(state->dataFile);
+    tearDownPosixFile(state->indexFile);
+    tearDownPosixFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t numRecords, uint32_t varLength) {
+    char varData[] = "Variable data 0123456789";
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPutVar(state, &key, &data, varLength > 0 ? varData : NULL, varLength);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+}
+
+/* Erases a block of a closed file, as if embedDB stopped after erasing it and before writing its first page */
+void eraseBlockOfClosedFile(char *path, uint32_t physicalPageId) {
+    void *file = setupPosixFile(path, EMBEDDB_FILE_ROLE_DATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, POSIX_OPEN(file, EMBEDDB_FILE_MODE_R_PLUS_B), "Unable to open file to erase.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, POSIX_ERASE(physicalPageId, 4, 512, file), "Unable to erase block.");
+    tearDownPosixFile(file);
+}
+
+uint32_t countRecords(void) {
+    embedDBIterator it;
+    it.minData = NULL;
+    it.maxData = NULL;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t key, data, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    return numRecordsRead;
+}
+
+void init_preallocates_files_without_changing_their_size(void) {
+    struct stat fileStat;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, fstat(posixFileDescriptor(state->dataFile), &fileStat), "Unable to stat data file.");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, fileStat.st_size, "Preallocating should not change the file size.");
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32_MESSAGE(state->numDataPages * state->pageSize, (uint32_t)fileStat.st_blocks * 512, "Data file was not preallocated.");
+    uint8_t page[512];
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->fileInterface->read(page, 0, state->pageSize, state->dataFile), "Reading a preallocated page that was never written should fail.");
+}
+
+void wrapping_erases_the_reclaimed_block(void) {
+    /* Wraps the data file and leaves the newest page part way through an erase block */
+    insertRecords(state->maxRecordsPerPage * 2001, 0);
+    embedDBFlush(state);
+    uint32_t nextPhysicalPage = state->nextDataPageId % state->numDataPages;
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, nextPhysicalPage % state->eraseSizeInPages, "Test should stop part way through an erase block.");
+    uint8_t page[512];
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->read(page, nextPhysicalPage, state->pageSize, state->dataFile), "Unable to read erased page.");
+    TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(0, page, state->pageSize, "Reclaimed pages were not erased.");
+}
+
+void recovery_skips_erased_pages_after_the_newest_page(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * 2001 + 10;
+    insertRecords(numRecords, 0);
+    embedDBFlush(state);
+    uint32_t expectedNextPage = state->nextDataPageId;
+    uint32_t expectedMinPage = state->minDataPageId;
+    tearDown();
+
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA, 48);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedMinPage, state->minDataPageId, "minDataPageId was not recovered past the erased pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords - state->maxRecordsPerPage * expectedMinPage, countRecords(), "Iterator did not read every recovered record.");
+    uint32_t key = numRecords - 11, data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a recovered record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data after recovery.");
+}
+
+void checkRecoveryAfterBlockErasedBeforeWrite(uint32_t numPages) {
+    insertRecords(state->maxRecordsPerPage * numPages, 0);
+    embedDBFlush(state);
+    uint32_t expectedNextPage = state->nextDataPageId;
+    uint32_t expectedMinPage = state->minDataPageId + state->eraseSizeInPages;
+    tearDown();
+
+    eraseBlockOfClosedFile(dataPath, expectedNextPage % 1000);
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA, 48);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedMinPage, state->minDataPageId, "minDataPageId was not recovered past the erased block.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage * (expectedNextPage - expectedMinPage), countRecords(), "Iterator did not read every recovered record.");
+}
+
+void recovery_skips_a_block_erased_before_it_was_written(void) {
+    checkRecoveryAfterBlockErasedBeforeWrite(2008);
+}
+
+void recovery_skips_a_first_block_erased_before_it_was_written(void) {
+    checkRecoveryAfterBlockErasedBeforeWrite(2000);
+}
+
+void recovery_skips_erased_index_and_variable_data_pages(void) {
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 8);
+    /* Enough data pages to wrap the 8 index pages, and enough variable data to wrap its file many times */
+    uint32_t numRecords = state->maxIdxRecordsPerPage * 9 * state->maxRecordsPerPage + 123;
+    insertRecords(numRecords, 20);
+    embedDBFlush(state);
+    uint32_t expectedNextIndexPage = state->nextIdxPageId;
+    uint32_t expectedMinIndexPage = state->minIndexPageId;
+    uint32_t expectedNextVarPage = state->nextVarPageId;
+    uint32_t expectedMinVarRecord = state->minVarRecordId;
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, expectedNextIndexPage % state->eraseSizeInPages, "Test should stop part way through an index erase block.");
+    tearDown();
+
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA, 8);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextIndexPage, state->nextIdxPageId, "nextIdxPageId was not recovered.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedMinIndexPage, state->minIndexPageId, "minIndexPageId was not recovered past the erased pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextVarPage, state->nextVarPageId, "nextVarPageId was not recovered.");
+    /* Recovery starts after the records of the oldest page, so it can be up to a page of records past the erased ones */
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32_MESSAGE(expectedMinVarRecord, state->minVarRecordId, "minVarRecordId includes erased records.");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(expectedMinVarRecord + state->pageSize / 20, state->minVarRecordId, "minVarRecordId was not recovered past the erased pages.");
+
+    uint32_t key = numRecords - 200, data = 0;
+    char buf[24];
+    embedDBVarDataStream *varStream = NULL;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &data, &varStream), "embedDBGetVar did not find a recovered record.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "embedDBGetVar did not return vardata");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(20, embedDBVarDataStreamRead(state, varStream, buf, sizeof(buf)), "Returned vardata was not the right length");
+    TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE("Variable data 012345", buf, 20, "embedDBGetVar returned the wrong vardata.");
+    free(varStream);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(init_preallocates_files_without_changing_their_size);
+    RUN_TEST(wrapping_erases_the_reclaimed_block);
+    RUN_TEST(recovery_skips_erased_pages_after_the_newest_page);
+    RUN_TEST(recovery_skips_a_block_erased_before_it_was_written);
+    RUN_TEST(recovery_skips_a_first_block_erased_before_it_was_written);
+    RUN_TEST(recovery_skips_erased_index_and_variable_data_pages);
+    return UNITY_END();
+}
@@ -0,0 +1,302 @@
+/******************************************************************************/
+/**
+ * @file        Test_embedDB_partial_pages.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test that flushing with EMBEDDB_REWRITE_PARTIAL_PAGES rewrites the last page in place.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+
+void initializeState(int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->numVarPages = 1000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/partialDataFile.bin", indexPath[] = "build/artifacts/partialIndexFile.bin", varPath[] = "build/artifacts/partialVarFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->varFile = setupFile(varPath);
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_REWRITE_PARTIAL_PAGES | EMBEDDB_RESET_DATA);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    tearDownFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Inserts keys [startKey, endKey) and flushes after every flushInterval records */
+void insertRecordsWithFlushes(uint32_t startKey, uint32_t endKey, uint32_t flushInterval) {
+    for (uint32_t key = startKey; key < endKey; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+        if ((key + 1) % flushInterval == 0)
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed.");
+    }
+}
+
+int8_t (*fileWrite)(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+
+/* Loses index page writes, as if the process stopped after writing the data page */
+int8_t WRITE_ALL_BUT_INDEX(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    if (file == state->indexFile)
+        return 1;
+    return fileWrite(buffer, pageNum, pageSize, file);
+}
+
+/* Frees the state without writing its buffered pages, as if the process stopped. Pages already written reach the files */
+void abandonState(void) {
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    tearDownFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Inserts count records with the same data after the largest key */
+void insertRecordsWithData(uint32_t count, uint32_t data) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t key = state->nextDataPageId == 0 && EMBEDDB_GET_COUNT(state->buffer) == 0 ? 0 : state->maxKey + 1;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+/* Counts the records with the given data with a bitmap filtered iterator */
+uint32_t countRecordsWithData(uint32_t data) {
+    embedDBIterator it;
+    it.minData = &data;
+    it.maxData = &data;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, recordData, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &recordData))
+        numRecordsRead++;
+    embedDBCloseIterator(&it);
+    return numRecordsRead;
+}
+
+/* Fills the index page in the write buffer so that it is written to storage */
+void writeIndexPageAfterRecovery(void) {
+    id_t indexPageId = state->nextIdxPageId;
+    while (state->nextIdxPageId == indexPageId)
+        insertRecordsWithData(state->maxRecordsPerPage, 0);
+}
+
+uint32_t countRecords(uint32_t *minData, uint32_t *maxData) {
+    embedDBIterator it;
+    it.minData = minData;
+    it.maxData = maxData;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, data, expectedKey = 0, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        if (minData == NULL && maxData == NULL)
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedKey++, key, "Iterator returned the wrong key");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    return numRecordsRead;
+}
+
+void partial_flushes_do_not_advance_the_page_id(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * 3 + 10;
+    insertRecordsWithFlushes(0, numRecords, 5);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(3, state->nextDataPageId, "Flushing a partial page should not use up a new page.");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(10, EMBEDDB_GET_COUNT(state->buffer), "Flushed records should stay in the write buffer.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->numDataPages - 4, state->numAvailDataPages, "The partial page should be reserved exactly once.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords, countRecords(NULL, NULL), "Iterator did not read every record.");
+
+    uint32_t data = 0;
+    for (uint32_t key = 0; key < state->maxRecordsPerPage * 3; key += 7) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find an inserted record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data.");
+    }
+}
+
+void partial_flushes_add_one_index_entry_per_page(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * 20 + 3;
+    insertRecordsWithFlushes(0, numRecords, 9);
+    embedDBFlush(state);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(20, state->nextDataPageId, "Flushing a partial page should not use up a new page.");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(20, EMBEDDB_GET_COUNT((int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_WRITE_BUFFER), "The index should have one entry per full data page.");
+
+    uint32_t minData = 23, maxData = 38, expected = 0;
+    for (uint32_t key = 0; key < numRecords; key++)
+        if (key % 100 >= minData && key % 100 <= maxData)
+            expected++;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected, countRecords(&minData, &maxData), "Filtered iterator did not read the correct number of records");
+}
+
+void partial_page_is_reloaded_after_reopen(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * 5 + 17;
+    insertRecordsWithFlushes(0, numRecords, 6);
+    embedDBFlush(state);
+    tearDown();
+
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_REWRITE_PARTIAL_PAGES);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(5, state->nextDataPageId, "nextDataPageId should point at the recovered partial page.");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(17, EMBEDDB_GET_COUNT(state->buffer), "The partial page was not reloaded into the write buffer.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords, countRecords(NULL, NULL), "Iterator did not read every recovered record.");
+
+    /* Keep appending to the recovered page and recover again */
+    uint32_t moreRecords = numRecords + state->maxRecordsPerPage * 2;
+    insertRecordsWithFlushes(numRecords, moreRecords, 11);
+    embedDBFlush(state);
+    tearDown();
+
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_REWRITE_PARTIAL_PAGES);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(7, state->nextDataPageId, "nextDataPageId should point at the recovered partial page.");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(7, EMBEDDB_GET_COUNT((int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_WRITE_BUFFER), "The index page was not reloaded without its provisional entry.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(moreRecords, countRecords(NULL, NULL), "Iterator did not read every recovered record.");
+
+    uint32_t minData = 50, maxData = 59;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(moreRecords / 100 * 10 + (moreRecords % 100 > 50 ? min(moreRecords % 100 - 50, 10) : 0), countRecords(&minData, &maxData), "Filtered iterator did not read the correct number of records");
+
+    uint32_t key = moreRecords - state->maxRecordsPerPage, data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a recovered record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data after recovery.");
+}
+
+void crash_after_partial_page_fills_keeps_its_index_entry_current(void) {
+    /* The flushed index entry only covers data 0 */
+    insertRecordsWithData(10, 0);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed.");
+    /* Filling the page writes it with data 90, but not the index page, before the crash */
+    insertRecordsWithData(state->maxRecordsPerPage - 10 + 1, 90);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->nextDataPageId, "The full data page should have been written.");
+    abandonState();
+
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_REWRITE_PARTIAL_PAGES);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->nextDataPageId, "The full data page was not recovered.");
+    writeIndexPageAfterRecovery();
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage - 10, countRecordsWithData(90), "The index entry of the recovered page is out of date.");
+}
+
+void crash_before_index_is_flushed_keeps_entries_in_step(void) {
+    insertRecordsWithData(state->maxRecordsPerPage, 10);
+    insertRecordsWithData(5, 20);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed.");
+    insertRecordsWithData(state->maxRecordsPerPage - 5, 20);
+    insertRecordsWithData(state->maxRecordsPerPage, 30);
+    insertRecordsWithData(5, 40);
+    /* The partial data page is written, but the process stops before the index page is */
+    fileWrite = state->fileInterface->write;
+    state->fileInterface->write = WRITE_ALL_BUT_INDEX;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed.");
+    abandonState();
+
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_REWRITE_PARTIAL_PAGES);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(3, state->nextDataPageId, "The full data pages were not recovered.");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(5, EMBEDDB_GET_COUNT(state->buffer), "The partial page was not reloaded into the write buffer.");
+    writeIndexPageAfterRecovery();
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage, countRecordsWithData(30), "Index entries after the crash are out of step with the data pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(5, countRecordsWithData(40), "Index entries after the crash are out of step with the data pages.");
+}
+
+void partial_flushes_reuse_the_variable_data_page(void) {
+    char varData[] = "Testing 000...";
+    for (uint32_t key = 0; key < 60; key++) {
+        uint32_t data = key % 100;
+        varData[8] = '0' + key / 10;
+        varData[9] = '0' + key % 10;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutVar(state, &key, &data, varData, sizeof(varData)), "embedDBPutVar did not correctly insert data.");
+        if (key % 4 == 3)
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed.");
+    }
+
+    /* 60 records of 19 bytes each fill a little over two variable data pages */
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, state->nextVarPageId, "Flushing a partial variable data page should not use up a new page.");
+
+    char buf[20];
+    for (uint32_t key = 0; key < 60; key++) {
+        uint32_t data = 0;
+        embedDBVarDataStream *varStream = NULL;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &data, &varStream), "embedDBGetVar did not find the record.");
+        TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "embedDBGetVar did not return vardata");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(sizeof(varData), embedDBVarDataStreamRead(state, varStream, buf, sizeof(buf)), "Returned vardata was not the right length");
+        varData[8] = '0' + key / 10;
+        varData[9] = '0' + key % 10;
+        TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(varData, buf, sizeof(varData), "embedDBGetVar did not return the correct vardata");
+        free(varStream);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(partial_flushes_do_not_advance_the_page_id);
+    RUN_TEST(partial_flushes_add_one_index_entry_per_page);
+    RUN_TEST(partial_page_is_reloaded_after_reopen);
+    RUN_TEST(partial_flushes_reuse_the_variable_data_page);
+    RUN_TEST(crash_after_partial_page_fills_keeps_its_index_entry_current);
+    RUN_TEST(crash_before_index_is_flushed_keeps_entries_in_step);
+    return UNITY_END();
+}
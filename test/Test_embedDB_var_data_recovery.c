@@ -117,10 +117,9 @@ void embedDB_variable_data_page_numbers_are_correct() {
     uint32_t numberOfPagesExpected = 69;
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(numberOfPagesExpected - 1, state->nextVarPageId, "EmbedDB next variable data logical page number is incorrect.");
     uint32_t pageNumber;
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
     for (uint32_t i = 0; i < numberOfPagesExpected - 1; i++) {
         readVariablePage(state, i);
-        memcpy(&pageNumber, buffer, sizeof(id_t));
+        memcpy(&pageNumber, state->varReadPage, sizeof(id_t));
         TEST_ASSERT_EQUAL_UINT32_MESSAGE(i, pageNumber, "EmbedDB variable data did not have the correct page number.");
     }
 }
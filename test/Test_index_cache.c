@@ -0,0 +1,199 @@
+/******************************************************************************/
+/**
+ * @file        Test_index_cache.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test keeping every index page in memory.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_DATA_PAGES 3000
+#define NUM_INDEX_PAGES 4
+
+embedDBState *state;
+
+void initializeState(int8_t resetData, int8_t cacheIndex) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = NUM_DATA_PAGES;
+    state->numIndexPages = NUM_INDEX_PAGES;
+    state->eraseSizeInPages = 2;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/dataFile.bin", indexPath[] = "build/artifacts/indexFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | (resetData ? EMBEDDB_RESET_DATA : 0) | (cacheIndex ? EMBEDDB_CACHE_INDEX : 0);
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(1, 0);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Records on each run of ten data pages share a data value, so the bitmap index rules out most pages */
+uint32_t dataForKey(uint32_t key) {
+    return (key / (state->maxRecordsPerPage * 10)) % 100;
+}
+
+void insertRecords(uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = dataForKey(key);
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+    embedDBFlush(state);
+}
+
+uint32_t countMatchingRecords(void) {
+    uint32_t minData = 70, maxData = 79, key = 0, data = 0, numRecords = 0;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    embedDBInitIterator(state, &it);
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_TRUE_MESSAGE(data >= minData && data <= maxData, "Iterator returned a record outside of the data range.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(dataForKey(key), data, "Iterator returned the wrong data for a key.");
+        numRecords++;
+    }
+    embedDBCloseIterator(&it);
+    return numRecords;
+}
+
+/* Number of the first numRecords records that countMatchingRecords returns */
+uint32_t expectedMatchingRecords(uint32_t numRecords) {
+    uint32_t expected = 0;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = dataForKey(key);
+        if (data >= 70 && data <= 79)
+            expected++;
+    }
+    return expected;
+}
+
+void index_cache_is_loaded_from_existing_index(void) {
+    insertRecords(state->maxRecordsPerPage * 1200);
+    tearDown();
+    initializeState(0, 0);
+    uint32_t expected = countMatchingRecords();
+
+    embedDBResetStats(state);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCacheIndex(state), "embedDBCacheIndex failed.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->nextIdxPageId - state->minIndexPageId, state->numIdxReads, "Each live index page should be read once.");
+
+    embedDBResetStats(state);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected, countMatchingRecords(), "Cached index gave different query results.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numIdxReads, "Query read index pages from storage.");
+}
+
+void index_cache_keeps_pages_written_after_it(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCacheIndex(state), "embedDBCacheIndex failed.");
+    uint32_t numRecords = state->maxRecordsPerPage * 1200;
+    insertRecords(numRecords);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(1, state->nextIdxPageId, "Test should write several index pages.");
+
+    embedDBResetStats(state);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedMatchingRecords(numRecords), countMatchingRecords(), "Query with cached index returned the wrong number of records.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numIdxReads, "Query read index pages from storage.");
+}
+
+void index_cache_follows_index_file_wrapping_around(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBCacheIndex(state), "embedDBCacheIndex failed.");
+    insertRecords(state->maxRecordsPerPage * (NUM_DATA_PAGES - 10));
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, state->minIndexPageId, "Test should wrap around the index file.");
+    uint32_t cached = countMatchingRecords();
+
+    free(state->indexCache);
+    state->indexCache = NULL;
+    state->bufferedIndexPageId = -1;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(countMatchingRecords(), cached, "Cached index gave different query results after wrapping around.");
+}
+
+void index_cache_is_loaded_by_recovery_with_parameter(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * 1200;
+    insertRecords(numRecords);
+    tearDown();
+    initializeState(0, 1);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->indexCache, "EMBEDDB_CACHE_INDEX did not cache the recovered index.");
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedMatchingRecords(numRecords), countMatchingRecords(), "Index cached by recovery gave the wrong query results.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numIdxReads, "Query read index pages from storage.");
+}
+
+void index_cache_is_allocated_for_new_index_with_parameter(void) {
+    tearDown();
+    initializeState(1, 1);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->indexCache, "EMBEDDB_CACHE_INDEX did not cache the new index.");
+    uint32_t numRecords = state->maxRecordsPerPage * 1200;
+    insertRecords(numRecords);
+
+    embedDBResetStats(state);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedMatchingRecords(numRecords), countMatchingRecords(), "Query with cached index returned the wrong number of records.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numIdxReads, "Query read index pages from storage.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(index_cache_is_loaded_from_existing_index);
+    RUN_TEST(index_cache_keeps_pages_written_after_it);
+    RUN_TEST(index_cache_follows_index_file_wrapping_around);
+    RUN_TEST(index_cache_is_loaded_by_recovery_with_parameter);
+    RUN_TEST(index_cache_is_allocated_for_new_index_with_parameter);
+    return UNITY_END();
+}
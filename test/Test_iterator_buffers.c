@@ -0,0 +1,230 @@
+/******************************************************************************/
+/**
+ * @file        Test_iterator_buffers.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB iterators that keep their current pages in their own buffers.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_PAGES 20
+
+embedDBState *state;
+
+void initializeState(int8_t parameters, int8_t bufferSizeInBlocks) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    /* Only the required buffers, so pages are not kept in a buffer pool */
+    state->bufferSizeInBlocks = bufferSizeInBlocks;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->numVarPages = 1000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/dataFile.bin", indexPath[] = "build/artifacts/indexFile.bin", varPath[] = "build/artifacts/varFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->varFile = EMBEDDB_USING_VDATA(parameters) ? setupFile(varPath) : NULL;
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 6);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    if (state->varFile != NULL)
+        tearDownFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t firstKey, uint32_t numRecords) {
+    char varData[] = "Record 00";
+    for (uint32_t key = firstKey; key < firstKey + numRecords; key++) {
+        uint32_t data = key % 100;
+        varData[7] = '0' + data / 10;
+        varData[8] = '0' + data % 10;
+        int8_t result = embedDBPutVar(state, &key, &data, varData, sizeof(varData));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void initIterator(embedDBIterator *it, void *minData, void *maxData) {
+    it->minKey = NULL;
+    it->maxKey = NULL;
+    it->minData = minData;
+    it->maxData = maxData;
+    embedDBInitIterator(state, it);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBIteratorAllocBuffers(state, it), "Failed to allocate iterator buffers.");
+}
+
+void interleaved_scans_read_each_page_once(void) {
+    insertRecords(0, state->maxRecordsPerPage * NUM_PAGES);
+    embedDBFlush(state);
+    embedDBResetStats(state);
+
+    embedDBIterator it1, it2;
+    uint32_t minData = 10, maxData = 19;
+    initIterator(&it1, NULL, NULL);
+    initIterator(&it2, &minData, &maxData);
+    uint32_t key1, data1, key2, data2, numRecords1 = 0, numRecords2 = 0;
+    int8_t more1 = 1, more2 = 1;
+    while (more1 || more2) {
+        if (more1 && (more1 = embedDBNext(state, &it1, &key1, &data1))) {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords1, key1, "Unfiltered iterator returned the wrong record.");
+            numRecords1++;
+        }
+        if (more2 && (more2 = embedDBNext(state, &it2, &key2, &data2))) {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(key2 % 100, data2, "Filtered iterator returned the wrong data.");
+            TEST_ASSERT_TRUE_MESSAGE(data2 >= minData && data2 <= maxData, "Filtered iterator returned a record outside its range.");
+            numRecords2++;
+        }
+    }
+    embedDBCloseIterator(&it1);
+    embedDBCloseIterator(&it2);
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage * NUM_PAGES, numRecords1, "Unfiltered iterator did not return every record.");
+    uint32_t expectedRecords2 = 0;
+    for (uint32_t key = 0; key < state->maxRecordsPerPage * NUM_PAGES; key++)
+        expectedRecords2 += key % 100 >= minData && key % 100 <= maxData;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedRecords2, numRecords2, "Filtered iterator did not return every matching record.");
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads <= 2 * NUM_PAGES, "Interleaved iterators read their pages more than once.");
+}
+
+void lookups_between_calls_do_not_reread_iterator_page(void) {
+    insertRecords(0, state->maxRecordsPerPage * NUM_PAGES);
+    embedDBFlush(state);
+    embedDBResetStats(state);
+
+    embedDBIterator it;
+    initIterator(&it, NULL, NULL);
+    uint32_t key, data, numRecords = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords, key, "Iterator returned the wrong record.");
+        numRecords++;
+        uint32_t lookupKey = state->maxRecordsPerPage * NUM_PAGES - 1 - key, lookupData = 0;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &lookupKey, &lookupData), "embedDBGet did not find a record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(lookupKey % 100, lookupData, "embedDBGet returned the wrong data.");
+    }
+    embedDBCloseIterator(&it);
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage * NUM_PAGES, numRecords, "Iterator did not return every record.");
+    /* The iterator reads each page once. Lookups read a page each time the iterator or the lookup moves to another page */
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads <= 3 * NUM_PAGES, "Lookups made the iterator read its pages again.");
+}
+
+void iterator_var_data_is_read_from_its_own_page(void) {
+    insertRecords(0, 1000);
+    embedDBFlush(state);
+
+    embedDBIterator it;
+    initIterator(&it, NULL, NULL);
+    uint32_t key, data, numRecords = 0;
+    embedDBVarDataStream *varStream = NULL;
+    char buf[16];
+    char expected[] = "Record 00";
+    while (embedDBNextVar(state, &it, &key, &data, &varStream)) {
+        /* Move the state's read pages to other records before reading the iterator's var data */
+        uint32_t lookupKey = 999 - key, lookupData = 0;
+        embedDBVarDataStream *lookupStream = NULL;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &lookupKey, &lookupData, &lookupStream), "embedDBGetVar did not find a record.");
+        free(lookupStream);
+
+        TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "embedDBNextVar did not return vardata.");
+        expected[7] = '0' + key % 100 / 10;
+        expected[8] = '0' + key % 10;
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(sizeof(expected), embedDBVarDataStreamRead(state, varStream, buf, sizeof(buf)), "Returned vardata was not the right length.");
+        TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(expected, buf, sizeof(expected), "embedDBNextVar returned the wrong vardata.");
+        free(varStream);
+        varStream = NULL;
+        numRecords++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1000, numRecords, "Iterator did not return every record.");
+}
+
+void iterator_sees_records_added_to_write_buffer(void) {
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA, 4);
+    uint32_t key, data;
+    for (key = 0; key < 10; key++) {
+        data = key;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut failed.");
+    }
+
+    embedDBIterator it;
+    initIterator(&it, NULL, NULL);
+    uint32_t numRecords = 0;
+    while (numRecords < 5 && embedDBNext(state, &it, &key, &data))
+        numRecords++;
+    for (key = 10; key < 13; key++) {
+        data = key;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut failed.");
+    }
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords, key, "Iterator returned the wrong record.");
+        numRecords++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(13, numRecords, "Iterator did not return records added while it was open.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(interleaved_scans_read_each_page_once);
+    RUN_TEST(lookups_between_calls_do_not_reread_iterator_page);
+    RUN_TEST(iterator_var_data_is_read_from_its_own_page);
+    RUN_TEST(iterator_sees_records_added_to_write_buffer);
+    return UNITY_END();
+}
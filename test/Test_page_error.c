@@ -0,0 +1,151 @@
+/******************************************************************************/
+/**
+ * @file        Test_page_error.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test the error bound of the key position estimate within data pages.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_RECORDS 3000
+
+embedDBState *state;
+
+void initializeState(int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_RESET_DATA);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Keys grow in bursts so that records are unevenly spread over the key range of a page */
+uint32_t keyForRecord(uint32_t i) {
+    return (i / 16) * 1000 + (i % 16) * (i % 16);
+}
+
+void insertRecords(uint32_t (*keyFunction)(uint32_t)) {
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        uint32_t key = keyFunction(i), data = i;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+/* Recomputes the error of every written page with the slope of its first and last keys */
+int32_t computeMaxError(void) {
+    double maxError = 0;
+    for (id_t pageId = state->minDataPageId; pageId < state->nextDataPageId; pageId++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, pageId % state->numDataPages), "Failed to read data page.");
+        void *buf = state->dataReadPage;
+        uint32_t count = EMBEDDB_GET_COUNT(buf);
+        uint32_t firstKey = *(uint32_t *)((int8_t *)buf + state->headerSize);
+        uint32_t lastKey = *(uint32_t *)((int8_t *)buf + state->headerSize + state->recordSize * (count - 1));
+        double slope = (double)(lastKey - firstKey) / (count - 1);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t key = *(uint32_t *)((int8_t *)buf + state->headerSize + state->recordSize * i);
+            double error = fabs((key - firstKey) / slope - i);
+            if (error > maxError)
+                maxError = error;
+        }
+    }
+    return (int32_t)ceil(maxError);
+}
+
+uint32_t evenKey(uint32_t i) {
+    return i * 3;
+}
+
+void evenly_spaced_keys_have_no_error(void) {
+    insertRecords(evenKey);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(1, state->nextDataPageId, "Records did not fill several pages.");
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(0, state->maxError, "Evenly spaced keys should be exactly on the line of each page.");
+}
+
+void max_error_matches_error_of_written_pages(void) {
+    insertRecords(keyForRecord);
+    int32_t expectedError = computeMaxError();
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, expectedError, "Keys should not be on the line of each page.");
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(expectedError, state->maxError, "Max error does not match the error of the written pages.");
+
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        uint32_t key = keyForRecord(i), data = 0;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(i, data, "embedDBGet returned the wrong data.");
+    }
+}
+
+void max_error_is_recomputed_on_recovery(void) {
+    insertRecords(keyForRecord);
+    embedDBFlush(state);
+    int32_t expectedError = state->maxError;
+    tearDown();
+    initializeState(0);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(expectedError, state->maxError, "Max error was not recovered from the data pages.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(evenly_spaced_keys_have_no_error);
+    RUN_TEST(max_error_matches_error_of_written_pages);
+    RUN_TEST(max_error_is_recomputed_on_recovery);
+    return UNITY_END();
+}
@@ -0,0 +1,183 @@
+/******************************************************************************/
+/**
+ * @file        Test_page_search.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test searching data pages for unsigned integer keys without the key comparator.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_RECORDS 3000
+
+embedDBState *state;
+
+uint32_t numKeyCompares = 0;
+
+int8_t countingInt32Comparator(void *a, void *b) {
+    numKeyCompares++;
+    return int32Comparator(a, b);
+}
+
+int8_t countingInt64Comparator(void *a, void *b) {
+    numKeyCompares++;
+    return int64Comparator(a, b);
+}
+
+void initializeState(int8_t keySize) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = keySize;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->parameters = EMBEDDB_RESET_DATA;
+    state->compareKey = keySize == 4 ? countingInt32Comparator : countingInt64Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void setUp(void) {
+    initializeState(4);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Keys are clustered so that records are unevenly spread over the key range of each page */
+uint64_t keyForRecord(uint32_t i) {
+    return (uint64_t)(i / 16) * 1000 + (i % 16) * (i % 16);
+}
+
+void insertRecords(uint32_t numRecords, uint64_t keyOffset) {
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint64_t key = keyForRecord(i) + keyOffset;
+        uint32_t data = i;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+/* Looks up every key from before the first record to after the last, with both key types, and checks they agree */
+void checkLookupsMatchComparator(uint64_t keyOffset) {
+    uint64_t lastKey = keyForRecord(NUM_RECORDS - 1) + keyOffset;
+    uint32_t numFound = 0;
+    for (uint64_t key = keyOffset > 0 ? keyOffset - 1 : 0; key <= lastKey + 1; key++) {
+        uint32_t data = 0, expectedData = 0;
+        embedDBSetKeyType(state, EMBEDDB_KEY_CUSTOM);
+        int8_t expectedResult = embedDBGet(state, &key, &expectedData);
+        embedDBSetKeyType(state, state->keySize == 4 ? EMBEDDB_KEY_UINT32 : EMBEDDB_KEY_UINT64);
+        int8_t result = embedDBGet(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(expectedResult, result, "Unsigned key search did not agree with the comparator.");
+        if (result == 0) {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedData, data, "Unsigned key search returned the wrong record.");
+            numFound++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(NUM_RECORDS, numFound, "Not every record was found.");
+}
+
+void unsigned_32_bit_search_matches_comparator(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(EMBEDDB_KEY_UINT32, state->keyType, "4 byte keys should be searched as unsigned 32-bit numbers.");
+    insertRecords(NUM_RECORDS, 0);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, state->maxError, "Keys should not be on the line of each page.");
+    checkLookupsMatchComparator(0);
+}
+
+void unsigned_64_bit_search_matches_comparator(void) {
+    tearDown();
+    initializeState(8);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(EMBEDDB_KEY_UINT64, state->keyType, "8 byte keys should be searched as unsigned 64-bit numbers.");
+    uint64_t keyOffset = (uint64_t)1 << 40;
+    insertRecords(NUM_RECORDS, keyOffset);
+    checkLookupsMatchComparator(keyOffset);
+}
+
+void search_outside_error_window_finds_keys(void) {
+    insertRecords(NUM_RECORDS, 0);
+    /* Pages not within maxError of the estimate must still be searched correctly */
+    state->maxError = 0;
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        uint64_t key = keyForRecord(i);
+        uint32_t data = 0;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(i, data, "embedDBGet returned the wrong data.");
+    }
+}
+
+void unsigned_search_does_not_call_comparator(void) {
+    /* Records stay in the write buffer, which is searched without the spline */
+    insertRecords(state->maxRecordsPerPage - 1, 0);
+    numKeyCompares = 0;
+    for (uint32_t i = 0; i < state->maxRecordsPerPage - 1u; i++) {
+        uint64_t key = keyForRecord(i);
+        uint32_t data = 0;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record.");
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numKeyCompares, "Searching a page for an unsigned key called the key comparator.");
+
+    embedDBSetKeyType(state, EMBEDDB_KEY_CUSTOM);
+    uint64_t key = keyForRecord(5);
+    uint32_t data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record.");
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, numKeyCompares, "Custom keys should be compared with the key comparator.");
+}
+
+void key_type_must_match_key_size(void) {
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBSetKeyType(state, EMBEDDB_KEY_UINT64), "8 byte key type was accepted for 4 byte keys.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(EMBEDDB_KEY_UINT32, state->keyType, "Key type changed after a rejected call.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(unsigned_32_bit_search_matches_comparator);
+    RUN_TEST(unsigned_64_bit_search_matches_comparator);
+    RUN_TEST(search_outside_error_window_finds_keys);
+    RUN_TEST(unsigned_search_does_not_call_comparator);
+    RUN_TEST(key_type_must_match_key_size);
+    return UNITY_END();
+}
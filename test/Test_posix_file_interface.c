@@ -0,0 +1,212 @@
+/******************************************************************************/
+/**
+ * @file        Test_posix_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB insertion, querying, and recovery using the POSIX file interface.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/posixFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+
+void initializeState(int8_t parameters, uint16_t bufferSizeInBlocks) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = bufferSizeInBlocks;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getPosixFileInterface();
+    char dataPath[] = "build/artifacts/posixDataFile.bin", indexPath[] = "build/artifacts/posixIndexFile.bin";
+    state->dataFile = setupPosixFile(dataPath, EMBEDDB_FILE_ROLE_DATA);
+    state->indexFile = setupPosixFile(indexPath, EMBEDDB_FILE_ROLE_INDEX);
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the POSIX file interface.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA, 4);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownPosixFile(state->dataFile);
+    tearDownPosixFile(state->indexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void posix_interface_get_returns_inserted_records(void) {
+    insertRecords(5000);
+    embedDBFlush(state);
+    uint32_t data = 0;
+    for (uint32_t key = 0; key < 5000; key += 7) {
+        int8_t result = embedDBGet(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBGet did not find an inserted record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data.");
+    }
+}
+
+void posix_interface_reading_past_end_of_file_fails(void) {
+    insertRecords(200);
+    embedDBFlush(state);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, 0), "Reading a written page failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, readPage(state, 500), "Reading a page that was never written should fail.");
+}
+
+void posix_interface_iterator_returns_filtered_records(void) {
+    insertRecords(3000);
+    embedDBFlush(state);
+
+    embedDBIterator it;
+    uint32_t minData = 23, maxData = 38;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, data, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(30 * 16, numRecordsRead, "Iterator did not read the correct number of records");
+}
+
+void posix_interface_recovers_data_after_reopen(void) {
+    insertRecords(4000);
+    embedDBFlush(state);
+    uint32_t expectedNextPage = state->nextDataPageId;
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX, 4);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered from the data file.");
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(0, state->minKey, "minKey was not recovered from the data file.");
+    uint32_t key = 3999, data = 0;
+    int8_t result = embedDBGet(state, &key, &data);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBGet did not find a recovered record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(99, data, "embedDBGet returned the wrong data after recovery.");
+}
+
+void posix_interface_reads_and_writes_consecutive_pages(void) {
+    void *buffers[6];
+    for (uint32_t i = 0; i < 6; i++) {
+        buffers[i] = malloc(state->pageSize);
+        memset(buffers[i], i + 1, state->pageSize);
+    }
+    uint32_t numWritten = state->fileInterface->writePages(buffers, 10, 4, state->pageSize, state->dataFile);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(4, numWritten, "writePages did not write all pages.");
+
+    for (uint32_t i = 0; i < 6; i++)
+        memset(buffers[i], 0, state->pageSize);
+    uint32_t numRead = state->fileInterface->readPages(buffers, 10, 6, state->pageSize, state->dataFile);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(4, numRead, "readPages should stop at the end of the file.");
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(i + 1, buffers[i], state->pageSize, "readPages returned the wrong page contents.");
+        free(buffers[i]);
+    }
+    free(buffers[4]);
+    free(buffers[5]);
+}
+
+void posix_interface_recovers_wrapped_data_with_batched_reads(void) {
+    /* Enough records to wrap around the 1000 data pages */
+    insertRecords(80000);
+    embedDBFlush(state);
+    uint32_t expectedNextPage = state->nextDataPageId;
+    uint32_t expectedMinPage = state->minDataPageId;
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX, 12);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(8, state->numWindowPages, "Spare buffer pages were not used as a read window.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered from the data file.");
+    /* Erased pages that have not been overwritten yet are still found by recovery */
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(expectedMinPage, state->minDataPageId, "minDataPageId was not recovered from the data file.");
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32_MESSAGE(expectedMinPage - state->eraseSizeInPages, state->minDataPageId, "minDataPageId was not recovered from the data file.");
+
+    uint32_t data = 0;
+    for (uint32_t key = 79999; key > 79999 - 30000; key -= 101) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a recovered record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data after recovery.");
+    }
+
+    embedDBResetStats(state);
+    embedDBIterator it;
+    it.minData = NULL;
+    it.maxData = NULL;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t key, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data))
+        numRecordsRead++;
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->nextDataPageId - state->minDataPageId, state->numReads, "Each data page should be read once by the scan.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(80000 - state->maxRecordsPerPage * state->minDataPageId, numRecordsRead, "Iterator did not read every recovered record.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(posix_interface_get_returns_inserted_records);
+    RUN_TEST(posix_interface_reading_past_end_of_file_fails);
+    RUN_TEST(posix_interface_iterator_returns_filtered_records);
+    RUN_TEST(posix_interface_recovers_data_after_reopen);
+    RUN_TEST(posix_interface_reads_and_writes_consecutive_pages);
+    RUN_TEST(posix_interface_recovers_wrapped_data_with_batched_reads);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+/******************************************************************************/
+/**
+ * @file        Test_put_batch.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test inserting arrays of records with embedDBPutBatch.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_RECORDS 5000
+#define BATCH_SIZE 37
+
+embedDBState *state, *expectedState;
+
+embedDBState *createState(char *dataPath, char *indexPath, char *varPath, int8_t parameters) {
+    embedDBState *newState = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(newState, "Unable to allocate EmbedDB state.");
+    newState->keySize = 4;
+    newState->dataSize = 4;
+    newState->pageSize = 512;
+    newState->bufferSizeInBlocks = 6;
+    newState->numSplinePoints = 300;
+    /* The min and max header fields are placed after an 8 byte bitmap */
+    newState->bitmapSize = 8;
+    newState->buffer = calloc(1, (size_t)newState->pageSize * newState->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(newState->buffer, "Failed to allocate buffer for EmbedDB.");
+    newState->numDataPages = 1000;
+    newState->numIndexPages = 48;
+    newState->numVarPages = 1000;
+    newState->eraseSizeInPages = 4;
+    newState->fileInterface = getFileInterface();
+    newState->dataFile = setupFile(dataPath);
+    newState->indexFile = setupFile(indexPath);
+    newState->varFile = setupFile(varPath);
+    newState->parameters = parameters;
+    newState->inBitmap = inBitmapInt64;
+    newState->updateBitmap = updateBitmapInt64;
+    newState->buildBitmapFromRange = buildBitmapInt64FromRange;
+    newState->compareKey = int32Comparator;
+    newState->compareData = int32Comparator;
+    int8_t result = embedDBInit(newState, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+    embedDBResetStats(newState);
+    return newState;
+}
+
+void destroyState(embedDBState *oldState) {
+    embedDBClose(oldState);
+    tearDownFile(oldState->dataFile);
+    tearDownFile(oldState->indexFile);
+    tearDownFile(oldState->varFile);
+    free(oldState->buffer);
+    free(oldState->fileInterface);
+    free(oldState);
+}
+
+void setUp(void) {
+    int8_t parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_MAX_MIN | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA;
+    state = createState("build/artifacts/dataFile.bin", "build/artifacts/indexFile.bin", "build/artifacts/varFile.bin", parameters);
+    expectedState = createState("build/artifacts/expectedDataFile.bin", "build/artifacts/expectedIndexFile.bin", "build/artifacts/expectedVarFile.bin", parameters);
+}
+
+void tearDown(void) {
+    destroyState(state);
+    destroyState(expectedState);
+}
+
+uint32_t dataForKey(uint32_t key) {
+    return 300 + (key / 8) % 400;
+}
+
+void compareFiles(void) {
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedState->nextDataPageId, state->nextDataPageId, "Batches wrote a different number of data pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedState->nextIdxPageId, state->nextIdxPageId, "Batches wrote a different number of index pages.");
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expectedState->buffer, state->buffer, state->pageSize, "Write buffer differs from inserting one record at a time.");
+    for (id_t pageId = 0; pageId < state->nextDataPageId; pageId++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(expectedState, pageId), "Failed to read data page.");
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readPage(state, pageId), "Failed to read data page.");
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expectedState->dataReadPage, state->dataReadPage, state->pageSize, "Data page differs from inserting one record at a time.");
+    }
+    for (id_t pageId = 0; pageId < state->nextIdxPageId; pageId++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readIndexPage(expectedState, pageId), "Failed to read index page.");
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, readIndexPage(state, pageId), "Failed to read index page.");
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expectedState->indexReadPage, state->indexReadPage, state->pageSize, "Index page differs from inserting one record at a time.");
+    }
+}
+
+void put_batch_writes_same_pages_as_put(void) {
+    uint32_t keys[BATCH_SIZE], data[BATCH_SIZE];
+    for (uint32_t first = 0; first < NUM_RECORDS; first += BATCH_SIZE) {
+        uint32_t numRecords = min(BATCH_SIZE, NUM_RECORDS - first);
+        for (uint32_t i = 0; i < numRecords; i++) {
+            keys[i] = first + i;
+            data[i] = dataForKey(keys[i]);
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(expectedState, &keys[i], &data[i]), "embedDBPut failed.");
+        }
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutBatch(state, keys, data, numRecords), "embedDBPutBatch failed.");
+    }
+    compareFiles();
+
+    uint32_t key = 4321, value = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &value), "embedDBGet did not find a record inserted in a batch.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(dataForKey(key), value, "embedDBGet returned the wrong data.");
+}
+
+void put_batch_rejects_keys_out_of_order(void) {
+    uint32_t keys[] = {10, 20, 15, 30}, data[] = {1, 2, 3, 4};
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, embedDBPutBatch(state, keys, data, 4), "A batch that is not sorted was inserted.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, EMBEDDB_GET_COUNT(state->buffer), "Records of a rejected batch were inserted.");
+
+    keys[2] = 25;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutBatch(state, keys, data, 4), "A sorted batch was not inserted.");
+    uint32_t nextKeys[] = {30, 40};
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, embedDBPutBatch(state, nextKeys, data, 2), "A batch starting at the last key was inserted.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(4, EMBEDDB_GET_COUNT(state->buffer), "Records of a rejected batch were inserted.");
+    uint32_t key = 30;
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBPut(state, &key, data), "embedDBPut accepted the last key of a batch again.");
+}
+
+void put_batch_var_writes_same_pages_as_put_var(void) {
+    char *text[] = {"a", "variable length string", NULL, "hello world"};
+    uint32_t keys[BATCH_SIZE], data[BATCH_SIZE], lengths[BATCH_SIZE];
+    void *varData[BATCH_SIZE];
+    for (uint32_t first = 0; first < NUM_RECORDS; first += BATCH_SIZE) {
+        uint32_t numRecords = min(BATCH_SIZE, NUM_RECORDS - first);
+        for (uint32_t i = 0; i < numRecords; i++) {
+            keys[i] = first + i;
+            data[i] = dataForKey(keys[i]);
+            varData[i] = text[keys[i] % 4];
+            lengths[i] = varData[i] == NULL ? 0 : strlen(text[keys[i] % 4]) + 1;
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutVar(expectedState, &keys[i], &data[i], varData[i], lengths[i]), "embedDBPutVar failed.");
+        }
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutBatchVar(state, keys, data, varData, lengths, numRecords), "embedDBPutBatchVar failed.");
+    }
+    compareFiles();
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedState->nextVarPageId, state->nextVarPageId, "Batches wrote a different number of variable data pages.");
+
+    uint32_t key = 4321, value = 0;
+    char buffer[32];
+    embedDBVarDataStream *stream = NULL;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &value, &stream), "embedDBGetVar did not find a record inserted in a batch.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stream, "No variable data was returned.");
+    uint32_t length = embedDBVarDataStreamRead(state, stream, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(strlen(text[key % 4]) + 1, length, "Read the wrong amount of variable data.");
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(text[key % 4], buffer, length, "Read the wrong variable data.");
+    free(stream);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(put_batch_writes_same_pages_as_put);
+    RUN_TEST(put_batch_rejects_keys_out_of_order);
+    RUN_TEST(put_batch_var_writes_same_pages_as_put_var);
+    return UNITY_END();
+}
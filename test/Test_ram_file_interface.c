@@ -0,0 +1,228 @@
+/******************************************************************************/
+/**
+ * @file        Test_ram_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB insertion, querying, and recovery with files kept in memory.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_DATA_PAGES 1000
+#define NUM_INDEX_PAGES 48
+#define NUM_VAR_PAGES 1000
+
+embedDBState *state;
+void *dataFile, *indexFile, *varFile;
+
+int8_t initializeState(int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = NUM_DATA_PAGES;
+    state->numIndexPages = NUM_INDEX_PAGES;
+    state->numVarPages = NUM_VAR_PAGES;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getRamFileInterface();
+    state->dataFile = dataFile;
+    state->indexFile = indexFile;
+    state->varFile = varFile;
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    return embedDBInit(state, 1);
+}
+
+void setupRamFiles(void) {
+    dataFile = setupRamFile(512, NUM_DATA_PAGES, "build/artifacts/ramDataFile.bin");
+    indexFile = setupRamFile(512, NUM_INDEX_PAGES, "build/artifacts/ramIndexFile.bin");
+    varFile = setupRamFile(512, NUM_VAR_PAGES, "build/artifacts/ramVarFile.bin");
+    TEST_ASSERT_NOT_NULL_MESSAGE(dataFile, "Unable to allocate the RAM data file.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(indexFile, "Unable to allocate the RAM index file.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varFile, "Unable to allocate the RAM var file.");
+}
+
+void tearDownRamFiles(void) {
+    tearDownRamFile(dataFile);
+    tearDownRamFile(indexFile);
+    tearDownRamFile(varFile);
+}
+
+void setUp(void) {
+    setupRamFiles();
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the RAM file interface.");
+}
+
+void closeState(void) {
+    embedDBClose(state);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void tearDown(void) {
+    closeState();
+    tearDownRamFiles();
+}
+
+void insertRecords(uint32_t numRecords) {
+    char varData[] = "Record 00";
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        varData[7] = '0' + data / 10;
+        varData[8] = '0' + data % 10;
+        int8_t result = embedDBPutVar(state, &key, &data, varData, sizeof(varData));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void checkRecord(uint32_t key) {
+    uint32_t data = 0;
+    embedDBVarDataStream *varStream = NULL;
+    char buf[16];
+    char expected[] = "Record 00";
+    expected[7] = '0' + key % 100 / 10;
+    expected[8] = '0' + key % 10;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &data, &varStream), "embedDBGetVar did not find an inserted record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGetVar returned the wrong data.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "embedDBGetVar did not return vardata");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(sizeof(expected), embedDBVarDataStreamRead(state, varStream, buf, sizeof(buf)), "Returned vardata was not the right length");
+    TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(expected, buf, sizeof(expected), "embedDBGetVar returned the wrong vardata.");
+    free(varStream);
+}
+
+void ram_get_and_iterator_return_inserted_records(void) {
+    insertRecords(5000);
+    embedDBFlush(state);
+    for (uint32_t key = 0; key < 5000; key += 7)
+        checkRecord(key);
+
+    embedDBIterator it;
+    uint32_t minData = 23, maxData = 38;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t key, data, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(50 * 16, numRecordsRead, "Iterator did not read the correct number of records");
+}
+
+void ram_files_recover_after_reopen(void) {
+    insertRecords(state->maxRecordsPerPage * 600);
+    embedDBFlush(state);
+    uint32_t expectedNextDataPage = state->nextDataPageId;
+    uint32_t expectedNextIndexPage = state->nextIdxPageId;
+    uint32_t expectedNextVarPage = state->nextVarPageId;
+    closeState();
+
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not recover from the RAM files.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextDataPage, state->nextDataPageId, "nextDataPageId was not recovered from the RAM file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextIndexPage, state->nextIdxPageId, "nextIdxPageId was not recovered from the RAM file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextVarPage, state->nextVarPageId, "nextVarPageId was not recovered from the RAM file.");
+    for (uint32_t key = state->maxRecordsPerPage * 600 - 1; key > state->maxRecordsPerPage * 500; key -= 97)
+        checkRecord(key);
+}
+
+void ram_files_load_snapshot_into_new_files(void) {
+    insertRecords(3000);
+    embedDBFlush(state);
+    uint32_t expectedNextDataPage = state->nextDataPageId;
+    uint32_t expectedNextVarPage = state->nextVarPageId;
+    tearDown();
+
+    setupRamFiles();
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not recover from the RAM file snapshots.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextDataPage, state->nextDataPageId, "nextDataPageId was not recovered from the snapshot.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextVarPage, state->nextVarPageId, "nextVarPageId was not recovered from the snapshot.");
+    for (uint32_t key = 0; key < 3000; key += 13)
+        checkRecord(key);
+}
+
+void ram_snapshot_is_readable_by_file_interface(void) {
+    insertRecords(1000);
+    embedDBFlush(state);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->sync(state->dataFile), "Saving the RAM file snapshot failed.");
+
+    embedDBFileInterface *fileInterface = getFileInterface();
+    void *file = setupFile("build/artifacts/ramDataFile.bin");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->open(file, EMBEDDB_FILE_MODE_R_PLUS_B), "Unable to open the RAM file snapshot.");
+    uint8_t page[512];
+    for (uint32_t pageNum = 0; pageNum < state->nextDataPageId; pageNum++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->read(page, pageNum, sizeof(page), file), "Reading a page from the snapshot failed.");
+        void *ramPage = state->fileInterface->mapPage(pageNum, sizeof(page), state->dataFile);
+        TEST_ASSERT_NOT_NULL_MESSAGE(ramPage, "mapPage did not return a written page.");
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(ramPage, page, sizeof(page), "Snapshot page does not match the page in memory.");
+    }
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, fileInterface->read(page, state->nextDataPageId, sizeof(page), file), "Snapshot contains pages that were not written.");
+    fileInterface->close(file);
+    tearDownFile(file);
+    free(fileInterface);
+}
+
+void ram_file_rejects_pages_past_its_size(void) {
+    uint8_t page[512] = {0};
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->write(page, NUM_INDEX_PAGES - 1, sizeof(page), state->indexFile), "Writing the last page of the RAM file failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->fileInterface->write(page, NUM_INDEX_PAGES, sizeof(page), state->indexFile), "Writing past the end of the RAM file should fail.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->fileInterface->read(page, NUM_INDEX_PAGES, sizeof(page), state->indexFile), "Reading past the end of the RAM file should fail.");
+    TEST_ASSERT_NULL_MESSAGE(state->fileInterface->mapPage(NUM_INDEX_PAGES, sizeof(page), state->indexFile), "Mapping past the end of the RAM file should fail.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(ram_get_and_iterator_return_inserted_records);
+    RUN_TEST(ram_files_recover_after_reopen);
+    RUN_TEST(ram_files_load_snapshot_into_new_files);
+    RUN_TEST(ram_snapshot_is_readable_by_file_interface);
+    RUN_TEST(ram_file_rejects_pages_past_its_size);
+    return UNITY_END();
+}
@@ -0,0 +1,239 @@
+/******************************************************************************/
+/**
+ * @file        Test_read_ahead.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test that iterators read the pages of a scan ahead of time.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/posixFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_DATA_PAGES 40
+
+embedDBState *state;
+
+/* Number of read and readPages requests made on the data file */
+uint32_t numDataRequests = 0;
+
+int8_t COUNTING_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    if (file == state->dataFile)
+        numDataRequests++;
+    return POSIX_READ(buffer, pageNum, pageSize, file);
+}
+
+uint32_t (*posixReadPages)(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+
+uint32_t COUNTING_READ_PAGES(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    if (file == state->dataFile)
+        numDataRequests++;
+    return posixReadPages(buffers, pageNum, numPages, pageSize, file);
+}
+
+/* Reads queued by COUNTING_READ_ASYNC. They are all made by COUNTING_WAIT_ASYNC as one request */
+void *queuedBuffers[UINT8_MAX];
+uint32_t queuedPageNums[UINT8_MAX];
+uint32_t numQueued = 0;
+
+int8_t COUNTING_READ_ASYNC(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    if (numQueued >= UINT8_MAX)
+        return 0;
+    queuedBuffers[numQueued] = buffer;
+    queuedPageNums[numQueued++] = pageNum;
+    return 1;
+}
+
+int32_t COUNTING_WAIT_ASYNC(int8_t *results, uint32_t maxResults, void *file) {
+    if (file == state->dataFile)
+        numDataRequests++;
+    int32_t numCompleted = 0;
+    for (uint32_t i = 0; i < numQueued && i < maxResults; i++)
+        results[numCompleted++] = POSIX_READ(queuedBuffers[i], queuedPageNums[i], state->pageSize, file);
+    numQueued = 0;
+    return numCompleted;
+}
+
+void initializeState(int8_t useAsyncReads) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 12;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getPosixFileInterface();
+    posixReadPages = state->fileInterface->readPages;
+    state->fileInterface->read = COUNTING_READ;
+    state->fileInterface->readPages = COUNTING_READ_PAGES;
+    if (useAsyncReads) {
+        state->fileInterface->readPages = NULL;
+        state->fileInterface->readAsync = COUNTING_READ_ASYNC;
+        state->fileInterface->waitAsync = COUNTING_WAIT_ASYNC;
+    }
+    char dataPath[] = "build/artifacts/dataFile.bin", indexPath[] = "build/artifacts/indexFile.bin";
+    state->dataFile = setupPosixFile(dataPath, EMBEDDB_FILE_ROLE_DATA);
+    state->indexFile = setupPosixFile(indexPath, EMBEDDB_FILE_ROLE_INDEX);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(1, state->numWindowPages, "The POSIX file interface can read several pages at once, so there should be a read window.");
+}
+
+void setUp(void) {
+    initializeState(0);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownPosixFile(state->dataFile);
+    tearDownPosixFile(state->indexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Fills numPages data pages. Records on even pages have data 5 and records on odd pages have data 75 */
+void insertPages(uint32_t numPages) {
+    uint32_t numRecords = state->maxRecordsPerPage * numPages;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = (key / state->maxRecordsPerPage) % 2 == 0 ? 5 : 75;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+    embedDBFlush(state);
+    embedDBResetStats(state);
+    numDataRequests = 0;
+}
+
+void insertRecords(void) {
+    insertPages(NUM_DATA_PAGES);
+}
+
+uint32_t runQuery(embedDBIterator *it) {
+    uint32_t key = 0, data = 0, numRecords = 0;
+    embedDBInitIterator(state, it);
+    while (embedDBNext(state, it, &key, &data))
+        numRecords++;
+    embedDBCloseIterator(it);
+    return numRecords;
+}
+
+void read_ahead_reads_long_scan_in_few_requests(void) {
+    insertRecords();
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage * NUM_DATA_PAGES, runQuery(&it), "Scan did not return every record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(NUM_DATA_PAGES, state->numReads, "Each data page should be read once by the scan.");
+    TEST_ASSERT_TRUE_MESSAGE(numDataRequests <= NUM_DATA_PAGES / 4, "Scan did not read pages ahead in batches.");
+}
+
+void read_ahead_does_not_read_past_short_range(void) {
+    insertRecords();
+    uint32_t minKey = 0, maxKey = 10;
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = &maxKey;
+    it.minData = NULL;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(11, runQuery(&it), "Range query returned the wrong number of records.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, state->numReads, "A range on one page should read only that page.");
+}
+
+void read_ahead_grows_with_scan_length(void) {
+    insertRecords();
+    uint32_t minKey = 0, maxKey = state->maxRecordsPerPage * 3 - 1;
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = &maxKey;
+    it.minData = NULL;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(maxKey + 1, runQuery(&it), "Range query returned the wrong number of records.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(3, state->numReads, "A range on three pages should read three pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, numDataRequests, "The first page should be read alone and the next two together.");
+}
+
+void read_ahead_skips_pages_ruled_out_by_bitmap(void) {
+    /* Pages that are not next to each other can only be read in one request asynchronously */
+    tearDown();
+    initializeState(1);
+    insertRecords();
+    int32_t minData = 70, maxData = 80;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage * NUM_DATA_PAGES / 2, runQuery(&it), "Filtered scan returned the wrong number of records.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(NUM_DATA_PAGES / 2, state->numReads, "Read-ahead should not read pages the bitmap rules out.");
+    TEST_ASSERT_TRUE_MESSAGE(numDataRequests <= NUM_DATA_PAGES / 4, "Filtered scan did not read pages ahead in batches.");
+}
+
+void read_ahead_window_can_be_larger_than_255_pages(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetBufferPoolSize(state, 400), "Failed to set the buffer pool size.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(400, state->numWindowPages, "The read window should cover the whole buffer pool.");
+    insertPages(600);
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->maxRecordsPerPage * 600, runQuery(&it), "Scan did not return every record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(600, state->numReads, "Each data page should be read once by the scan.");
+    /* Requests of 1, 2, 4, ... 256 pages, then 400 page requests */
+    TEST_ASSERT_TRUE_MESSAGE(numDataRequests <= 11, "Read-ahead did not grow past 255 pages.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(read_ahead_reads_long_scan_in_few_requests);
+    RUN_TEST(read_ahead_does_not_read_past_short_range);
+    RUN_TEST(read_ahead_grows_with_scan_length);
+    RUN_TEST(read_ahead_skips_pages_ruled_out_by_bitmap);
+    RUN_TEST(read_ahead_window_can_be_larger_than_255_pages);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+/******************************************************************************/
+/**
+ * @file        Test_recovery_search.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test and benchmark finding the newest pages of each file when a database is reopened.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_DATA_PAGES 1000
+
+char dataPath[] = "build/artifacts/dataFile.bin";
+char indexPath[] = "build/artifacts/indexFile.bin";
+char varPath[] = "build/artifacts/varFile.bin";
+
+embedDBState *state;
+
+/* Pages read from each file */
+uint32_t numDataFileReads = 0, numIndexFileReads = 0, numVarFileReads = 0;
+
+int8_t (*fileRead)(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+
+int8_t COUNTING_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    if (file == state->dataFile)
+        numDataFileReads++;
+    else if (file == state->indexFile)
+        numIndexFileReads++;
+    else if (file == state->varFile)
+        numVarFileReads++;
+    return fileRead(buffer, pageNum, pageSize, file);
+}
+
+void openState(int8_t reset) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = NUM_DATA_PAGES;
+    state->numIndexPages = 4;
+    state->numVarPages = 400;
+    state->eraseSizeInPages = 2;
+    state->fileInterface = getFileInterface();
+    fileRead = state->fileInterface->read;
+    state->fileInterface->read = COUNTING_READ;
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->varFile = setupFile(varPath);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | (reset ? EMBEDDB_RESET_DATA : 0);
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    numDataFileReads = numIndexFileReads = numVarFileReads = 0;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void closeState(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    tearDownFile(state->varFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+/* Recovered position of each file */
+typedef struct {
+    id_t nextDataPageId, minDataPageId, numAvailDataPages;
+    id_t nextIdxPageId, minIndexPageId, numAvailIndexPages;
+    id_t nextVarPageId;
+} filePositions;
+
+filePositions getPositions(void) {
+    filePositions positions = {state->nextDataPageId, state->minDataPageId, state->numAvailDataPages,
+                               state->nextIdxPageId, state->minIndexPageId, state->numAvailIndexPages,
+                               state->nextVarPageId};
+    return positions;
+}
+
+/* Writes numPages data pages of records, each with variable data, and returns where each file is */
+filePositions writePages(uint32_t numPages) {
+    openState(1);
+    char variableData[] = "Variable data";
+    uint32_t numRecords = state->maxRecordsPerPage * numPages;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutVar(state, &key, &data, variableData, sizeof(variableData)), "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+    if (numPages > 0)
+        embedDBFlush(state);
+    filePositions positions = getPositions();
+    closeState();
+    return positions;
+}
+
+void assertPositionsEqual(filePositions expected) {
+    filePositions actual = getPositions();
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.nextDataPageId, actual.nextDataPageId, "Recovered the wrong next data page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.minDataPageId, actual.minDataPageId, "Recovered the wrong oldest data page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.numAvailDataPages, actual.numAvailDataPages, "Recovered the wrong number of free data pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.nextIdxPageId, actual.nextIdxPageId, "Recovered the wrong next index page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.minIndexPageId, actual.minIndexPageId, "Recovered the wrong oldest index page.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.numAvailIndexPages, actual.numAvailIndexPages, "Recovered the wrong number of free index pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.nextVarPageId, actual.nextVarPageId, "Recovered the wrong next variable data page.");
+}
+
+/* Reopens the database, checks where each file was recovered to and prints how long that took */
+void recoverAndReport(const char *name, filePositions expected) {
+    clock_t start = clock();
+    openState(0);
+    clock_t elapsed = clock() - start;
+    printf("Recovery of %s files: %u data, %u index and %u variable data page reads in %.3f ms\n", name, numDataFileReads, numIndexFileReads,
+           numVarFileReads, elapsed * 1000.0 / CLOCKS_PER_SEC);
+    assertPositionsEqual(expected);
+
+    /* A binary search for the end of the newest pages, plus the pages around it that are checked and read again */
+    uint32_t maxReads = 2 * (uint32_t)ceil(log2(NUM_DATA_PAGES)) + 8;
+    TEST_ASSERT_TRUE_MESSAGE(numDataFileReads <= maxReads, "Recovering the data file should not read every page.");
+    TEST_ASSERT_TRUE_MESSAGE(numVarFileReads <= maxReads, "Recovering the variable data file should not read every page.");
+}
+
+void recovery_of_empty_files(void) {
+    filePositions expected = writePages(0);
+    recoverAndReport("empty", expected);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->nextDataPageId, "An empty data file should have no pages.");
+    closeState();
+}
+
+void recovery_of_partly_filled_files(void) {
+    filePositions expected = writePages(NUM_DATA_PAGES / 3);
+    recoverAndReport("partly filled", expected);
+    uint32_t key = 1234, data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a key after recovery.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1234 % 100, data, "embedDBGet returned the wrong data after recovery.");
+    closeState();
+}
+
+void recovery_of_wrapped_files(void) {
+    filePositions expected = writePages(NUM_DATA_PAGES * 5 / 2);
+    TEST_ASSERT_TRUE_MESSAGE(expected.minDataPageId > 0 && expected.minIndexPageId > 0, "Data and index files should have wrapped.");
+    recoverAndReport("wrapped", expected);
+    uint32_t key = state->maxRecordsPerPage * (NUM_DATA_PAGES * 5 / 2) - 10, data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a key after recovery.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data after recovery.");
+    closeState();
+}
+
+/* Writes a page with the given logical id to a physical page of the data file */
+void writeDataPage(id_t physicalPageId, id_t logicalPageId) {
+    uint8_t page[512] = {0};
+    memcpy(page, &logicalPageId, sizeof(id_t));
+    FILE *file = fopen(dataPath, "r+b");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "Failed to open the data file.");
+    fseek(file, (long)physicalPageId * sizeof(page), SEEK_SET);
+    fwrite(page, sizeof(page), 1, file);
+    fclose(file);
+}
+
+void recovery_reads_each_page_when_pages_are_out_of_order(void) {
+    filePositions expected = writePages(NUM_DATA_PAGES / 3);
+
+    /* A page after the newest page that is neither unwritten nor older data */
+    writeDataPage(expected.nextDataPageId, 12345);
+    openState(0);
+    assertPositionsEqual(expected);
+    TEST_ASSERT_TRUE_MESSAGE(numDataFileReads >= expected.nextDataPageId, "Recovery should read each page when the pages are not in order.");
+    closeState();
+
+    /* Pages further on, including the last page, that look like they continue the newest pages */
+    expected = writePages(NUM_DATA_PAGES / 3);
+    writeDataPage(NUM_DATA_PAGES / 2, NUM_DATA_PAGES / 2);
+    writeDataPage(NUM_DATA_PAGES - 1, NUM_DATA_PAGES - 1);
+    openState(0);
+    assertPositionsEqual(expected);
+    TEST_ASSERT_TRUE_MESSAGE(numDataFileReads >= expected.nextDataPageId, "Recovery should read each page when the pages are not in order.");
+    closeState();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(recovery_of_empty_files);
+    RUN_TEST(recovery_of_partly_filled_files);
+    RUN_TEST(recovery_of_wrapped_files);
+    RUN_TEST(recovery_reads_each_page_when_pages_are_out_of_order);
+    return UNITY_END();
+}
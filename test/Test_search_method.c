@@ -0,0 +1,174 @@
+/******************************************************************************/
+/**
+ * @file        Test_search_method.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test choosing the search method of each EmbedDB state at run time.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_RECORDS 5000
+
+embedDBState *state;
+
+embedDBState *createState(char *dataPath) {
+    embedDBState *newState = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(newState, "Unable to allocate EmbedDB state.");
+    newState->keySize = 4;
+    newState->dataSize = 4;
+    newState->pageSize = 512;
+    newState->bufferSizeInBlocks = 4;
+    newState->numSplinePoints = 300;
+    newState->buffer = calloc(1, (size_t)newState->pageSize * newState->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(newState->buffer, "Failed to allocate buffer for EmbedDB.");
+    newState->numDataPages = 1000;
+    newState->eraseSizeInPages = 4;
+    newState->fileInterface = getFileInterface();
+    newState->dataFile = setupFile(dataPath);
+    newState->parameters = EMBEDDB_RESET_DATA;
+    newState->compareKey = int32Comparator;
+    newState->compareData = int32Comparator;
+    int8_t result = embedDBInit(newState, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+    embedDBResetStats(newState);
+    return newState;
+}
+
+void destroyState(embedDBState *oldState) {
+    embedDBClose(oldState);
+    tearDownFile(oldState->dataFile);
+    free(oldState->buffer);
+    free(oldState->fileInterface);
+    free(oldState);
+}
+
+void setUp(void) {
+    state = createState("build/artifacts/dataFile.bin");
+}
+
+void tearDown(void) {
+    destroyState(state);
+}
+
+/* Keys are spread unevenly so that the spline needs several points */
+uint32_t keyForRecord(uint32_t i) {
+    return i < NUM_RECORDS / 2 ? i * 2 : i * 50;
+}
+
+void insertRecords(embedDBState *db) {
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        uint32_t key = keyForRecord(i), data = i;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(db, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void checkQueries(embedDBState *db) {
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        uint32_t key = keyForRecord(i), data = 0;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(db, &key, &data), "embedDBGet did not find a record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(i, data, "embedDBGet returned the wrong data.");
+    }
+    uint32_t missingKey = keyForRecord(NUM_RECORDS / 2) + 1, data = 0;
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBGet(db, &missingKey, &data), "embedDBGet found a key that was not inserted.");
+
+    uint32_t minKey = keyForRecord(NUM_RECORDS - 100), key = 0, numRecords = 0;
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(db, &it);
+    while (embedDBNext(db, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(keyForRecord(NUM_RECORDS - 100 + numRecords), key, "Iterator returned the wrong key.");
+        numRecords++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(100, numRecords, "Iterator returned the wrong number of records.");
+}
+
+void binary_searches_do_not_allocate_a_spline(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetSearchMethod(state, EMBEDDB_SEARCH_BINARY, 0), "Failed to set the search method.");
+    TEST_ASSERT_NULL_MESSAGE(state->spl, "Binary search should not have a spline.");
+    insertRecords(state);
+    checkQueries(state);
+
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetSearchMethod(state, EMBEDDB_SEARCH_MODIFIED_BINARY, 0), "Failed to set the search method.");
+    TEST_ASSERT_NULL_MESSAGE(state->spl, "Modified binary search should not have a spline.");
+    checkQueries(state);
+}
+
+void radix_spline_is_built_from_existing_pages(void) {
+    insertRecords(state);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetSearchMethod(state, EMBEDDB_SEARCH_SPLINE, 6), "Failed to set the search method.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->rdix, "Radix spline was not allocated.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->spl->count, state->rdix->pointsSeen, "Radix table should cover every point of the spline.");
+    checkQueries(state);
+
+    /* Pages written after the change are added to the radix spline */
+    uint32_t key = keyForRecord(NUM_RECORDS) * 2, data = 7;
+    for (uint32_t i = 0; i < 1000; i++, key += 3)
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    key -= 3 * 500;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record inserted after the change.");
+}
+
+void states_can_use_different_search_methods(void) {
+    embedDBState *other = createState("build/artifacts/otherDataFile.bin");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetSearchMethod(other, EMBEDDB_SEARCH_BINARY, 0), "Failed to set the search method.");
+    insertRecords(state);
+    insertRecords(other);
+
+    checkQueries(state);
+    checkQueries(other);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->spl, "The default search method should use a spline.");
+    TEST_ASSERT_NULL_MESSAGE(other->spl, "Binary search should not have a spline.");
+    destroyState(other);
+}
+
+void unknown_search_method_is_rejected(void) {
+    insertRecords(state);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBSetSearchMethod(state, 7, 0), "An unknown search method was accepted.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->spl, "The spline should be kept when a search method is rejected.");
+    checkQueries(state);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(binary_searches_do_not_allocate_a_spline);
+    RUN_TEST(radix_spline_is_built_from_existing_pages);
+    RUN_TEST(states_can_use_different_search_methods);
+    RUN_TEST(unknown_search_method_is_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+/******************************************************************************/
+/**
+ * @file        Test_simulated_flash_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB insertion, querying, and recovery on a simulated flash device.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/simulatedFlashFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define PAGE_SIZE 512
+#define ERASE_SIZE 4
+#define NUM_DATA_PAGES 64
+#define NUM_INDEX_PAGES 16
+#define NUM_VAR_PAGES 64
+
+embedDBState *state;
+void *dataFile, *indexFile, *varFile;
+simulatedFlashTiming timing = {.readTimeInMicros = 1000, .writeTimeInMicros = 14000, .eraseTimeInMicros = 45000};
+
+int8_t initializeState(int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = PAGE_SIZE;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = NUM_DATA_PAGES;
+    state->numIndexPages = NUM_INDEX_PAGES;
+    state->numVarPages = NUM_VAR_PAGES;
+    state->eraseSizeInPages = ERASE_SIZE;
+    state->fileInterface = getSimulatedFlashFileInterface();
+    state->dataFile = dataFile;
+    state->indexFile = indexFile;
+    state->varFile = varFile;
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    return embedDBInit(state, 1);
+}
+
+void setUp(void) {
+    dataFile = setupSimulatedFlash(PAGE_SIZE, NUM_DATA_PAGES, ERASE_SIZE, &timing);
+    indexFile = setupSimulatedFlash(PAGE_SIZE, NUM_INDEX_PAGES, ERASE_SIZE, &timing);
+    varFile = setupSimulatedFlash(PAGE_SIZE, NUM_VAR_PAGES, ERASE_SIZE, &timing);
+    TEST_ASSERT_NOT_NULL_MESSAGE(dataFile, "Unable to allocate the simulated data device.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(indexFile, "Unable to allocate the simulated index device.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varFile, "Unable to allocate the simulated var device.");
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the simulated flash interface.");
+}
+
+void closeState(void) {
+    embedDBClose(state);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void tearDown(void) {
+    closeState();
+    tearDownSimulatedFlash(dataFile);
+    tearDownSimulatedFlash(indexFile);
+    tearDownSimulatedFlash(varFile);
+}
+
+void insertRecords(uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void checkRecords(uint32_t minKey, uint32_t maxKey) {
+    uint32_t data = 0;
+    for (uint32_t key = minKey; key < maxKey; key += 7) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find an inserted record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data.");
+    }
+}
+
+void simulated_flash_wraps_without_breaking_program_rules(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * NUM_DATA_PAGES * 5;
+    insertRecords(numRecords);
+    embedDBFlush(state);
+    checkRecords(numRecords - state->maxRecordsPerPage * (NUM_DATA_PAGES - ERASE_SIZE), numRecords);
+
+    simulatedFlashStats stats;
+    getSimulatedFlashStats(dataFile, &stats);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, stats.numViolations, "EmbedDB wrote a data page that was not erased.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->nextDataPageId, stats.numWrites, "Every data page should be programmed once.");
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, stats.numErases, "Wrapping the data file should erase blocks.");
+    TEST_ASSERT_TRUE_MESSAGE(stats.maxBlockErases - stats.minBlockErases <= 1, "Blocks of the data file should wear evenly.");
+    uint64_t expectedTime = (uint64_t)stats.numReads * timing.readTimeInMicros + (uint64_t)stats.numWrites * timing.writeTimeInMicros + (uint64_t)stats.numErases * timing.eraseTimeInMicros;
+    TEST_ASSERT_TRUE_MESSAGE(expectedTime == stats.elapsedTimeInMicros, "Simulated time does not match the operations performed.");
+
+    getSimulatedFlashStats(indexFile, &stats);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, stats.numViolations, "EmbedDB wrote an index page that was not erased.");
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, stats.numWrites, "Test should write index pages.");
+}
+
+void simulated_flash_recovers_after_wrapping(void) {
+    uint32_t numRecords = state->maxRecordsPerPage * NUM_DATA_PAGES * 3 + 17;
+    insertRecords(numRecords);
+    embedDBFlush(state);
+    uint32_t expectedNextDataPage = state->nextDataPageId;
+    uint32_t expectedNextIndexPage = state->nextIdxPageId;
+    closeState();
+
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not recover from the simulated flash.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextDataPage, state->nextDataPageId, "nextDataPageId was not recovered from the simulated flash.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextIndexPage, state->nextIdxPageId, "nextIdxPageId was not recovered from the simulated flash.");
+    checkRecords(numRecords - state->maxRecordsPerPage * (NUM_DATA_PAGES - ERASE_SIZE), numRecords);
+
+    uint32_t key = numRecords, data = 7;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut failed after recovery.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed after recovery.");
+    simulatedFlashStats stats;
+    getSimulatedFlashStats(dataFile, &stats);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, stats.numViolations, "EmbedDB wrote a data page that was not erased after recovery.");
+}
+
+void simulated_flash_enforces_program_and_erase_rules(void) {
+    uint8_t page[PAGE_SIZE];
+    memset(page, 0xAB, sizeof(page));
+    embedDBFileInterface *fileInterface = state->fileInterface;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, fileInterface->read(page, 5, PAGE_SIZE, varFile), "Reading an erased page should fail.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->write(page, 5, PAGE_SIZE, varFile), "Programming an erased page failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, fileInterface->write(page, 5, PAGE_SIZE, varFile), "Programming a page twice should fail.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, fileInterface->erase(5, ERASE_SIZE, PAGE_SIZE, varFile), "Erasing part of two erase blocks should fail.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->read(page, 5, PAGE_SIZE, varFile), "Reading a programmed page failed.");
+
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->erase(4, ERASE_SIZE, PAGE_SIZE, varFile), "Erasing an erase block failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, fileInterface->read(page, 5, PAGE_SIZE, varFile), "Reading a page after its block was erased should fail.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, fileInterface->write(page, 5, PAGE_SIZE, varFile), "Programming a page after its block was erased failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, fileInterface->write(page, NUM_VAR_PAGES, PAGE_SIZE, varFile), "Programming past the end of the device should fail.");
+
+    simulatedFlashStats stats;
+    getSimulatedFlashStats(varFile, &stats);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, stats.numViolations, "Both broken rules should be counted.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, stats.numWrites, "Only successful programs should be counted.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, stats.numErases, "Only successful erases should be counted.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, getSimulatedFlashBlockErases(varFile, 1), "The erased block should have one erase.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, getSimulatedFlashBlockErases(varFile, 0), "Other blocks should not be erased.");
+}
+
+void simulated_flash_reports_rewriting_partial_pages(void) {
+    closeState();
+    int8_t result = initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_REWRITE_PARTIAL_PAGES | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the simulated flash interface.");
+    insertRecords(3);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "Writing a partial page to an erased page failed.");
+    uint32_t key = 3, data = 3;
+    embedDBPut(state, &key, &data);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, embedDBFlush(state), "Flash cannot rewrite a partial page in place.");
+
+    simulatedFlashStats stats;
+    getSimulatedFlashStats(dataFile, &stats);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, stats.numViolations, "Rewriting a partial page should be counted as a violation.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(simulated_flash_wraps_without_breaking_program_rules);
+    RUN_TEST(simulated_flash_recovers_after_wrapping);
+    RUN_TEST(simulated_flash_enforces_program_and_erase_rules);
+    RUN_TEST(simulated_flash_reports_rewriting_partial_pages);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+/******************************************************************************/
+/**
+ * @file        Test_spline_checkpoint.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test that the spline is restored from its checkpoints when a database is reopened.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_DATA_PAGES 65
+#define CHECKPOINT_EVERY_PAGES 10
+
+char dataPath[] = "build/artifacts/dataFile.bin";
+char otherDataPath[] = "build/artifacts/otherDataFile.bin";
+char splinePath[] = "build/artifacts/splineFile.bin";
+
+embedDBState *state;
+
+/* Opens the database in dataFilePath and sets up its spline checkpoints. Stats count the reads made by the spline restore */
+void openState(char *dataFilePath, int8_t reset, uint8_t radixBits) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataFilePath);
+    state->parameters = reset ? EMBEDDB_RESET_DATA : 0;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+    if (radixBits > 0)
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetSearchMethod(state, EMBEDDB_SEARCH_SPLINE, radixBits), "Failed to set up the radix spline.");
+    embedDBResetStats(state);
+    result = embedDBSetSplineCheckpoint(state, setupFile(splinePath), CHECKPOINT_EVERY_PAGES);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "Failed to set up spline checkpoints.");
+}
+
+void closeState(void) {
+    void *splineFile = state->splineFile;
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(splineFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Closes the database without the checkpoint embedDBClose writes, as if power was lost */
+void crashState(void) {
+    state->fileInterface->close(state->splineFile);
+    tearDownFile(state->splineFile);
+    state->splineFile = NULL;
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void setUp(void) {
+    remove(splinePath);
+}
+
+void tearDown(void) {
+}
+
+/* Fills NUM_DATA_PAGES data pages with keys spaced by keyStep so that the spline needs several points */
+void insertRecords(uint32_t keyStep) {
+    uint32_t numRecords = state->maxRecordsPerPage * NUM_DATA_PAGES;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t key = i * keyStep + (i / 100) * (i / 100), data = i;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+    embedDBFlush(state);
+}
+
+void checkRecords(uint32_t keyStep) {
+    uint32_t numRecords = state->maxRecordsPerPage * NUM_DATA_PAGES;
+    for (uint32_t i = 0; i < numRecords; i += 7) {
+        uint32_t key = i * keyStep + (i / 100) * (i / 100), data = 0;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a key after restart.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(i, data, "embedDBGet returned the wrong data after restart.");
+    }
+}
+
+/* Overwrites a byte of a checkpoint slot after its header, as a torn write would */
+void corruptSlot(uint32_t slot, id_t slotPages) {
+    FILE *file = fopen(splinePath, "r+b");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "Failed to open the spline file.");
+    long offset = (long)slot * slotPages * 512 + 36;
+    uint8_t byte = 0;
+    fseek(file, offset, SEEK_SET);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, fread(&byte, 1, 1, file), "Failed to read the spline file.");
+    byte ^= 0xFF;
+    fseek(file, offset, SEEK_SET);
+    fwrite(&byte, 1, 1, file);
+    fclose(file);
+}
+
+void spline_checkpoint_restart_reads_no_data_pages(void) {
+    openState(dataPath, 1, 0);
+    insertRecords(3);
+    uint32_t numPoints = state->spl->count;
+    closeState();
+
+    openState(dataPath, 0, 0);
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads <= 1, "Restoring the checkpoint taken at close should only read the page it checks.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numPoints, state->spl->count, "Restored spline has the wrong number of points.");
+    checkRecords(3);
+    closeState();
+}
+
+void spline_checkpoint_restart_reads_pages_written_after_checkpoint(void) {
+    openState(dataPath, 1, 0);
+    insertRecords(3);
+    id_t numPagesAfterCheckpoint = state->nextDataPageId - state->splineCheckpointPageId;
+    TEST_ASSERT_TRUE_MESSAGE(numPagesAfterCheckpoint > 0 && numPagesAfterCheckpoint < CHECKPOINT_EVERY_PAGES, "Spline was not checkpointed as pages were written.");
+    crashState();
+
+    openState(dataPath, 0, 0);
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads <= 1 + numPagesAfterCheckpoint, "Only the pages written after the last checkpoint should be read.");
+    checkRecords(3);
+
+    /* Writing after the restore adds to the restored spline */
+    uint32_t key = 1000000, data = 99;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    embedDBFlush(state);
+    data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "Record written after the restore was not found.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(99, data, "embedDBGet returned the wrong data for the record written after the restore.");
+    closeState();
+}
+
+void spline_checkpoint_falls_back_to_other_slot_then_full_rebuild(void) {
+    openState(dataPath, 1, 0);
+    insertRecords(3);
+    uint32_t newestSlot = state->splineCheckpointSequence % 2;
+    id_t slotPages = state->splineCheckpointSlotPages;
+    id_t previousCheckpointPageId = state->splineCheckpointPageId;
+    id_t numPages = state->nextDataPageId;
+    closeState();
+
+    corruptSlot(newestSlot, slotPages);
+    openState(dataPath, 0, 0);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(previousCheckpointPageId, state->splineCheckpointPageId, "A torn checkpoint should fall back to the previous one.");
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads <= 1 + numPages - previousCheckpointPageId, "Only the pages written after the previous checkpoint should be read.");
+    checkRecords(3);
+    crashState();
+
+    corruptSlot(1 - newestSlot, slotPages);
+    openState(dataPath, 0, 0);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->splineCheckpointPageId, "No checkpoint should be restored when both are torn.");
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads >= numPages - 1, "With no usable checkpoint the spline should be rebuilt from every page.");
+    checkRecords(3);
+    closeState();
+}
+
+void spline_checkpoint_restores_radix_table(void) {
+    openState(dataPath, 1, 8);
+    insertRecords(5);
+    closeState();
+
+    openState(dataPath, 0, 8);
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads <= 1, "Restoring the radix spline should only read the page it checks.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->rdix->table, "Radix table was not restored.");
+    checkRecords(5);
+    closeState();
+}
+
+void spline_checkpoint_of_other_data_is_not_used(void) {
+    /* Same number of pages with different keys */
+    openState(otherDataPath, 1, 0);
+    insertRecords(4);
+    crashState();
+
+    remove(splinePath);
+    openState(dataPath, 1, 0);
+    insertRecords(3);
+    closeState();
+
+    openState(otherDataPath, 0, 0);
+    TEST_ASSERT_TRUE_MESSAGE(state->numReads >= NUM_DATA_PAGES - 1, "A checkpoint that does not match the data should not be used.");
+    checkRecords(4);
+    closeState();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(spline_checkpoint_restart_reads_no_data_pages);
+    RUN_TEST(spline_checkpoint_restart_reads_pages_written_after_checkpoint);
+    RUN_TEST(spline_checkpoint_falls_back_to_other_slot_then_full_rebuild);
+    RUN_TEST(spline_checkpoint_restores_radix_table);
+    RUN_TEST(spline_checkpoint_of_other_data_is_not_used);
+    return UNITY_END();
+}
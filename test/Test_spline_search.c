@@ -0,0 +1,235 @@
+/******************************************************************************/
+/**
+ * @file        Test_spline_search.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test and time the search of spline points against the recursive search and the radix table.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/spline/radixspline.h"
+#include "../src/spline/spline.h"
+#include "unity.h"
+
+#define NUM_KEYS 200000
+#define NUM_POINTS 60000
+#define MAX_ERROR 2
+#define NUM_LOOKUPS 1000000
+
+spline *spl;
+uint64_t *keys;
+
+/* Gaps between keys vary, so that most keys start a new spline segment */
+void generateKeys(void) {
+    keys = (uint64_t *)malloc(sizeof(uint64_t) * NUM_KEYS);
+    TEST_ASSERT_NOT_NULL_MESSAGE(keys, "Unable to allocate keys.");
+    uint64_t key = 1000;
+    uint32_t seed = 7;
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 1103515245 + 12345;
+        key += 1 + (seed >> 16) % 200;
+        keys[i] = key;
+    }
+}
+
+void setUp(void) {
+    generateKeys();
+    spl = (spline *)malloc(sizeof(spline));
+    TEST_ASSERT_NOT_NULL_MESSAGE(spl, "Unable to allocate spline.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, splineInit(spl, NUM_POINTS, MAX_ERROR, sizeof(uint64_t)), "Spline failed to init.");
+}
+
+void tearDown(void) {
+    splineClose(spl);
+    free(spl);
+    free(keys);
+}
+
+int8_t uint64Comparator(void *a, void *b) {
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(uint64_t));
+    memcpy(&y, b, sizeof(uint64_t));
+    return (x > y) - (x < y);
+}
+
+/* The recursive search spline points used before, kept to compare against */
+size_t recursivePointsSearch(spline *spl, int low, int high, void *key, int8_t compareKey(void *, void *)) {
+    int32_t mid;
+    if (high >= low) {
+        mid = low + (high - low) / 2;
+        if (mid == 0)
+            return 1;
+        void *midSplinePoint = splinePointLocation(spl, mid);
+        void *midSplineMinusOnePoint = splinePointLocation(spl, mid - 1);
+        if (compareKey(midSplinePoint, key) >= 0 && compareKey(midSplineMinusOnePoint, key) <= 0)
+            return mid;
+        if (compareKey(midSplinePoint, key) > 0)
+            return recursivePointsSearch(spl, low, mid - 1, key, compareKey);
+        return recursivePointsSearch(spl, mid + 1, high, key, compareKey);
+    }
+    mid = low + (high - low) / 2;
+    return mid >= high ? high : low;
+}
+
+uint64_t pointKey(size_t pointIndex) {
+    uint64_t key = 0;
+    memcpy(&key, splinePointLocation(spl, pointIndex), sizeof(uint64_t));
+    return key;
+}
+
+/* Checks that the search returns the segment holding key, searching only the points in [low, high] */
+void checkSegment(size_t low, size_t high, uint64_t key) {
+    size_t index = pointsBinarySearch(spl, low, high, &key);
+    TEST_ASSERT_TRUE_MESSAGE(index >= low && index <= high, "Search returned a point outside its bounds.");
+    TEST_ASSERT_TRUE_MESSAGE(index >= 1, "Search returned the first point, which is not the end of a segment.");
+    TEST_ASSERT_TRUE_MESSAGE(pointKey(index - 1) <= key && pointKey(index) >= key, "Search returned the wrong segment.");
+}
+
+void search_finds_segment_of_every_key(void) {
+    for (uint32_t i = 0; i < NUM_KEYS / 4; i++)
+        splineAdd(spl, &keys[i], i);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(NUM_KEYS / 20, spl->count, "Keys should make many spline points.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, spl->pointsStartIndex, "Points should not have wrapped yet.");
+    uint64_t lastKey = pointKey(spl->count - 1);
+    for (uint64_t key = pointKey(0); key <= lastKey; key += 3)
+        checkSegment(0, spl->count - 1, key);
+    for (size_t i = 0; i < spl->count; i++)
+        checkSegment(0, spl->count - 1, pointKey(i));
+}
+
+void search_finds_segment_after_points_wrap(void) {
+    /* Filling the spline erases points from the front, so the points wrap around the end of the array */
+    for (uint32_t i = 0; i < NUM_KEYS; i++)
+        splineAdd(spl, &keys[i], i);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, spl->pointsStartIndex, "Points should have wrapped.");
+    size_t wrap = spl->size - spl->pointsStartIndex;
+    TEST_ASSERT_TRUE_MESSAGE(wrap < spl->count, "Points should be on both sides of the end of the array.");
+    uint64_t lastKey = pointKey(spl->count - 1);
+    for (uint64_t key = pointKey(0); key <= lastKey; key += 7)
+        checkSegment(0, spl->count - 1, key);
+    /* Ranges ending at, starting at and crossing the end of the array */
+    for (size_t i = wrap - 3; i <= wrap + 3; i++) {
+        checkSegment(1, wrap, pointKey(i > wrap ? wrap : i));
+        checkSegment(wrap, spl->count - 1, pointKey(i < wrap ? wrap : i));
+        checkSegment(wrap - 10, wrap + 10, pointKey(i));
+        checkSegment(wrap - 10, wrap + 10, pointKey(i) + 1);
+    }
+}
+
+/* Times lookups with each search and prints the times. Only the results are checked, as the times depend on the machine */
+void search_agrees_with_recursive_search_and_radix_table(void) {
+    /* Nearly every key is a spline point, so this many keys fill the splines without erasing points the radix table indexes */
+    uint32_t numKeys = NUM_POINTS - 1;
+    for (uint32_t i = 0; i < numKeys; i++)
+        splineAdd(spl, &keys[i], i);
+
+    spline *radixSpline = (spline *)malloc(sizeof(spline));
+    TEST_ASSERT_NOT_NULL_MESSAGE(radixSpline, "Unable to allocate spline.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, splineInit(radixSpline, NUM_POINTS, MAX_ERROR, sizeof(uint64_t)), "Spline failed to init.");
+    radixspline rsidx;
+    radixsplineInit(&rsidx, radixSpline, 16, sizeof(uint64_t));
+    for (uint32_t i = 0; i < numKeys; i++)
+        radixsplineAddPoint(&rsidx, &keys[i], i);
+    TEST_ASSERT_TRUE_MESSAGE(spl->pointsStartIndex == 0 && radixSpline->pointsStartIndex == 0, "Splines should not have erased points.");
+
+    uint32_t seed = 11;
+    size_t checksum = 0, recursiveChecksum = 0;
+    id_t loc, low, high, pageSum = 0;
+
+    clock_t start = clock();
+    for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint64_t key = keys[(seed >> 8) % numKeys];
+        recursiveChecksum += recursivePointsSearch(spl, 0, spl->count - 1, &key, uint64Comparator);
+    }
+    clock_t recursiveTime = clock() - start;
+
+    seed = 11;
+    start = clock();
+    for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint64_t key = keys[(seed >> 8) % numKeys];
+        checksum += pointsBinarySearch(spl, 0, spl->count - 1, &key);
+    }
+    clock_t searchTime = clock() - start;
+
+    seed = 11;
+    start = clock();
+    for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        splineFind(spl, &keys[(seed >> 8) % numKeys], uint64Comparator, &loc, &low, &high);
+        pageSum += loc;
+    }
+    clock_t splineTime = clock() - start;
+
+    seed = 11;
+    start = clock();
+    for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        radixsplineFind(&rsidx, &keys[(seed >> 8) % numKeys], uint64Comparator, &loc, &low, &high);
+        pageSum += loc;
+    }
+    clock_t radixTime = clock() - start;
+
+    printf("Spline points: %lu  Lookups: %u\n", (unsigned long)spl->count, NUM_LOOKUPS);
+    printf("Points search: recursive %lu ms, branchless %lu ms\n", (unsigned long)(recursiveTime * 1000 / CLOCKS_PER_SEC),
+           (unsigned long)(searchTime * 1000 / CLOCKS_PER_SEC));
+    printf("Page estimate: spline %lu ms, radix table %lu ms\n", (unsigned long)(splineTime * 1000 / CLOCKS_PER_SEC),
+           (unsigned long)(radixTime * 1000 / CLOCKS_PER_SEC));
+
+    /* Keys are spline points or inside a segment, where both searches must return the same segment end */
+    for (uint32_t i = 0; i < numKeys; i++) {
+        uint64_t key = keys[i];
+        size_t index = pointsBinarySearch(spl, 0, spl->count - 1, &key);
+        size_t recursiveIndex = recursivePointsSearch(spl, 0, spl->count - 1, &key, uint64Comparator);
+        if (index != recursiveIndex)
+            TEST_ASSERT_EQUAL_UINT64_MESSAGE(pointKey(index), key, "Searches disagree on a key that is not a spline point.");
+        splineFind(spl, &key, uint64Comparator, &loc, &low, &high);
+        TEST_ASSERT_TRUE_MESSAGE(low <= i && i <= high, "Spline bounds do not hold the key.");
+        radixsplineFind(&rsidx, &key, uint64Comparator, &loc, &low, &high);
+        TEST_ASSERT_TRUE_MESSAGE(low <= i && i <= high, "Radix spline bounds do not hold the key.");
+    }
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, checksum + recursiveChecksum + pageSum, "Lookups were not run.");
+
+    /* Also frees radixSpline */
+    radixsplineClose(&rsidx);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(search_finds_segment_of_every_key);
+    RUN_TEST(search_finds_segment_after_points_wrap);
+    RUN_TEST(search_agrees_with_recursive_search_and_radix_table);
+    return UNITY_END();
+}
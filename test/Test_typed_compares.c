@@ -0,0 +1,195 @@
+/******************************************************************************/
+/**
+ * @file        Test_typed_compares.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test that keys and data of known types are compared without the comparators.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_RECORDS 4000
+
+embedDBState *state;
+
+uint32_t numKeyCompares = 0;
+uint32_t numDataCompares = 0;
+
+int8_t countingKeyComparator(void *a, void *b) {
+    numKeyCompares++;
+    return int32Comparator(a, b);
+}
+
+int8_t countingDataComparator(void *a, void *b) {
+    numDataCompares++;
+    return int32Comparator(a, b);
+}
+
+void setUp(void) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    /* The min and max header fields are placed after an 8 byte bitmap, of which the Int8 bitmap uses the first byte */
+    state->bitmapSize = 8;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    char dataPath[] = "build/artifacts/dataFile.bin", indexPath[] = "build/artifacts/indexFile.bin";
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_MAX_MIN | EMBEDDB_RESET_DATA;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = countingKeyComparator;
+    state->compareData = countingDataComparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(EMBEDDB_DATA_CUSTOM, state->dataType, "Data should be compared with compareData by default.");
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+/* Data is signed and crosses zero, so it is ordered differently as an unsigned number */
+int32_t dataForKey(uint32_t key) {
+    return (int32_t)((key * 7) % 1000) - 500;
+}
+
+void insertRecords(uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        int32_t data = dataForKey(key);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+uint32_t runQuery(uint32_t minKey, uint32_t maxKey, int32_t minData, int32_t maxData) {
+    uint32_t key = 0, numRecords = 0;
+    int32_t data = 0;
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = &maxKey;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    embedDBInitIterator(state, &it);
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_TRUE_MESSAGE(key >= minKey && key <= maxKey, "Iterator returned a key outside the range.");
+        TEST_ASSERT_TRUE_MESSAGE(data >= minData && data <= maxData, "Iterator returned data outside the range.");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(dataForKey(key), data, "Iterator returned the wrong data.");
+        numRecords++;
+    }
+    embedDBCloseIterator(&it);
+    return numRecords;
+}
+
+uint32_t expectedQueryCount(uint32_t minKey, uint32_t maxKey, int32_t minData, int32_t maxData) {
+    uint32_t numRecords = 0;
+    for (uint32_t key = minKey; key <= maxKey && key < NUM_RECORDS; key++)
+        numRecords += dataForKey(key) >= minData && dataForKey(key) <= maxData;
+    return numRecords;
+}
+
+void typed_inserts_and_scans_do_not_call_comparators(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetDataType(state, EMBEDDB_DATA_INT32), "Failed to set the data type.");
+    insertRecords(NUM_RECORDS);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedQueryCount(100, 3500, -200, 150), runQuery(100, 3500, -200, 150), "Query returned the wrong number of records.");
+    uint32_t key = 1234;
+    int32_t data = 0;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a record.");
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(dataForKey(key), data, "embedDBGet returned the wrong data.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numKeyCompares, "Unsigned keys were compared with the key comparator.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numDataCompares, "Typed data was compared with the data comparator.");
+}
+
+void typed_scans_match_comparator_scans(void) {
+    insertRecords(NUM_RECORDS);
+    int32_t ranges[][2] = {{-500, 499}, {-500, -1}, {-20, 20}, {0, 499}, {498, 600}, {-600, -499}};
+    for (uint32_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        embedDBSetKeyType(state, EMBEDDB_KEY_CUSTOM);
+        embedDBSetDataType(state, EMBEDDB_DATA_CUSTOM);
+        uint32_t expected = runQuery(0, NUM_RECORDS, ranges[i][0], ranges[i][1]);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedQueryCount(0, NUM_RECORDS, ranges[i][0], ranges[i][1]), expected, "Comparator query returned the wrong number of records.");
+        embedDBSetKeyType(state, EMBEDDB_KEY_UINT32);
+        embedDBSetDataType(state, EMBEDDB_DATA_INT32);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected, runQuery(0, NUM_RECORDS, ranges[i][0], ranges[i][1]), "Typed query did not match the comparator query.");
+    }
+}
+
+void typed_data_tracks_signed_min_and_max(void) {
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBSetDataType(state, EMBEDDB_DATA_INT32), "Failed to set the data type.");
+    /* Stays in the write buffer, whose header holds the min and max data of the page */
+    insertRecords(50);
+    int32_t minData = 0, maxData = 0;
+    memcpy(&minData, EMBEDDB_GET_MIN_DATA(state->buffer, state), sizeof(int32_t));
+    memcpy(&maxData, EMBEDDB_GET_MAX_DATA(state->buffer, state), sizeof(int32_t));
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(-500, minData, "Page min data is wrong for signed data.");
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(-157, maxData, "Page max data is wrong for signed data.");
+}
+
+void comparators_do_not_overflow(void) {
+    int32_t small32 = -2000000000, large32 = 2000000000;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, int32Comparator(&small32, &large32), "int32Comparator overflowed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, int32Comparator(&large32, &small32), "int32Comparator overflowed.");
+    int64_t small64 = INT64_MIN + 1, large64 = INT64_MAX;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, int64Comparator(&small64, &large64), "int64Comparator overflowed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, int64Comparator(&large64, &small64), "int64Comparator overflowed.");
+}
+
+void data_type_must_fit_data_size(void) {
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBSetDataType(state, EMBEDDB_DATA_INT64), "8 byte data type was accepted for 4 byte data.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(EMBEDDB_DATA_CUSTOM, state->dataType, "Data type changed after a rejected call.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(typed_inserts_and_scans_do_not_call_comparators);
+    RUN_TEST(typed_scans_match_comparator_scans);
+    RUN_TEST(typed_data_tracks_signed_min_and_max);
+    RUN_TEST(comparators_do_not_overflow);
+    RUN_TEST(data_type_must_fit_data_size);
+    return UNITY_END();
+}
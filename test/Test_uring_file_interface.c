@@ -0,0 +1,215 @@
+/******************************************************************************/
+/**
+ * @file        Test_uring_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test batched page reads and writes with the io_uring file interface.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/uringFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+embedDBState *state;
+
+void initializeState(int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 12;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getUringFileInterface();
+    char dataPath[] = "build/artifacts/uringDataFile.bin", indexPath[] = "build/artifacts/uringIndexFile.bin";
+    state->dataFile = setupUringFile(dataPath, EMBEDDB_FILE_ROLE_DATA, 16);
+    state->indexFile = setupUringFile(indexPath, EMBEDDB_FILE_ROLE_INDEX, 16);
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the io_uring file interface.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownUringFile(state->dataFile);
+    tearDownUringFile(state->indexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void uring_interface_get_returns_inserted_records(void) {
+    insertRecords(5000);
+    embedDBFlush(state);
+    uint32_t data = 0;
+    for (uint32_t key = 0; key < 5000; key += 7) {
+        int8_t result = embedDBGet(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBGet did not find an inserted record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data.");
+    }
+}
+
+void uring_interface_queued_reads_complete_in_order(void) {
+    insertRecords(1000);
+    embedDBFlush(state);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(8, state->numWindowPages, "Spare buffer pages were not used as a read window.");
+
+    int8_t *pages = calloc(4, state->pageSize);
+    uint32_t pageNums[] = {5, 0, 500, 3};
+    for (int i = 0; i < 4; i++) {
+        int8_t queued = state->fileInterface->readAsync(pages + i * state->pageSize, pageNums[i], state->pageSize, state->dataFile);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, queued, "Read was not queued.");
+    }
+    int8_t results[4];
+    int32_t numCompleted = state->fileInterface->waitAsync(results, 4, state->dataFile);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(4, numCompleted, "Not all queued reads completed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, results[0], "Queued read of a written page failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, results[1], "Queued read of a written page failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, results[2], "Queued read of a page that was never written should fail.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, results[3], "Queued read of a written page failed.");
+
+    uint32_t pageId = 0;
+    memcpy(&pageId, pages, sizeof(uint32_t));
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(5, pageId, "Queued read returned the wrong page.");
+    memcpy(&pageId, pages + 3 * state->pageSize, sizeof(uint32_t));
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(3, pageId, "Queued read returned the wrong page.");
+    free(pages);
+}
+
+void uring_interface_queued_writes_can_be_read(void) {
+    int8_t *pages = calloc(3, state->pageSize);
+    for (uint32_t i = 0; i < 3; i++) {
+        memset(pages + i * state->pageSize, i + 1, state->pageSize);
+        int8_t queued = state->fileInterface->writeAsync(pages + i * state->pageSize, i, state->pageSize, state->dataFile);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, queued, "Write was not queued.");
+    }
+    int8_t results[3];
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(3, state->fileInterface->waitAsync(results, 3, state->dataFile), "Not all queued writes completed.");
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, results[i], "Queued write failed.");
+        int8_t page[512];
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->read(page, i, state->pageSize, state->dataFile), "Reading a written page failed.");
+        TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(i + 1, page, state->pageSize, "Page written with writeAsync has the wrong contents.");
+    }
+    free(pages);
+}
+
+void uring_interface_scan_reads_pages_in_batches(void) {
+    insertRecords(3000);
+    embedDBFlush(state);
+    embedDBResetStats(state);
+
+    embedDBIterator it;
+    it.minData = NULL;
+    it.maxData = NULL;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t key, data, expectedKey = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedKey++, key, "Iterator returned the wrong key.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(3000, expectedKey, "Iterator did not read the correct number of records");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->nextDataPageId, state->numReads, "Each data page should be read exactly once.");
+}
+
+void uring_interface_iterator_returns_filtered_records(void) {
+    insertRecords(3000);
+    embedDBFlush(state);
+
+    embedDBIterator it;
+    uint32_t minData = 23, maxData = 38;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, data, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(30 * 16, numRecordsRead, "Iterator did not read the correct number of records");
+}
+
+void uring_interface_recovers_data_after_reopen(void) {
+    insertRecords(4000);
+    embedDBFlush(state);
+    uint32_t expectedNextPage = state->nextDataPageId;
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered from the data file.");
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(0, state->minKey, "minKey was not recovered from the data file.");
+    uint32_t key = 3999, data = 0;
+    int8_t result = embedDBGet(state, &key, &data);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBGet did not find a recovered record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(99, data, "embedDBGet returned the wrong data after recovery.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(uring_interface_get_returns_inserted_records);
+    RUN_TEST(uring_interface_queued_reads_complete_in_order);
+    RUN_TEST(uring_interface_queued_writes_can_be_read);
+    RUN_TEST(uring_interface_scan_reads_pages_in_batches);
+    RUN_TEST(uring_interface_iterator_returns_filtered_records);
+    RUN_TEST(uring_interface_recovers_data_after_reopen);
+    return UNITY_END();
+}
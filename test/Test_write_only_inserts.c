@@ -0,0 +1,184 @@
+/******************************************************************************/
+/**
+ * @file        Test_write_only_inserts.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test that inserting records does not read from storage.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "unity.h"
+
+#define NUM_DATA_PAGES 1000
+#define NUM_INDEX_PAGES 8
+#define NUM_VAR_PAGES 200
+#define NUM_RECORDS 1000000
+
+embedDBState *state;
+void *dataFile, *indexFile, *varFile;
+
+/* Number of pages read or mapped from any file */
+uint32_t numStorageReads = 0;
+
+int8_t (*ramRead)(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file);
+void *(*ramMapPage)(uint32_t pageNum, uint32_t pageSize, void *file);
+
+int8_t COUNTING_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    numStorageReads++;
+    return ramRead(buffer, pageNum, pageSize, file);
+}
+
+void *COUNTING_MAP_PAGE(uint32_t pageNum, uint32_t pageSize, void *file) {
+    numStorageReads++;
+    return ramMapPage(pageNum, pageSize, file);
+}
+
+void initializeState(int8_t parameters) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 6;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = NUM_DATA_PAGES;
+    state->numIndexPages = NUM_INDEX_PAGES;
+    state->numVarPages = NUM_VAR_PAGES;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getRamFileInterface();
+    ramRead = state->fileInterface->read;
+    ramMapPage = state->fileInterface->mapPage;
+    state->fileInterface->read = COUNTING_READ;
+    state->fileInterface->mapPage = COUNTING_MAP_PAGE;
+    state->dataFile = dataFile;
+    state->indexFile = indexFile;
+    state->varFile = varFile;
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly.");
+}
+
+void closeState(void) {
+    embedDBClose(state);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(state);
+}
+
+void setUp(void) {
+    dataFile = setupRamFile(512, NUM_DATA_PAGES, NULL);
+    indexFile = setupRamFile(512, NUM_INDEX_PAGES, NULL);
+    varFile = setupRamFile(512, NUM_VAR_PAGES, NULL);
+    TEST_ASSERT_NOT_NULL_MESSAGE(dataFile, "Unable to allocate the RAM data file.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(indexFile, "Unable to allocate the RAM index file.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varFile, "Unable to allocate the RAM var file.");
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA);
+    embedDBResetStats(state);
+    numStorageReads = 0;
+}
+
+void tearDown(void) {
+    closeState();
+    tearDownRamFile(dataFile);
+    tearDownRamFile(indexFile);
+    tearDownRamFile(varFile);
+}
+
+void insertRecords(uint32_t firstKey, uint32_t numRecords) {
+    char varData[] = "Record";
+    for (uint32_t key = firstKey; key < firstKey + numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPutVar(state, &key, &data, varData, sizeof(varData));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutVar did not correctly insert data (returned non-zero code)");
+    }
+}
+
+void inserting_a_million_records_does_not_read(void) {
+    insertRecords(0, NUM_RECORDS);
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(NUM_DATA_PAGES, state->nextDataPageId, "Test should wrap around the data file.");
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(NUM_VAR_PAGES, state->nextVarPageId, "Test should wrap around the variable data file.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numStorageReads, "Inserting records read from storage.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, state->numReads, "Inserting records read from storage.");
+}
+
+void erased_variable_data_is_detected_without_reading(void) {
+    insertRecords(0, 100000);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numStorageReads, "Inserting records read from storage.");
+    uint32_t minKey = (uint32_t)state->minVarRecordId;
+    TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(0, minKey, "Test should erase variable data.");
+
+    /* The key kept in memory must match the header of the last page that was erased */
+    uint32_t data = 0;
+    embedDBVarDataStream *stream = NULL;
+    uint32_t key = minKey - 1;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, embedDBGetVar(state, &key, &data, &stream), "Variable data before the minimum record should be reported as erased.");
+    TEST_ASSERT_NULL_MESSAGE(stream, "No stream should be returned for erased variable data.");
+
+    key = minKey;
+    char buffer[16];
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &data, &stream), "Variable data of the minimum record was not found.");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stream, "No stream was returned for the minimum record.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(7, embedDBVarDataStreamRead(state, stream, buffer, sizeof(buffer)), "Read the wrong amount of variable data.");
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE("Record", buffer, 7, "Read the wrong variable data.");
+    free(stream);
+}
+
+void recovered_state_checks_key_order_without_reading(void) {
+    insertRecords(0, 100000);
+    embedDBFlush(state);
+    closeState();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_VDATA);
+    numStorageReads = 0;
+
+    uint32_t key = 99999, data = 0;
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBPut(state, &key, &data), "A key that is not larger than the last key was inserted.");
+    key = 100000;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "A larger key was not inserted after recovery.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, numStorageReads, "Checking the key order read from storage.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(inserting_a_million_records_does_not_read);
+    RUN_TEST(erased_variable_data_is_detected_without_reading);
+    RUN_TEST(recovered_state_checks_key_order_without_reading);
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+/******************************************************************************/
+/**
+ * @file        Test_posix_file_interface.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Test EmbedDB insertion, querying, and recovery with pages written by a background thread.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <string.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/posixFileInterface.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "../src/embedDB/writerThreadFileInterface.h"
+#include "unity.h"
+
+embedDBState *state;
+embedDBFileInterface *posixInterface;
+void *posixDataFile, *posixIndexFile;
+
+void initializeState(int8_t parameters, uint32_t numQueuedPages) {
+    state = (embedDBState *)malloc(sizeof(embedDBState));
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "Unable to allocate EmbedDB state.");
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->bufferSizeInBlocks = 4;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->buffer = calloc(1, (size_t)state->pageSize * state->bufferSizeInBlocks);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state->buffer, "Failed to allocate buffer for EmbedDB.");
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    posixInterface = getPosixFileInterface();
+    state->fileInterface = getWriterThreadFileInterface();
+    char dataPath[] = "build/artifacts/writerThreadDataFile.bin", indexPath[] = "build/artifacts/writerThreadIndexFile.bin";
+    posixDataFile = setupPosixFile(dataPath, EMBEDDB_FILE_ROLE_DATA);
+    posixIndexFile = setupPosixFile(indexPath, EMBEDDB_FILE_ROLE_INDEX);
+    state->dataFile = setupWriterThreadFile(posixInterface, posixDataFile, state->pageSize, numQueuedPages);
+    state->indexFile = setupWriterThreadFile(posixInterface, posixIndexFile, state->pageSize, numQueuedPages);
+    state->parameters = parameters;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+    int8_t result = embedDBInit(state, 1);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "EmbedDB did not initialize correctly with the writer thread file interface.");
+}
+
+void setUp(void) {
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA, 4);
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownWriterThreadFile(state->dataFile);
+    tearDownWriterThreadFile(state->indexFile);
+    tearDownPosixFile(posixDataFile);
+    tearDownPosixFile(posixIndexFile);
+    free(state->buffer);
+    free(state->fileInterface);
+    free(posixInterface);
+    free(state);
+}
+
+void insertRecords(uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        uint32_t data = key % 100;
+        int8_t result = embedDBPut(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPut did not correctly insert data (returned non-zero code)");
+    }
+}
+
+int8_t FAILING_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    return 0;
+}
+
+void writer_thread_get_returns_records_before_flush(void) {
+    /* Pages may still be queued, so lookups have to find them in the ring */
+    insertRecords(5000);
+    uint32_t data = 0, numWrittenRecords = state->maxRecordsPerPage * state->nextDataPageId;
+    for (uint32_t key = 0; key < numWrittenRecords; key += 7) {
+        int8_t result = embedDBGet(state, &key, &data);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBGet did not find an inserted record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data.");
+    }
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush did not write the queued pages.");
+}
+
+void writer_thread_read_returns_queued_page(void) {
+    uint8_t page[512], readBack[512];
+    for (uint32_t i = 0; i < 20; i++) {
+        memset(page, i + 1, sizeof(page));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->write(page, i % 3, state->pageSize, state->dataFile), "Write was not queued.");
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->read(readBack, i % 3, state->pageSize, state->dataFile), "Read of a queued page failed.");
+        TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(i + 1, readBack, sizeof(readBack), "Read did not return the newest write of the page.");
+    }
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->fileInterface->flush(state->dataFile), "Flush failed.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, posixInterface->read(readBack, 19 % 3, state->pageSize, posixDataFile), "Page was not written to the file.");
+    TEST_ASSERT_EACH_EQUAL_INT8_MESSAGE(20, readBack, sizeof(readBack), "File does not contain the last write of the page.");
+}
+
+void writer_thread_iterator_returns_filtered_records(void) {
+    insertRecords(3000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush did not write the queued pages.");
+
+    embedDBIterator it;
+    uint32_t minData = 23, maxData = 38;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, data, numRecordsRead = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "Record contains the wrong data");
+        numRecordsRead++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(30 * 16, numRecordsRead, "Iterator did not read the correct number of records");
+}
+
+void writer_thread_recovers_wrapped_data_after_reopen(void) {
+    /* Enough records to wrap around the 1000 data pages while only two pages can be queued */
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA, 2);
+    insertRecords(80000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush did not write the queued pages.");
+    uint32_t expectedNextPage = state->nextDataPageId;
+    tearDown();
+    initializeState(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX, 4);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNextPage, state->nextDataPageId, "nextDataPageId was not recovered from the data file.");
+    uint32_t data = 0;
+    for (uint32_t key = 79999; key > 79999 - 30000; key -= 101) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, &data), "embedDBGet did not find a recovered record.");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(key % 100, data, "embedDBGet returned the wrong data after recovery.");
+    }
+}
+
+void writer_thread_flush_reports_failed_write(void) {
+    insertRecords(1000);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBFlush(state), "embedDBFlush failed with a working file.");
+    posixInterface->write = FAILING_WRITE;
+    posixInterface->writePages = NULL;
+    uint32_t data = 0;
+    for (uint32_t key = 1000; key < 1200; key++)
+        embedDBPut(state, &key, &data);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(-1, embedDBFlush(state), "embedDBFlush did not report a failed background write.");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->fileInterface->write(state->buffer, 0, state->pageSize, state->dataFile), "Writes should keep failing after a background write failed.");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(writer_thread_get_returns_records_before_flush);
+    RUN_TEST(writer_thread_read_returns_queued_page);
+    RUN_TEST(writer_thread_iterator_returns_filtered_records);
+    RUN_TEST(writer_thread_recovers_wrapped_data_after_reopen);
+    RUN_TEST(writer_thread_flush_reports_failed_write);
+    return UNITY_END();
+}